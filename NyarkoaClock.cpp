@@ -0,0 +1,156 @@
+#include <Arduino.h>
+#include <NyarkoaClock.h>
+
+NyarkoaClock::NyarkoaClock() { reset(); }
+
+/**
+ * Forget the clock and make a sample due at once.
+ */
+void NyarkoaClock::reset() {
+  synced = false;
+  refMillis = 0;
+  refSeconds = 0;
+  refFraction = 0;
+  anchorMillis = 0;
+  anchorSeconds = 0;
+  drift = 0;
+  resyncInterval = MIN_RESYNC;
+  nextSync = millis();
+}
+
+/**
+ * Check whether the clock should be sampled again.
+ *
+ * @param now The current millis().
+ * @return true once the resync interval has passed since the last sample or
+ * failed attempt, or at once after reset().
+ */
+bool NyarkoaClock::isSyncDue(unsigned long now) const {
+  return long(now - nextSync) >= 0;
+}
+
+/**
+ * Postpone the next sample after a failed attempt.
+ *
+ * @param now The current millis().
+ */
+void NyarkoaClock::deferSync(unsigned long now) {
+  nextSync = now + MIN_RESYNC;
+}
+
+/**
+ * Adjust the clock with a time reported by the module.
+ *
+ * @param moduleSeconds The module time in seconds since 2000-01-01.
+ * @param sentAt The millis() at which the request was sent.
+ * @param receivedAt The millis() at which the answer arrived.
+ */
+void NyarkoaClock::addSample(uint32_t moduleSeconds, unsigned long sentAt,
+                             unsigned long receivedAt) {
+  unsigned long roundTrip = receivedAt - sentAt;
+  unsigned long midpoint = sentAt + roundTrip / 2;
+  if (!synced) {
+    start(midpoint, moduleSeconds);
+    return;
+  }
+
+  // The module read moduleSeconds somewhere between sentAt and receivedAt, so
+  // at the midpoint its clock lay within [low, high] of our prediction.
+  uint32_t seconds;
+  long fraction;
+  timeAt(midpoint, seconds, fraction);
+  long low = int32_t(moduleSeconds - seconds) * 1000L - fraction -
+             long(roundTrip / 2);
+  long high = low + 1000L + long(roundTrip);
+  if (low > STEP_THRESHOLD || high < -STEP_THRESHOLD) {
+    start(midpoint, moduleSeconds);
+    return;
+  }
+
+  // The drift is measured against the first sample. Each sample is only known
+  // to within a second, so it is left alone until that error is small.
+  unsigned long baseline = midpoint - anchorMillis;
+  if (baseline >= DRIFT_BASELINE) {
+    float moduleElapsed = (moduleSeconds - anchorSeconds) * 1000.0f;
+    drift = moduleElapsed / baseline - 1;
+    if (drift > MAX_DRIFT) drift = MAX_DRIFT;
+    if (drift < -MAX_DRIFT) drift = -MAX_DRIFT;
+  }
+
+  // Move an eighth of the way towards the middle of the window, and at least
+  // far enough to be inside it.
+  long correction = (low + high) / 16;
+  if (correction < low) correction = low;
+  if (correction > high) correction = high;
+  if (low <= 0 && high >= 0) {
+    // the clock already agreed with the module
+    resyncInterval = resyncInterval * 2 < MAX_RESYNC ? resyncInterval * 2
+                                                     : MAX_RESYNC;
+  } else {
+    resyncInterval = MIN_RESYNC;
+  }
+  setReference(midpoint, seconds, fraction + correction);
+}
+
+/**
+ * Read the clock.
+ *
+ * @param now The current millis().
+ * @return The module time in seconds since 2000-01-01, or 0 if the clock
+ * has not been synced.
+ */
+uint32_t NyarkoaClock::read(unsigned long now) const {
+  if (!synced) return 0;
+  uint32_t seconds;
+  long fraction;
+  timeAt(now, seconds, fraction);
+  return seconds;
+}
+
+/**
+ * Extrapolate the module time from the last sample.
+ *
+ * @param at A millis() value, no earlier than the last sample.
+ * @param seconds Receives the whole seconds since 2000-01-01.
+ * @param fraction Receives the milliseconds, 0 to 999.
+ */
+void NyarkoaClock::timeAt(unsigned long at, uint32_t &seconds,
+                          long &fraction) const {
+  unsigned long elapsed = at - refMillis;
+  long total = refFraction + long(elapsed % 1000) + lround(elapsed * drift);
+  long carry = total >= 0 ? total / 1000 : -((999 - total) / 1000);
+  seconds = refSeconds + elapsed / 1000 + carry;
+  fraction = total - carry * 1000;
+}
+
+/**
+ * Set the clock from a single sample, forgetting earlier ones.
+ *
+ * @param midpoint The millis() halfway through the sample's round trip.
+ * @param moduleSeconds The module time it reported.
+ */
+void NyarkoaClock::start(unsigned long midpoint, uint32_t moduleSeconds) {
+  synced = true;
+  drift = 0;
+  anchorMillis = midpoint;
+  anchorSeconds = moduleSeconds;
+  resyncInterval = MIN_RESYNC;
+  // the reported second began up to 1 s before the midpoint
+  setReference(midpoint, moduleSeconds, 500);
+}
+
+/**
+ * Restart the extrapolation from a known module time.
+ *
+ * @param at The millis() value the time belongs to.
+ * @param seconds The module time in seconds since 2000-01-01.
+ * @param fraction Milliseconds to add; may be negative or above 999.
+ */
+void NyarkoaClock::setReference(unsigned long at, uint32_t seconds,
+                                long fraction) {
+  long carry = fraction >= 0 ? fraction / 1000 : -((999 - fraction) / 1000);
+  refMillis = at;
+  refSeconds = seconds + carry;
+  refFraction = fraction - carry * 1000;
+  nextSync = at + resyncInterval;
+}
@@ -0,0 +1,59 @@
+#ifndef NYARKOA_CLOCK_H
+#define NYARKOA_CLOCK_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+
+/**
+ * Local copy of the communication module's clock.
+ *
+ * The module reports its time in whole seconds. As in NTP, each report is
+ * treated as a sample taken between sending the request and receiving the
+ * answer: the module time is placed at the midpoint, and the round-trip
+ * delay plus the one second resolution bound where the true time can lie.
+ * Between samples the clock runs on millis(), corrected for the measured
+ * drift of the local oscillator against the module's.
+ *
+ * The first sample sets the clock. Later samples pull it towards the
+ * measured time, never outside the window the sample allows. The drift is
+ * measured over the time since the first sample, once that is long enough
+ * for the one second resolution not to matter. A sample far outside the
+ * window, for example after the module set its clock from GPS, resets the
+ * clock. Samples are due every NYARKOA_CLOCK_MIN_RESYNC seconds at first;
+ * the interval doubles, up to NYARKOA_CLOCK_MAX_RESYNC, each time a sample
+ * needs no correction.
+ */
+class NyarkoaClock {
+ public:
+  NyarkoaClock();
+  void reset();
+  bool isSynced() const { return synced; }
+  bool isSyncDue(unsigned long now) const;
+  void deferSync(unsigned long now);
+  void addSample(uint32_t moduleSeconds, unsigned long sentAt,
+                 unsigned long receivedAt);
+  uint32_t read(unsigned long now) const;
+  float getDrift() const { return drift; }
+
+ private:
+  const unsigned long MIN_RESYNC{NYARKOA_CLOCK_MIN_RESYNC * 1000UL};
+  const unsigned long MAX_RESYNC{NYARKOA_CLOCK_MAX_RESYNC * 1000UL};
+  const unsigned long DRIFT_BASELINE{8 * MIN_RESYNC};
+  const long STEP_THRESHOLD{2000};  // ms beyond the window that reset
+  const float MAX_DRIFT{0.01f};
+
+  bool synced;
+  unsigned long refMillis;     // local time of the last sample
+  uint32_t refSeconds;         // module time then, in seconds since 2000
+  int refFraction;             // and milliseconds
+  unsigned long anchorMillis;  // local time of the first sample
+  uint32_t anchorSeconds;      // module time then
+  float drift;                 // module ms per local ms, minus 1
+  unsigned long resyncInterval;
+  unsigned long nextSync;
+
+  void start(unsigned long midpoint, uint32_t moduleSeconds);
+  void timeAt(unsigned long at, uint32_t &seconds, long &fraction) const;
+  void setReference(unsigned long at, uint32_t seconds, long fraction);
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef NYARKOA_CONFIG_H
+#define NYARKOA_CONFIG_H
+
+// Compile-time settings for the Nyarkoa library. The Arduino IDE compiles the
+// library separately from the sketch, so defines placed in a sketch do not
+// reach the library; edit the values here instead.
+//
+// With these defaults a NyarkoaPayload takes about 930 bytes of RAM, of the
+// 2 KB of an ATmega328; "RAM Budget" in README.md lists what each setting
+// costs.
+
+// Largest payload carried by a single binary link frame, in bytes. The
+// AT_ALL snapshot (10 floats and the 17-byte GPS record) is the longest
+// reply; ground station messages longer than this fail on a binary link.
+#ifndef NYARKOA_FRAME_PAYLOAD_SIZE
+#define NYARKOA_FRAME_PAYLOAD_SIZE 64
+#endif
+
+// Longest text response line kept by the receiver, including the
+// terminating NUL. Longer lines are truncated.
+#ifndef NYARKOA_RX_LINE_SIZE
+#define NYARKOA_RX_LINE_SIZE 128
+#endif
+
+// Number of asynchronous requests the sketch can have outstanding at once,
+// e.g. AT_MPU, AT_MPL and AT_GPS pipelined. Blocking calls and the clock
+// checks of poll() use one more slot, kept for the library. Each slot takes
+// 25 bytes of RAM plus NYARKOA_ARGS_SIZE.
+#ifndef NYARKOA_MAX_PENDING
+#define NYARKOA_MAX_PENDING 3
+#endif
+
+// Bytes of the reply buffer shared by all requests, which holds the replies
+// of finished requests until their results are collected. The AT_ALL
+// snapshot is the longest reply. A reply that finds no room is asked for
+// again later.
+#ifndef NYARKOA_RESULT_SIZE
+#define NYARKOA_RESULT_SIZE 112
+#endif
+
+// Longest command or request text, including the terminating NUL. Ground
+// station messages ("GS::cmd::payload") are the longest; longer ones are
+// rejected. The text is rebuilt in one buffer of this size for every
+// attempt.
+#ifndef NYARKOA_CMD_SIZE
+#define NYARKOA_CMD_SIZE 64
+#endif
+
+// Bytes kept in each request slot for the text after the command's name,
+// e.g. ":100" of "AT_ALERT:100", including the terminating NUL. Blocking
+// calls may send longer text; asynchronous requests may not.
+#ifndef NYARKOA_ARGS_SIZE
+#define NYARKOA_ARGS_SIZE 16
+#endif
+
+// Uncomment to build NyarkoaPayload without any heap allocation. The String
+// overloads of its methods are left out, and text results (Response.message,
+// getDate() and the like) are returned as `const char *` pointing into the
+// library's buffers; copy them before starting the next request.
+// #define NYARKOA_NO_HEAP
+
+// Uncomment to leave out the built-in SoftwareSerial link on pins 4/5. The
+// communication module must then be connected with
+// connectCommModule(Stream &), for example over a hardware UART.
+// #define NYARKOA_NO_SOFTWARE_SERIAL
+
+// Most detailed diagnostic message compiled into the library. Messages
+// above this level are left out of the build entirely; setLogLevel() can
+// only silence the ones that remain. NYARKOA_LOG_DEBUG traces every command
+// and reply; NYARKOA_LOG_NONE leaves no logging code at all.
+#define NYARKOA_LOG_NONE 0
+#define NYARKOA_LOG_ERROR 1
+#define NYARKOA_LOG_WARN 2
+#define NYARKOA_LOG_INFO 3
+#define NYARKOA_LOG_DEBUG 4
+#ifndef NYARKOA_LOG_LEVEL
+#define NYARKOA_LOG_LEVEL NYARKOA_LOG_INFO
+#endif
+
+// How often, in seconds, NyarkoaPayload checks its local clock against the
+// comm module's. Checks start at the minimum interval and back off to the
+// maximum while the clocks agree.
+#ifndef NYARKOA_CLOCK_MIN_RESYNC
+#define NYARKOA_CLOCK_MIN_RESYNC 64
+#endif
+#ifndef NYARKOA_CLOCK_MAX_RESYNC
+#define NYARKOA_CLOCK_MAX_RESYNC 1024
+#endif
+
+// Readings of each subscribed sensor kept until the sketch reads them. A
+// sensor pushing faster than the sketch reads loses its oldest readings.
+// Each slot takes 4 bytes plus 28 (MPU), 12 (MPL) or 17 (GPS) bytes of RAM,
+// 288 bytes in all at a depth of 4. 0 leaves subscribe() and readSample()
+// out of the library.
+#ifndef NYARKOA_STREAM_DEPTH
+#define NYARKOA_STREAM_DEPTH 0
+#endif
+
+// Reply bytes the emulated comm module of the host build holds until the
+// payload reads them. The AT_ALL snapshot, about 140 bytes as a CRC line, is
+// the longest single reply.
+#ifndef NYARKOA_SIM_OUT_SIZE
+#define NYARKOA_SIM_OUT_SIZE 192
+#endif
+
+// Ground station records NyarkoaPayload::queueDownlink holds, in bytes of
+// text, until they are sent in batches of one acknowledged message each.
+// The queue takes this plus about 140 bytes of RAM, the delta encoder of
+// queueTelemetry and the request slot of the batches included; 128 suits
+// most flights. 0 leaves queueDownlink, queueTelemetry and flushDownlink
+// out of the library.
+#ifndef NYARKOA_DOWNLINK_SIZE
+#define NYARKOA_DOWNLINK_SIZE 0
+#endif
+
+// Milliseconds a queued ground station record may wait for its batch to
+// fill before the batch is sent anyway.
+#ifndef NYARKOA_DOWNLINK_AGE
+#define NYARKOA_DOWNLINK_AGE 1000
+#endif
+
+// Records of a NyarkoaDeltaEncoder stream from one key record to the next.
+// A ground station that missed a record reads the stream again from the
+// next key record; key records are about three times as long as the rest.
+#ifndef NYARKOA_DELTA_KEY_INTERVAL
+#define NYARKOA_DELTA_KEY_INTERVAL 16
+#endif
+
+// Bytes of link trace NyarkoaTraceRecorder keeps in RAM. A snapshot over
+// the CRC text link takes about 150 bytes of trace, its request included.
+#ifndef NYARKOA_TRACE_SIZE
+#define NYARKOA_TRACE_SIZE 256
+#endif
+
+// Link statistics kept by NyarkoaPayload and read with getLinkStats():
+// 0 leaves them out, 1 keeps the link counters (28 bytes of RAM), 2 also
+// keeps round-trip times for each command (10 bytes per command, 140 in
+// all).
+#ifndef NYARKOA_LINK_STATS
+#define NYARKOA_LINK_STATS 2
+#endif
+
+#endif
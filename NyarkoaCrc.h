@@ -0,0 +1,21 @@
+#ifndef NYARKOA_CRC_H
+#define NYARKOA_CRC_H
+#include <Arduino.h>
+
+/*
+ * Table-driven CRC used to protect traffic on the link.
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) covers binary
+ * frames and, on a CRC text link, every text line. The lookup table is kept
+ * in flash.
+ */
+const uint16_t CRC16_INIT{0xFFFF};
+const byte CRC16_HEX_SIZE{5};  // 4 hex digits and the terminating NUL
+
+uint16_t crc16Update(uint16_t crc, byte data);
+uint16_t crc16(const void *data, size_t length, uint16_t crc = CRC16_INIT);
+
+void crc16ToHex(uint16_t crc, char *hex);
+bool hexToCrc16(const char *hex, uint16_t &crc);
+
+#endif
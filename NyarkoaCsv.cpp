@@ -0,0 +1,135 @@
+#include <Arduino.h>
+#include <NyarkoaCsv.h>
+
+CsvTokenizer::CsvTokenizer(const char *text, char separator)
+    : cursor(text ? text : ""),
+      separator(separator),
+      valid(text != nullptr),
+      exhausted(text == nullptr) {}
+
+/**
+ * Read the next field as a floating point number.
+ *
+ * @param value Receives the number.
+ * @return true if the field holds a number and nothing else; otherwise,
+ * false, and the payload is marked invalid.
+ */
+bool CsvTokenizer::nextFloat(float &value) {
+  if (exhausted) return fail();
+  char *stop;
+  double parsed = strtod(cursor, &stop);
+  if (stop == cursor || !isFieldEnd(*stop)) return fail();
+  value = float(parsed);
+  return advance(stop);
+}
+
+/**
+ * Read the next field as a decimal integer.
+ *
+ * @param value Receives the integer.
+ * @return true if the field holds an integer and nothing else; otherwise,
+ * false, and the payload is marked invalid.
+ */
+bool CsvTokenizer::nextLong(long &value) {
+  if (exhausted) return fail();
+  char *stop;
+  long parsed = strtol(cursor, &stop, 10);
+  if (stop == cursor || !isFieldEnd(*stop)) return fail();
+  value = parsed;
+  return advance(stop);
+}
+
+/**
+ * Read the next field as a fixed-point number.
+ *
+ * The decimal number is scaled by 10^decimals and returned as an integer, so
+ * "5.603716" read with 6 decimals gives 5603716. Extra digits are truncated
+ * and missing ones padded with zeros. No floating point is involved, so the
+ * full precision of the text is kept.
+ *
+ * @param value Receives the scaled integer.
+ * @param decimals The number of decimal places to keep.
+ * @return true if the field holds a number that fits in a long; otherwise,
+ * false, and the payload is marked invalid.
+ */
+bool CsvTokenizer::nextFixed(long &value, byte decimals) {
+  if (exhausted) return fail();
+  const char *p = cursor;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') p++;
+
+  unsigned long scaled = 0;
+  bool hasDigits = false;
+  byte fraction = 0;
+  bool inFraction = false;
+  for (; !isFieldEnd(*p); p++) {
+    if (*p == '.' && !inFraction) {
+      inFraction = true;
+      continue;
+    }
+    if (*p < '0' || *p > '9') return fail();
+    hasDigits = true;
+    if (inFraction && fraction >= decimals) continue;
+    if (scaled > (0x7FFFFFFFUL - 9) / 10) return fail();
+    scaled = scaled * 10 + (*p - '0');
+    if (inFraction) fraction++;
+  }
+  if (!hasDigits) return fail();
+  for (; fraction < decimals; fraction++) {
+    if (scaled > 0x7FFFFFFFUL / 10) return fail();
+    scaled *= 10;
+  }
+  value = negative ? -long(scaled) : long(scaled);
+  return advance(p);
+}
+
+/**
+ * Copy the next field as text.
+ *
+ * @param buffer Receives the field, NUL-terminated.
+ * @param size The size of the buffer.
+ * @return true if the field fits in the buffer; otherwise, false, and the
+ * payload is marked invalid.
+ */
+bool CsvTokenizer::nextText(char *buffer, byte size) {
+  if (exhausted || size == 0) return fail();
+  const char *end = fieldEnd();
+  size_t length = end - cursor;
+  if (length >= size) return fail();
+  memcpy(buffer, cursor, length);
+  buffer[length] = '\0';
+  return advance(end);
+}
+
+/**
+ * Skip the next field.
+ *
+ * @return true if there was a field to skip; otherwise, false, and the
+ * payload is marked invalid.
+ */
+bool CsvTokenizer::skip() {
+  if (exhausted) return fail();
+  return advance(fieldEnd());
+}
+
+const char *CsvTokenizer::fieldEnd() const {
+  const char *end = cursor;
+  while (!isFieldEnd(*end)) end++;
+  return end;
+}
+
+// Move past the field ending at 'end' and its separator.
+bool CsvTokenizer::advance(const char *end) {
+  if (*end == separator) {
+    cursor = end + 1;
+  } else {
+    cursor = end;
+    exhausted = true;
+  }
+  return valid;
+}
+
+bool CsvTokenizer::fail() {
+  valid = false;
+  return false;
+}
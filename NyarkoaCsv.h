@@ -0,0 +1,39 @@
+#ifndef NYARKOA_CSV_H
+#define NYARKOA_CSV_H
+#include <Arduino.h>
+
+/**
+ * Single-pass reader for comma-separated payloads.
+ *
+ * The tokenizer walks the caller's buffer once and converts each field where
+ * it lies, without copying the payload or allocating memory. Any field that
+ * is missing or does not convert cleanly marks the payload invalid, so short
+ * or malformed payloads are reported instead of read as zeros.
+ */
+class CsvTokenizer {
+ public:
+  CsvTokenizer(const char *text, char separator = ',');
+
+  bool nextFloat(float &value);
+  bool nextLong(long &value);
+  bool nextFixed(long &value, byte decimals);
+  bool nextText(char *buffer, byte size);
+  bool skip();
+
+  bool isValid() const { return valid; }
+  bool atEnd() const { return exhausted; }
+  const char *remaining() const { return cursor; }
+
+ private:
+  const char *cursor;
+  char separator;
+  bool valid;
+  bool exhausted;
+
+  bool isFieldEnd(char c) const { return c == separator || c == '\0'; }
+  const char *fieldEnd() const;
+  bool advance(const char *end);
+  bool fail();
+};
+
+#endif
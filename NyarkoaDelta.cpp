@@ -0,0 +1,477 @@
+#include <Arduino.h>
+#include <NyarkoaDelta.h>
+
+const byte DELTA_KEY{32};         // HEADER flag of a key record
+const byte DELTA_MORE{32};        // digit flag: another digit follows
+const byte DELTA_COUNT_MASK{31};  // count bits in a delta record's HEADER
+const uint16_t DELTA_KEY_COUNT_MASK{2047};  // and in a key record's
+// A record this many records or fewer behind the stream repeats one.
+const byte DELTA_REPEAT_WINDOW{16};
+
+static const char *const STREAM_NAMES[DELTA_STREAM_COUNT] = {"DMPU", "DMPL",
+                                                             "DGPS"};
+static const byte FIELD_COUNTS[DELTA_STREAM_COUNT] = {7, 3, 6};
+// Decimals kept of each field, in the order of deltaFieldCount. 0.001 rad/s
+// is about the noise of an MPU-6050 gyro; 0.01 m/s^2, hPa, m and degrees C
+// is the precision of the module's text.
+static const byte FIELD_DECIMALS[DELTA_STREAM_COUNT][DELTA_MAX_FIELDS]
+    PROGMEM = {{2, 2, 2, 3, 3, 3, 2}, {2, 2, 2}, {0, 0, 0, 0, 0, 0}};
+static const float POWERS_OF_TEN[] PROGMEM = {1, 10, 100, 1000};
+// 2^31, the first float beyond the range of a field.
+const float DELTA_FIXED_LIMIT{2147483648.0f};
+
+/**
+ * Get the base-64 digit of a value.
+ *
+ * @param value The value, 0 to 63.
+ * @return The digit, one of "0-9A-Za-z-_".
+ */
+static char toDigit(byte value) {
+  if (value < 10) return '0' + value;
+  if (value < 36) return 'A' + value - 10;
+  if (value < 62) return 'a' + value - 36;
+  return value == 62 ? '-' : '_';
+}
+
+/**
+ * Get the value of a base-64 digit.
+ *
+ * @param digit The digit.
+ * @return Its value, 0 to 63, or -1 if it is not a digit.
+ */
+static int fromDigit(char digit) {
+  if (digit >= '0' && digit <= '9') return digit - '0';
+  if (digit >= 'A' && digit <= 'Z') return digit - 'A' + 10;
+  if (digit >= 'a' && digit <= 'z') return digit - 'a' + 36;
+  if (digit == '-') return 62;
+  if (digit == '_') return 63;
+  return -1;
+}
+
+/**
+ * Write a difference as a zigzag varint.
+ *
+ * @param delta The difference, wrapped to 32 bits.
+ * @param text Where to write the digits; DELTA_VARINT_MAX must fit.
+ * @return The number of digits written.
+ */
+static byte writeVarint(uint32_t delta, char *text) {
+  // zigzag: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+  uint32_t value = (delta << 1) ^ (0 - (delta >> 31));
+  byte length = 0;
+  do {
+    byte part = value & (DELTA_MORE - 1);
+    value >>= 5;
+    text[length++] = toDigit(part | (value ? DELTA_MORE : 0));
+  } while (value);
+  return length;
+}
+
+/**
+ * Read a zigzag varint.
+ *
+ * @param text The digits; moved past them.
+ * @param delta Receives the difference, wrapped to 32 bits.
+ * @return true if a whole varint was read; otherwise, false.
+ */
+static bool readVarint(const char *&text, uint32_t &delta) {
+  uint32_t value = 0;
+  byte shift = 0;
+  int part;
+  do {
+    if (shift >= 5 * DELTA_VARINT_MAX) return false;
+    part = fromDigit(*text);
+    if (part < 0) return false;
+    text++;
+    value |= uint32_t(part & (DELTA_MORE - 1)) << shift;
+    shift += 5;
+  } while (part & DELTA_MORE);
+  delta = (value >> 1) ^ (0 - (value & 1));
+  return true;
+}
+
+/**
+ * Scale a reading to the integer of its field.
+ *
+ * @param stream The reading's stream.
+ * @param field The field's index.
+ * @param value The reading.
+ * @return The reading times 10^deltaFieldDecimals, rounded and clamped to
+ * +-DELTA_FIXED_MAX, or DELTA_NO_READING if the reading is NaN.
+ */
+static int32_t toFixed(DeltaStream stream, byte field, float value) {
+  if (isnan(value)) return DELTA_NO_READING;
+  float scaled =
+      value * pgm_read_float(&POWERS_OF_TEN[deltaFieldDecimals(stream, field)]);
+  if (scaled >= DELTA_FIXED_LIMIT) return DELTA_FIXED_MAX;
+  if (scaled <= -DELTA_FIXED_LIMIT) return -DELTA_FIXED_MAX;
+  return lround(scaled);
+}
+
+/**
+ * Rebuild a reading from the integer of its field.
+ *
+ * @param stream The reading's stream.
+ * @param fields The record's fields.
+ * @param field The field's index.
+ * @return The reading, or NaN for DELTA_NO_READING.
+ */
+static float fromFixed(DeltaStream stream, const int32_t *fields,
+                       byte field) {
+  if (fields[field] == DELTA_NO_READING) return NAN;
+  return float(fields[field]) /
+         pgm_read_float(&POWERS_OF_TEN[deltaFieldDecimals(stream, field)]);
+}
+
+/**
+ * Get the ground station record name of a stream.
+ *
+ * @param stream The stream.
+ * @return "DMPU", "DMPL" or "DGPS", or "" for an unknown stream.
+ */
+const char *deltaStreamName(DeltaStream stream) {
+  return stream < DELTA_STREAM_COUNT ? STREAM_NAMES[stream] : "";
+}
+
+/**
+ * Find the stream of a ground station record name.
+ *
+ * @param name The record's name, e.g. "DMPU".
+ * @return The stream, or DELTA_STREAM_COUNT if the name is not one.
+ */
+DeltaStream deltaStreamFromName(const char *name) {
+  for (byte i = 0; i < DELTA_STREAM_COUNT; i++) {
+    if (strcmp(name, STREAM_NAMES[i]) == 0) return DeltaStream(i);
+  }
+  return DELTA_STREAM_COUNT;
+}
+
+/**
+ * Get the number of fields in a stream's records.
+ *
+ * @param stream The stream.
+ * @return The number of fields, or 0 for an unknown stream.
+ */
+byte deltaFieldCount(DeltaStream stream) {
+  return stream < DELTA_STREAM_COUNT ? FIELD_COUNTS[stream] : 0;
+}
+
+/**
+ * Get the decimals a field of a stream's records keeps.
+ *
+ * @param stream The stream.
+ * @param field The field's index, e.g. 3 for an MPU record's gyroX.
+ * @return The field is the reading times 10 to this power: 3 for the gyro,
+ * 2 for the other MPU and MPL fields, 0 for GPS fields and unknown fields.
+ */
+byte deltaFieldDecimals(DeltaStream stream, byte field) {
+  if (field >= deltaFieldCount(stream)) return 0;
+  return pgm_read_byte(&FIELD_DECIMALS[stream][field]);
+}
+
+/**
+ * Scale an MPU reading to the fields of a DMPU record.
+ *
+ * @param data The reading.
+ * @param fields Receives the 7 fields.
+ */
+void toDeltaFields(const MPUData &data, int32_t *fields) {
+  const float values[] = {data.accelX, data.accelY, data.accelZ, data.gyroX,
+                          data.gyroY,  data.gyroZ,  data.temp};
+  for (byte i = 0; i < 7; i++) fields[i] = toFixed(DELTA_MPU, i, values[i]);
+}
+
+/**
+ * Scale an MPL reading to the fields of a DMPL record.
+ *
+ * @param data The reading.
+ * @param fields Receives the 3 fields.
+ */
+void toDeltaFields(const MPLData &data, int32_t *fields) {
+  fields[0] = toFixed(DELTA_MPL, 0, data.pressure);
+  fields[1] = toFixed(DELTA_MPL, 1, data.altitude);
+  fields[2] = toFixed(DELTA_MPL, 2, data.temperature);
+}
+
+/**
+ * Copy a GPS fix to the fields of a DGPS record.
+ *
+ * @param data The fix.
+ * @param fields Receives the 6 fields.
+ */
+void toDeltaFields(const GPSData &data, int32_t *fields) {
+  fields[0] = data.lat;
+  fields[1] = data.lon;
+  fields[2] = int32_t(data.dateTime);
+  fields[3] = data.speed;
+  fields[4] = data.distanceFromHome;
+  fields[5] = data.nSats;
+}
+
+/**
+ * Rebuild an MPU reading from the fields of a DMPU record.
+ *
+ * @param fields The 7 fields.
+ * @param data Receives the reading.
+ */
+void fromDeltaFields(const int32_t *fields, MPUData &data) {
+  data = {.accelX = fromFixed(DELTA_MPU, fields, 0),
+          .accelY = fromFixed(DELTA_MPU, fields, 1),
+          .accelZ = fromFixed(DELTA_MPU, fields, 2),
+          .gyroX = fromFixed(DELTA_MPU, fields, 3),
+          .gyroY = fromFixed(DELTA_MPU, fields, 4),
+          .gyroZ = fromFixed(DELTA_MPU, fields, 5),
+          .temp = fromFixed(DELTA_MPU, fields, 6)};
+}
+
+/**
+ * Rebuild an MPL reading from the fields of a DMPL record.
+ *
+ * @param fields The 3 fields.
+ * @param data Receives the reading.
+ */
+void fromDeltaFields(const int32_t *fields, MPLData &data) {
+  data = {.pressure = fromFixed(DELTA_MPL, fields, 0),
+          .altitude = fromFixed(DELTA_MPL, fields, 1),
+          .temperature = fromFixed(DELTA_MPL, fields, 2)};
+}
+
+/**
+ * Rebuild a GPS fix from the fields of a DGPS record.
+ *
+ * @param fields The 6 fields.
+ * @param data Receives the fix.
+ */
+void fromDeltaFields(const int32_t *fields, GPSData &data) {
+  data = {.lat = fields[0],
+          .lon = fields[1],
+          .dateTime = uint32_t(fields[2]),
+          .speed = uint16_t(fields[3]),
+          .distanceFromHome = uint16_t(fields[4]),
+          .nSats = uint8_t(fields[5])};
+}
+
+/**
+ * Forget the previous samples, so that every stream starts with a key
+ * record.
+ */
+void NyarkoaDeltaEncoder::reset() {
+  memset(mpu, 0, sizeof(mpu));
+  memset(mpl, 0, sizeof(mpl));
+  memset(gps, 0, sizeof(gps));
+  memset(count, 0, sizeof(count));
+  memset(sinceKey, NYARKOA_DELTA_KEY_INTERVAL, sizeof(sinceKey));
+}
+
+/**
+ * Make the next record of every stream a key record.
+ *
+ * Call this when records may have been lost on their way to the ground
+ * station, e.g. dropped from a full queue.
+ */
+void NyarkoaDeltaEncoder::requestKey() {
+  memset(sinceKey, NYARKOA_DELTA_KEY_INTERVAL, sizeof(sinceKey));
+}
+
+/**
+ * Find the previous sample of a stream.
+ *
+ * @param stream The stream.
+ * @return Its fields.
+ */
+int32_t *NyarkoaDeltaEncoder::previous(DeltaStream stream) {
+  if (stream == DELTA_MPU) return mpu;
+  return stream == DELTA_MPL ? mpl : gps;
+}
+
+/**
+ * Encode a sample as a delta record.
+ *
+ * @param stream The sample's stream.
+ * @param fields The sample's fields, deltaFieldCount(stream) of them.
+ * @param text Receives the record's text, NUL-terminated.
+ * @param size The size of `text`; DELTA_TEXT_SIZE always suffices.
+ * @return The length of the text, or 0 if the stream is unknown or `text`
+ * is too small for the longest record. The sample is then not encoded.
+ */
+size_t NyarkoaDeltaEncoder::encode(DeltaStream stream, const int32_t *fields,
+                                   char *text, size_t size) {
+  if (stream >= DELTA_STREAM_COUNT || size < DELTA_TEXT_SIZE) return 0;
+  int32_t *last = previous(stream);
+  bool isKey = sinceKey[stream] >= NYARKOA_DELTA_KEY_INTERVAL;
+  size_t length = 0;
+  text[length++] = toDigit((isKey ? DELTA_KEY : 0) |
+                           (count[stream] & DELTA_COUNT_MASK));
+  if (isKey) text[length++] = toDigit((count[stream] >> 5) & 63);
+  for (byte i = 0; i < FIELD_COUNTS[stream]; i++) {
+    uint32_t base = isKey ? 0 : uint32_t(last[i]);
+    length += writeVarint(uint32_t(fields[i]) - base, text + length);
+    last[i] = fields[i];
+  }
+  text[length] = '\0';
+  count[stream]++;
+  sinceKey[stream] = isKey ? 1 : sinceKey[stream] + 1;
+  return length;
+}
+
+/**
+ * Encode an MPU reading as a DMPU record.
+ *
+ * @param data The reading.
+ * @param text Receives the record's text, NUL-terminated.
+ * @param size The size of `text`, at least DELTA_TEXT_SIZE.
+ * @return The length of the text, or 0 if `text` is too small.
+ */
+size_t NyarkoaDeltaEncoder::encode(const MPUData &data, char *text,
+                                   size_t size) {
+  int32_t fields[7];
+  toDeltaFields(data, fields);
+  return encode(DELTA_MPU, fields, text, size);
+}
+
+/**
+ * Encode an MPL reading as a DMPL record.
+ *
+ * @param data The reading.
+ * @param text Receives the record's text, NUL-terminated.
+ * @param size The size of `text`, at least DELTA_TEXT_SIZE.
+ * @return The length of the text, or 0 if `text` is too small.
+ */
+size_t NyarkoaDeltaEncoder::encode(const MPLData &data, char *text,
+                                   size_t size) {
+  int32_t fields[3];
+  toDeltaFields(data, fields);
+  return encode(DELTA_MPL, fields, text, size);
+}
+
+/**
+ * Encode a GPS fix as a DGPS record.
+ *
+ * @param data The fix.
+ * @param text Receives the record's text, NUL-terminated.
+ * @param size The size of `text`, at least DELTA_TEXT_SIZE.
+ * @return The length of the text, or 0 if `text` is too small.
+ */
+size_t NyarkoaDeltaEncoder::encode(const GPSData &data, char *text,
+                                   size_t size) {
+  int32_t fields[6];
+  toDeltaFields(data, fields);
+  return encode(DELTA_GPS, fields, text, size);
+}
+
+/**
+ * Forget every stream, so that each is read again from its next key record.
+ */
+void NyarkoaDeltaDecoder::reset() {
+  memset(values, 0, sizeof(values));
+  memset(next, 0, sizeof(next));
+  memset(synced, 0, sizeof(synced));
+  memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Decode a delta record.
+ *
+ * @param stream The record's stream, e.g. from deltaStreamFromName.
+ * @param text The record's text.
+ * @param fields Receives the sample's fields, deltaFieldCount(stream) of
+ * them, exactly as they were encoded.
+ * @return true if the sample was decoded; false if the record cannot be
+ * read, follows a missing record of its stream or repeats one.
+ */
+bool NyarkoaDeltaDecoder::decode(DeltaStream stream, const char *text,
+                                 int32_t *fields) {
+  int header = stream < DELTA_STREAM_COUNT ? fromDigit(*text) : -1;
+  if (header < 0) {
+    stats.invalid++;
+    return false;
+  }
+  text++;
+  bool isKey = header & DELTA_KEY;
+  uint16_t index = header & DELTA_COUNT_MASK;
+  uint16_t mask = DELTA_COUNT_MASK;
+  if (isKey) {
+    int high = fromDigit(*text);
+    if (high < 0) {
+      stats.invalid++;
+      return false;
+    }
+    text++;
+    index |= high << 5;
+    mask = DELTA_KEY_COUNT_MASK;
+  }
+  uint16_t ahead = (index - next[stream]) & mask;
+  if (synced[stream] && ahead > mask - DELTA_REPEAT_WINDOW) {
+    stats.repeated++;
+    return false;
+  }
+  if (!isKey && (!synced[stream] || ahead != 0)) {
+    synced[stream] = false;
+    stats.skipped++;
+    return false;
+  }
+
+  int32_t decoded[DELTA_MAX_FIELDS];
+  for (byte i = 0; i < FIELD_COUNTS[stream]; i++) {
+    uint32_t delta;
+    if (!readVarint(text, delta)) {
+      stats.invalid++;
+      return false;
+    }
+    uint32_t base = isKey ? 0 : uint32_t(values[stream][i]);
+    decoded[i] = int32_t(base + delta);
+  }
+  if (*text != '\0') {
+    stats.invalid++;
+    return false;
+  }
+  for (byte i = 0; i < FIELD_COUNTS[stream]; i++) {
+    values[stream][i] = fields[i] = decoded[i];
+  }
+  next[stream] = ((isKey ? index : next[stream]) + 1) & DELTA_KEY_COUNT_MASK;
+  synced[stream] = true;
+  stats.records++;
+  return true;
+}
+
+/**
+ * Decode a DMPU record.
+ *
+ * @param text The record's text.
+ * @param data Receives the reading.
+ * @return true if the reading was decoded; otherwise, false.
+ */
+bool NyarkoaDeltaDecoder::decode(const char *text, MPUData &data) {
+  int32_t fields[7];
+  if (!decode(DELTA_MPU, text, fields)) return false;
+  fromDeltaFields(fields, data);
+  return true;
+}
+
+/**
+ * Decode a DMPL record.
+ *
+ * @param text The record's text.
+ * @param data Receives the reading.
+ * @return true if the reading was decoded; otherwise, false.
+ */
+bool NyarkoaDeltaDecoder::decode(const char *text, MPLData &data) {
+  int32_t fields[3];
+  if (!decode(DELTA_MPL, text, fields)) return false;
+  fromDeltaFields(fields, data);
+  return true;
+}
+
+/**
+ * Decode a DGPS record.
+ *
+ * @param text The record's text.
+ * @param data Receives the fix.
+ * @return true if the fix was decoded; otherwise, false.
+ */
+bool NyarkoaDeltaDecoder::decode(const char *text, GPSData &data) {
+  int32_t fields[6];
+  if (!decode(DELTA_GPS, text, fields)) return false;
+  fromDeltaFields(fields, data);
+  return true;
+}
@@ -0,0 +1,119 @@
+#ifndef NYARKOA_DELTA_H
+#define NYARKOA_DELTA_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+#include <NyarkoaTypes.h>
+
+/*
+ * Compact text encoding of sensor samples for the ground station downlink.
+ *
+ *   RECORD: HEADER | FIELD...
+ *
+ * Each field is scaled to an integer by its stream's scale table (see
+ * deltaFieldDecimals: 3 decimals for the gyro, 2 for the other floats; GPS
+ * fields are integers already), taken as the difference from the same field
+ * of the stream's previous sample, and
+ * written as a zigzag varint in base-64 digits "0-9A-Za-z-_": every digit
+ * holds 5 bits, least significant first, plus 32 if another digit follows.
+ * A change of -16 to 15 takes one digit. The text holds no ':', ';', '*' or
+ * line ends, so it travels as a ground station record on every link.
+ *
+ * A float beyond the range of a field is clamped to +-DELTA_FIXED_MAX, and
+ * NaN, a reading the sensor could not take, is sent as DELTA_NO_READING
+ * and read back as NaN.
+ *
+ * HEADER counts the stream's records. Its first digit holds the count's
+ * bits 0-4, plus 32 for a key record, whose fields are differences from 0;
+ * a key record adds a digit with bits 5-10. The first record and every
+ * NYARKOA_DELTA_KEY_INTERVAL-th record are key records, so a decoder that
+ * missed a record picks the stream up again at the next one.
+ *
+ * MPU records hold accelX, accelY, accelZ, gyroX, gyroY, gyroZ and temp;
+ * MPL records pressure, altitude and temperature; GPS records lat, lon,
+ * dateTime (packed, see NyarkoaGPS.h), speed, distanceFromHome and nSats.
+ */
+enum DeltaStream : byte { DELTA_MPU, DELTA_MPL, DELTA_GPS, DELTA_STREAM_COUNT };
+
+const int32_t DELTA_FIXED_MAX{2147483647L};
+const int32_t DELTA_NO_READING{-DELTA_FIXED_MAX - 1};  // field of a NaN
+const byte DELTA_MAX_FIELDS{7};
+const byte DELTA_VARINT_MAX{7};  // digits of a 32-bit field
+// Longest record, including the terminating NUL.
+const byte DELTA_TEXT_SIZE{2 + DELTA_MAX_FIELDS * DELTA_VARINT_MAX + 1};
+
+const char *deltaStreamName(DeltaStream stream);
+DeltaStream deltaStreamFromName(const char *name);
+byte deltaFieldCount(DeltaStream stream);
+byte deltaFieldDecimals(DeltaStream stream, byte field);
+
+void toDeltaFields(const MPUData &data, int32_t *fields);
+void toDeltaFields(const MPLData &data, int32_t *fields);
+void toDeltaFields(const GPSData &data, int32_t *fields);
+void fromDeltaFields(const int32_t *fields, MPUData &data);
+void fromDeltaFields(const int32_t *fields, MPLData &data);
+void fromDeltaFields(const int32_t *fields, GPSData &data);
+
+/**
+ * Encoder of sensor samples as delta records.
+ *
+ * It keeps the previous sample of each stream, 64 bytes in all, and encodes
+ * a sample in a fixed number of steps, without floating point division or
+ * heap allocation.
+ */
+class NyarkoaDeltaEncoder {
+ public:
+  NyarkoaDeltaEncoder() { reset(); }
+
+  void reset();
+  void requestKey();
+  size_t encode(DeltaStream stream, const int32_t *fields, char *text,
+                size_t size);
+  size_t encode(const MPUData &data, char *text, size_t size);
+  size_t encode(const MPLData &data, char *text, size_t size);
+  size_t encode(const GPSData &data, char *text, size_t size);
+
+ private:
+  int32_t mpu[7];
+  int32_t mpl[3];
+  int32_t gps[6];
+  uint16_t count[DELTA_STREAM_COUNT];  // records encoded, for the HEADER
+  byte sinceKey[DELTA_STREAM_COUNT];   // records since the last key record
+
+  int32_t *previous(DeltaStream stream);
+};
+
+struct DeltaStats {
+  unsigned long records;   // records decoded
+  unsigned long skipped;   // records between a missing one and a key record
+  unsigned long repeated;  // records received again, e.g. in a batch whose
+                           // acknowledgement was lost
+  unsigned long invalid;   // records that could not be read
+};
+
+/**
+ * Decoder of the records written by NyarkoaDeltaEncoder.
+ *
+ * Records of each stream must be decoded in the order they were encoded.
+ * When one is missing, the stream's delta records are skipped until its
+ * next key record. A record up to 16 records older than the last one decoded
+ * is taken as a repeat and ignored.
+ */
+class NyarkoaDeltaDecoder {
+ public:
+  NyarkoaDeltaDecoder() { reset(); }
+
+  void reset();
+  bool decode(DeltaStream stream, const char *text, int32_t *fields);
+  bool decode(const char *text, MPUData &data);
+  bool decode(const char *text, MPLData &data);
+  bool decode(const char *text, GPSData &data);
+  const DeltaStats &getStats() const { return stats; }
+
+ private:
+  int32_t values[DELTA_STREAM_COUNT][DELTA_MAX_FIELDS];
+  uint16_t next[DELTA_STREAM_COUNT];  // HEADER count expected next
+  bool synced[DELTA_STREAM_COUNT];
+  DeltaStats stats;
+};
+
+#endif
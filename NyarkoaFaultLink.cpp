@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include <NyarkoaFaultLink.h>
+
+NyarkoaFaultLink::NyarkoaFaultLink(Stream &inner)
+    : NyarkoaFaultLink(inner, noFaults()) {}
+
+NyarkoaFaultLink::NyarkoaFaultLink(Stream &inner,
+                                   const FaultLinkConfig &config)
+    : inner(inner) {
+  setConfig(config);
+  resetStats();
+}
+
+/**
+ * Get the settings of a clean link.
+ *
+ * @return Settings that pass every byte unchanged, with seed 1.
+ */
+FaultLinkConfig NyarkoaFaultLink::noFaults() {
+  return {.seed = 1,
+          .lossPpm = 0,
+          .bitErrorPpm = 0,
+          .duplicatePpm = 0,
+          .truncatePpm = 0,
+          .stallPpm = 0,
+          .stallMicros = 0};
+}
+
+/**
+ * Change the faults of the link.
+ *
+ * @param newConfig The new settings.
+ *
+ * The generator restarts from the new seed, so the same settings always
+ * damage the same bytes of the same traffic. A stall or truncation in
+ * progress ends.
+ */
+void NyarkoaFaultLink::setConfig(const FaultLinkConfig &newConfig) {
+  config = newConfig;
+  state = config.seed ? config.seed : 1;
+  rxTruncating = false;
+  txTruncating = false;
+  stalled = false;
+}
+
+/**
+ * Clear the fault counters.
+ */
+void NyarkoaFaultLink::resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+/**
+ * Draw the next number of the link's generator (xorshift32).
+ *
+ * @return A pseudo-random 32-bit number.
+ */
+uint32_t NyarkoaFaultLink::nextRandom() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/**
+ * Decide whether a fault strikes the current byte.
+ *
+ * @param ppm The chance of the fault, in parts per million.
+ * @return true if it strikes.
+ *
+ * Faults that are switched off draw nothing from the generator, so turning
+ * one fault on leaves the bytes struck by the others in place.
+ */
+bool NyarkoaFaultLink::strikes(uint32_t ppm) {
+  return ppm != 0 && nextRandom() % 1000000UL < ppm;
+}
+
+/**
+ * Pass one byte through the faults.
+ *
+ * @param data The byte as sent.
+ * @param truncating The truncation state of the byte's direction; it is set
+ * when a line or frame is cut short and cleared at the next boundary.
+ * @param copies Receives how many times the byte is delivered.
+ * @return The byte as delivered, or -1 if it is lost.
+ */
+int NyarkoaFaultLink::damage(byte data, bool &truncating, byte &copies) {
+  copies = 1;
+  bool boundary = data == '\r' || data == '\n' || data == FRAME_SYNC;
+  if (truncating) {
+    if (!boundary) return -1;
+    truncating = false;
+  }
+  if (strikes(config.stallPpm)) {
+    stalled = true;
+    stallEnd = micros() + config.stallMicros;
+    stats.stalls++;
+  }
+  if (strikes(config.truncatePpm)) {
+    truncating = true;
+    stats.truncated++;
+    return -1;
+  }
+  if (strikes(config.lossPpm)) {
+    stats.lost++;
+    return -1;
+  }
+  if (strikes(config.bitErrorPpm)) {
+    data ^= byte(1 << (nextRandom() % 8));
+    stats.flipped++;
+  }
+  if (strikes(config.duplicatePpm)) {
+    copies = 2;
+    stats.duplicated++;
+  }
+  stats.bytes++;
+  return data;
+}
+
+/**
+ * Check whether a stall is holding back the bytes for the payload.
+ *
+ * @return true until the stall has lasted `stallMicros`.
+ */
+bool NyarkoaFaultLink::isStalled() {
+  if (stalled && long(micros() - stallEnd) >= 0) stalled = false;
+  return stalled;
+}
+
+/**
+ * Check whether the payload has a byte to read.
+ *
+ * @return The number of copies of the next byte; further bytes are damaged
+ * only as they are reached, so they are not counted yet.
+ */
+int NyarkoaFaultLink::available() {
+  while (pending < 0 && inner.available()) {
+    byte copies;
+    pending = damage(inner.read(), rxTruncating, copies);
+    repeats = copies - 1;
+  }
+  if (pending < 0 || isStalled()) return 0;
+  return 1 + repeats;
+}
+
+/**
+ * Read the next byte for the payload.
+ *
+ * @return The byte, or -1 if none has arrived.
+ */
+int NyarkoaFaultLink::read() {
+  if (!available()) return -1;
+  int data = pending;
+  if (repeats > 0) {
+    repeats--;
+  } else {
+    pending = -1;
+  }
+  return data;
+}
+
+/**
+ * Look at the next byte for the payload without reading it.
+ *
+ * @return The byte, or -1 if none has arrived.
+ */
+int NyarkoaFaultLink::peek() { return available() ? pending : -1; }
+
+/**
+ * Send a byte from the payload to the module.
+ *
+ * @param data The byte to send.
+ * @return 1, also when the fault link loses the byte, as the payload cannot
+ * tell that it was lost.
+ */
+size_t NyarkoaFaultLink::write(uint8_t data) {
+  byte copies;
+  int damaged = damage(data, txTruncating, copies);
+  for (; damaged >= 0 && copies > 0; copies--) inner.write(byte(damaged));
+  return 1;
+}
@@ -0,0 +1,82 @@
+#ifndef NYARKOA_FAULT_LINK_H
+#define NYARKOA_FAULT_LINK_H
+#include <Arduino.h>
+#include <NyarkoaFrame.h>
+
+/*
+ * Stream that damages the bytes passing through it.
+ *
+ * The fault link sits between the payload and the stream of the comm module,
+ * such as a serial port or a NyarkoaCommSim, and passes bytes both ways with
+ * the faults of a noisy UART or radio link:
+ *
+ *   - loss: a byte disappears;
+ *   - bit errors: a byte arrives with one bit flipped;
+ *   - duplication: a byte arrives twice;
+ *   - truncation: a line or frame is cut short, losing its bytes up to the
+ *     next CR, LF or FRAME_SYNC;
+ *   - stalls: nothing reaches the payload for a set time, as when the radio
+ *     fades or the module is busy.
+ *
+ * Each fault strikes a byte with a chance given in parts per million. The
+ * chances are drawn from the link's own generator, seeded from the settings,
+ * so a run can be repeated exactly and random() is left to the rest of the
+ * program.
+ */
+struct FaultLinkConfig {
+  uint32_t seed;
+  uint32_t lossPpm;          // bytes lost
+  uint32_t bitErrorPpm;      // bytes with one bit flipped
+  uint32_t duplicatePpm;     // bytes delivered twice
+  uint32_t truncatePpm;      // bytes that cut their line or frame short
+  uint32_t stallPpm;         // bytes after which the link stalls
+  unsigned long stallMicros; // how long a stall lasts
+};
+
+struct FaultLinkStats {
+  unsigned long bytes;       // bytes passed on, in either direction
+  unsigned long lost;
+  unsigned long flipped;
+  unsigned long duplicated;
+  unsigned long truncated;   // lines or frames cut short
+  unsigned long stalls;
+};
+
+class NyarkoaFaultLink : public Stream {
+ public:
+  explicit NyarkoaFaultLink(Stream &inner);
+  NyarkoaFaultLink(Stream &inner, const FaultLinkConfig &config);
+
+  void setConfig(const FaultLinkConfig &config);
+  const FaultLinkConfig &getConfig() const { return config; }
+  const FaultLinkStats &getStats() const { return stats; }
+  void resetStats();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t data) override;
+  void flush() override { inner.flush(); }
+  using Print::write;
+
+  static FaultLinkConfig noFaults();
+
+ private:
+  Stream &inner;
+  FaultLinkConfig config;
+  FaultLinkStats stats;
+  uint32_t state;
+  int pending{-1};  // next byte for the payload, already damaged
+  byte repeats{0};  // further copies of `pending` still to deliver
+  bool rxTruncating{false};
+  bool txTruncating{false};
+  bool stalled{false};
+  unsigned long stallEnd{0};
+
+  uint32_t nextRandom();
+  bool strikes(uint32_t ppm);
+  int damage(byte data, bool &truncating, byte &copies);
+  bool isStalled();
+};
+
+#endif
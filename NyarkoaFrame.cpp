@@ -0,0 +1,290 @@
+#include <Arduino.h>
+#include <NyarkoaFrame.h>
+
+struct CommandSpec {
+  char name[11];
+  byte id;
+  byte args;
+  uint16_t timeout;  // response deadline in milliseconds
+  byte rttClass;     // commands whose answers take similar time
+};
+
+// Text command names understood by the comm module, their frame encoding and
+// how long the module may take to answer them. Sensor and clock reads are
+// served locally by the module; actuators and ground station traffic take
+// longer. Commands in the same RTT class share a round-trip time estimate.
+static const CommandSpec COMMANDS[] PROGMEM = {
+    {"AT_EJECT", CMD_EJECT, ARGS_NONE, 2000, RTT_ACTION},
+    {"AT_ALERT", CMD_ALERT, ARGS_U32, 1000, RTT_ACTION},
+    {"AT_EN_BEC", CMD_EN_BEACON, ARGS_NONE, 1000, RTT_ACTION},
+    {"AT_DIS_BEC", CMD_DIS_BEACON, ARGS_NONE, 1000, RTT_ACTION},
+    {"AT_DATE", CMD_DATE, ARGS_NONE, 500, RTT_QUERY},
+    {"AT_TIME", CMD_TIME, ARGS_NONE, 500, RTT_QUERY},
+    {"AT_TSTAMP", CMD_TSTAMP, ARGS_NONE, 500, RTT_QUERY},
+    {"AT_F_TIME", CMD_F_TIME, ARGS_I16X4, 500, RTT_QUERY},
+    {"AT_MPU", CMD_MPU, ARGS_NONE, 500, RTT_QUERY},
+    {"AT_MPL", CMD_MPL, ARGS_NONE, 500, RTT_QUERY},
+    {"AT_GPS", CMD_GPS, ARGS_NONE, 1000, RTT_BULK},
+    {"AT_ALL", CMD_ALL, ARGS_NONE, 1000, RTT_BULK},
+    {"GS", CMD_GS, ARGS_TEXT, 5000, RTT_GROUND},
+    {"AT_SUB", CMD_SUB, ARGS_SUB, 500, RTT_QUERY}};
+
+static_assert(sizeof(COMMANDS) / sizeof(COMMANDS[0]) == COMMAND_COUNT,
+              "COMMAND_COUNT must match the command table");
+
+/**
+ * Look up a command name in the command table.
+ *
+ * @param name The start of the name, e.g. "AT_ALERT".
+ * @param nameLength The length of the name.
+ * @return The command's index in COMMANDS, or COMMAND_COUNT if unknown.
+ */
+static byte findName(const char *name, size_t nameLength) {
+  for (byte i = 0; i < COMMAND_COUNT; i++) {
+    if (strlen_P(COMMANDS[i].name) == nameLength &&
+        strncmp_P(name, COMMANDS[i].name, nameLength) == 0) {
+      return i;
+    }
+  }
+  return COMMAND_COUNT;
+}
+
+/**
+ * Look up a text command in the command table.
+ *
+ * @param text The command, e.g. "AT_ALERT:100".
+ * @param args Set to the text following the name's ':' separator.
+ * @return The command's index in COMMANDS, or COMMAND_COUNT if unknown.
+ */
+static byte findCommand(const char *text, const char **args) {
+  const char *sep = strchr(text, ':');
+  size_t nameLength = sep ? size_t(sep - text) : strlen(text);
+  *args = sep ? sep + 1 : "";
+  return findName(text, nameLength);
+}
+
+FrameParser::FrameParser() { reset(); }
+
+/**
+ * Discard any partially decoded frame and wait for the next sync byte.
+ */
+void FrameParser::reset() {
+  state = WAIT_SYNC;
+  index = 0;
+  crc = CRC16_INIT;
+  received = 0;
+  current.length = 0;
+}
+
+/**
+ * Feed one received byte to the decoder.
+ *
+ * @param data The byte read from the link.
+ * @return FRAME_COMPLETE once a whole frame with a valid CRC has been decoded
+ * (available through frame()), FRAME_CORRUPT when a frame failed its CRC or
+ * announced an impossible length, and FRAME_INCOMPLETE otherwise.
+ */
+FrameStatus FrameParser::feed(byte data) {
+  switch (state) {
+    case WAIT_SYNC:
+      if (data == FRAME_SYNC) {
+        crc = CRC16_INIT;
+        state = READ_LENGTH;
+      }
+      return FRAME_INCOMPLETE;
+    case READ_LENGTH:
+      if (data > FRAME_MAX_PAYLOAD) {
+        reset();
+        return FRAME_CORRUPT;
+      }
+      current.length = data;
+      crc = crc16Update(crc, data);
+      state = READ_CMD;
+      return FRAME_INCOMPLETE;
+    case READ_CMD:
+      current.cmd = data;
+      crc = crc16Update(crc, data);
+      state = READ_SEQ;
+      return FRAME_INCOMPLETE;
+    case READ_SEQ:
+      current.seq = data;
+      crc = crc16Update(crc, data);
+      index = 0;
+      state = current.length ? READ_PAYLOAD : READ_CRC_LOW;
+      return FRAME_INCOMPLETE;
+    case READ_PAYLOAD:
+      current.payload[index++] = data;
+      crc = crc16Update(crc, data);
+      if (index >= current.length) state = READ_CRC_LOW;
+      return FRAME_INCOMPLETE;
+    case READ_CRC_LOW:
+      received = data;
+      state = READ_CRC_HIGH;
+      return FRAME_INCOMPLETE;
+    case READ_CRC_HIGH:
+      received |= uint16_t(data) << 8;
+      state = WAIT_SYNC;
+      return received == crc ? FRAME_COMPLETE : FRAME_CORRUPT;
+  }
+  return FRAME_INCOMPLETE;
+}
+
+/**
+ * Write a frame to the link.
+ *
+ * @param out The stream connected to the communication module.
+ * @param frame The frame to send.
+ * @return The number of bytes written.
+ */
+size_t writeFrame(Print &out, const Frame &frame) {
+  byte header[FRAME_HEADER_SIZE] = {FRAME_SYNC, frame.length, frame.cmd,
+                                    frame.seq};
+  uint16_t crc = crc16(header + 1, FRAME_HEADER_SIZE - 1);
+  crc = crc16(frame.payload, frame.length, crc);
+  byte trailer[FRAME_CRC_SIZE] = {byte(crc & 0xFF), byte(crc >> 8)};
+
+  size_t written = out.write(header, FRAME_HEADER_SIZE);
+  written += out.write(frame.payload, frame.length);
+  written += out.write(trailer, FRAME_CRC_SIZE);
+  return written;
+}
+
+/**
+ * Translate a text command into a binary frame.
+ *
+ * The command name selects the command ID and the text arguments following
+ * the ':' separator are packed according to the command's argument layout.
+ * The sequence number is left for the caller to assign.
+ *
+ * @param text The command in the text protocol's form, e.g. "AT_ALERT:100".
+ * @param frame The frame to fill.
+ * @return true if the command is known and its arguments fit; otherwise,
+ * false.
+ */
+bool encodeCommand(const char *text, Frame &frame) {
+  const char *args;
+  byte index = findCommand(text, &args);
+  if (index == COMMAND_COUNT) return false;
+
+  frame.cmd = pgm_read_byte(&COMMANDS[index].id);
+  frame.length = 0;
+
+  switch (pgm_read_byte(&COMMANDS[index].args)) {
+    case ARGS_U32: {
+      uint32_t value = strtoul(args, nullptr, 10);
+      for (byte b = 0; b < 4; b++) frame.payload[b] = byte(value >> (8 * b));
+      frame.length = 4;
+      break;
+    }
+    case ARGS_I16X4: {
+      char *end = const_cast<char *>(args);
+      for (byte n = 0; n < 4; n++) {
+        int16_t value = int16_t(strtol(end, &end, 10));
+        frame.payload[2 * n] = byte(value & 0xFF);
+        frame.payload[2 * n + 1] = byte(uint16_t(value) >> 8);
+        if (*end == ',') end++;
+      }
+      frame.length = 8;
+      break;
+    }
+    case ARGS_TEXT: {
+      if (*args == ':') args++;  // "GS::" uses a double separator
+      size_t length = strlen(args);
+      if (length > FRAME_MAX_PAYLOAD) return false;
+      memcpy(frame.payload, args, length);
+      frame.length = byte(length);
+      break;
+    }
+    case ARGS_SUB: {
+      const char *comma = strchr(args, ',');
+      if (comma == nullptr) return false;
+      byte sensor = findName(args, comma - args);
+      if (sensor == COMMAND_COUNT) return false;
+      uint16_t period = uint16_t(strtoul(comma + 1, nullptr, 10));
+      frame.payload[0] = pgm_read_byte(&COMMANDS[sensor].id);
+      frame.payload[1] = byte(period & 0xFF);
+      frame.payload[2] = byte(period >> 8);
+      frame.length = 3;
+      break;
+    }
+    default:
+      break;
+  }
+  return true;
+}
+
+/**
+ * Get the response deadline of a command.
+ *
+ * @param text The command in text form, with or without arguments.
+ * @return The time in milliseconds the module may take to answer, or 0 if the
+ * command is not in the command table.
+ */
+unsigned long commandTimeout(const char *text) {
+  const char *args;
+  byte index = findCommand(text, &args);
+  if (index == COMMAND_COUNT) return 0;
+  return pgm_read_word(&COMMANDS[index].timeout);
+}
+
+/**
+ * Find a text command's position in the command table.
+ *
+ * @param text The command in text form, with or without arguments.
+ * @return The command's index, from 0 to COMMAND_COUNT - 1, or COMMAND_COUNT
+ * if the command is not in the table.
+ */
+byte commandIndex(const char *text) {
+  const char *args;
+  return findCommand(text, &args);
+}
+
+/**
+ * Find a command ID's position in the command table.
+ *
+ * @param id The command ID, e.g. CMD_MPU.
+ * @return The command's index, or COMMAND_COUNT if the ID is unknown.
+ */
+byte commandIndex(CommandId id) {
+  for (byte i = 0; i < COMMAND_COUNT; i++) {
+    if (pgm_read_byte(&COMMANDS[i].id) == id) return i;
+  }
+  return COMMAND_COUNT;
+}
+
+/**
+ * Get the round-trip time class of a command.
+ *
+ * @param index The command's position in the command table.
+ * @return The command's RttClass, or RTT_CLASS_COUNT for an index outside
+ * the table.
+ */
+byte commandRttClass(byte index) {
+  if (index >= COMMAND_COUNT) return RTT_CLASS_COUNT;
+  return pgm_read_byte(&COMMANDS[index].rttClass);
+}
+
+/**
+ * Copy the name of a command.
+ *
+ * @param index The command's position in the command table.
+ * @param name Receives the name, e.g. "AT_ALERT"; it must hold 11 bytes.
+ * @return The name's length, or 0 for an index outside the table.
+ */
+byte commandName(byte index, char *name) {
+  name[0] = '\0';
+  if (index >= COMMAND_COUNT) return 0;
+  strcpy_P(name, COMMANDS[index].name);
+  return strlen(name);
+}
+
+/**
+ * Get the ID of a command.
+ *
+ * @param index The command's position in the command table.
+ * @return The command's ID, or CMD_NONE for an index outside the table.
+ */
+byte commandId(byte index) {
+  if (index >= COMMAND_COUNT) return CMD_NONE;
+  return pgm_read_byte(&COMMANDS[index].id);
+}
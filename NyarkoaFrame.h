@@ -0,0 +1,111 @@
+#ifndef NYARKOA_FRAME_H
+#define NYARKOA_FRAME_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+#include <NyarkoaCrc.h>
+
+/*
+ * Binary link frame exchanged with the Communication and Control Module.
+ *
+ *   SYNC | LEN | CMD | SEQ | PAYLOAD[LEN] | CRC16 (low byte first)
+ *
+ * The CRC (CRC-16/CCITT-FALSE) covers LEN, CMD, SEQ and the payload. A reply
+ * carries the request's SEQ and its CMD with FRAME_REPLY set; a module that
+ * cannot execute a request answers with CMD_NACK. Multi-byte values in a
+ * payload are little-endian, floats are IEEE-754 single precision.
+ *
+ * Requests never use SEQ 0. A frame with SEQ 0 is pushed by the module
+ * unasked: a sensor reading, in the same form as the reply to the sensor's
+ * command, sent at the rate set with CMD_SUB.
+ */
+const byte FRAME_SYNC{0xA5};
+const byte FRAME_REPLY{0x80};
+const byte FRAME_HEADER_SIZE{4};
+const byte FRAME_CRC_SIZE{2};
+const byte FRAME_MAX_PAYLOAD{NYARKOA_FRAME_PAYLOAD_SIZE};
+const byte FRAME_PUSH_SEQ{0};
+
+enum CommandId : byte {
+  CMD_NONE = 0x00,
+  CMD_EJECT = 0x01,
+  CMD_ALERT = 0x02,
+  CMD_EN_BEACON = 0x03,
+  CMD_DIS_BEACON = 0x04,
+  CMD_DATE = 0x10,
+  CMD_TIME = 0x11,
+  CMD_TSTAMP = 0x12,
+  CMD_F_TIME = 0x13,
+  CMD_MPU = 0x20,
+  CMD_MPL = 0x21,
+  CMD_GPS = 0x22,
+  CMD_ALL = 0x23,
+  CMD_GS = 0x30,
+  CMD_SUB = 0x40,
+  CMD_NACK = 0x7F
+};
+
+// Number of commands in the command table.
+const byte COMMAND_COUNT{14};
+
+// Commands whose answers take a similar time. The payload keeps one
+// round-trip time estimate per class to set its retransmission timeouts.
+enum RttClass : byte {
+  RTT_QUERY,   // clock and sensor reads with short replies
+  RTT_BULK,    // GPS and snapshot reads with long replies
+  RTT_ACTION,  // actuators
+  RTT_GROUND,  // messages relayed to the ground station
+  RTT_CLASS_COUNT
+};
+
+// How the text arguments of a command are packed into a frame payload.
+enum CommandArgs : byte {
+  ARGS_NONE,  // "AT_EJECT"
+  ARGS_U32,   // "AT_ALERT:100" -> uint32
+  ARGS_I16X4, // "AT_F_TIME:30,0,0,0" -> 4 x int16
+  ARGS_TEXT,  // "GS::cmd::payload" -> "cmd::payload" verbatim
+  ARGS_SUB    // "AT_SUB:AT_MPU,100" -> sensor command ID, uint16 period in ms
+};
+
+struct Frame {
+  byte cmd;
+  byte seq;
+  byte length;
+  byte payload[FRAME_MAX_PAYLOAD];
+};
+
+enum FrameStatus : byte { FRAME_INCOMPLETE, FRAME_COMPLETE, FRAME_CORRUPT };
+
+/**
+ * Incremental frame decoder.
+ *
+ * Bytes are fed one at a time as they arrive from the link; the decoder
+ * resynchronises on FRAME_SYNC after noise or a failed CRC, so it never
+ * needs more than one pass over the input.
+ */
+class FrameParser {
+ public:
+  FrameParser();
+  void reset();
+  FrameStatus feed(byte data);
+  const Frame &frame() const { return current; }
+
+ private:
+  enum State : byte { WAIT_SYNC, READ_LENGTH, READ_CMD, READ_SEQ, READ_PAYLOAD,
+                      READ_CRC_LOW, READ_CRC_HIGH };
+  State state;
+  byte index;
+  uint16_t crc;
+  uint16_t received;
+  Frame current;
+};
+
+size_t writeFrame(Print &out, const Frame &frame);
+bool encodeCommand(const char *text, Frame &frame);
+unsigned long commandTimeout(const char *text);
+byte commandIndex(const char *text);
+byte commandIndex(CommandId id);
+byte commandRttClass(byte index);
+byte commandId(byte index);
+byte commandName(byte index, char *name);
+
+#endif
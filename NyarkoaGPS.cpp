@@ -0,0 +1,257 @@
+#include <Arduino.h>
+#include <NyarkoaGPS.h>
+#include <stdio.h>
+
+const uint32_t DATE_MASK{0xFFFE0000UL};
+const uint32_t TIME_MASK{0x0001FFFFUL};
+
+/**
+ * Pack a UTC date and time into a GPSData dateTime word.
+ *
+ * @param year The year, 2000 to 2063.
+ * @param month The month, 1 to 12, or 0 if the date is unknown.
+ * @param day The day of the month, 1 to 31.
+ * @param hour The hour, 0 to 23.
+ * @param minute The minute, 0 to 59.
+ * @param second The second, 0 to 59.
+ * @return The packed date and time.
+ */
+uint32_t packGPSDateTime(uint16_t year, byte month, byte day, byte hour,
+                         byte minute, byte second) {
+  return (uint32_t(year - 2000) & 0x3F) << 26 | uint32_t(month & 0x0F) << 22 |
+         uint32_t(day & 0x1F) << 17 | uint32_t(hour & 0x1F) << 12 |
+         uint32_t(minute & 0x3F) << 6 | (second & 0x3F);
+}
+
+// Days from 2000-01-01 to a civil date, and back (proleptic Gregorian).
+static long daysFromDate(long year, long month, long day) {
+  year -= month <= 2;
+  long era = year / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra =
+      yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 730425;
+}
+
+static void dateFromDays(long days, long &year, long &month, long &day) {
+  days += 730425;
+  long era = days / 146097;
+  long dayOfEra = days - era * 146097;
+  long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                    dayOfEra / 146096) / 365;
+  long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 -
+                               yearOfEra / 100);
+  long monthIndex = (5 * dayOfYear + 2) / 153;
+  day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  year = yearOfEra + era * 400 + (month <= 2);
+}
+
+/**
+ * Convert a dateTime word to seconds since 2000-01-01 00:00:00.
+ *
+ * @param dateTime The packed date and time; its date must be known.
+ * @return The number of seconds.
+ */
+uint32_t gpsToSeconds(uint32_t dateTime) {
+  long days = daysFromDate(gpsYear(dateTime), gpsMonth(dateTime),
+                           gpsDay(dateTime));
+  return uint32_t(days) * 86400UL + gpsHour(dateTime) * 3600UL +
+         gpsMinute(dateTime) * 60UL + gpsSecond(dateTime);
+}
+
+/**
+ * Convert seconds since 2000-01-01 00:00:00 to a dateTime word.
+ *
+ * @param seconds The number of seconds, up to the end of 2063.
+ * @return The packed date and time.
+ */
+uint32_t gpsFromSeconds(uint32_t seconds) {
+  long year, month, day;
+  dateFromDays(seconds / 86400UL, year, month, day);
+  seconds %= 86400UL;
+  return packGPSDateTime(year, month, day, seconds / 3600, seconds / 60 % 60,
+                         seconds % 60);
+}
+
+// Read 'count' decimal digits; fails on anything else.
+static bool readDigits(const char *&text, byte count, uint16_t &value) {
+  value = 0;
+  for (byte i = 0; i < count; i++, text++) {
+    if (*text < '0' || *text > '9') return false;
+    value = value * 10 + (*text - '0');
+  }
+  return true;
+}
+
+/**
+ * Parse a "YYYY-MM-DD" date into the date bits of a dateTime word.
+ *
+ * An empty text means the module has no date yet and clears the date bits.
+ *
+ * @param text The date.
+ * @param dateTime The word whose date bits are replaced; the time bits are
+ * kept.
+ * @return true if the date was well-formed and in range; otherwise, false,
+ * and dateTime is unchanged.
+ */
+bool parseGPSDate(const char *text, uint32_t &dateTime) {
+  uint16_t year = 2000, month = 0, day = 0;
+  if (*text != '\0') {
+    if (!readDigits(text, 4, year) || *text++ != '-' ||
+        !readDigits(text, 2, month) || *text++ != '-' ||
+        !readDigits(text, 2, day) || *text != '\0')
+      return false;
+    if (year < 2000 || year > 2063 || month < 1 || month > 12 || day < 1 ||
+        day > 31)
+      return false;
+  }
+  dateTime = (dateTime & TIME_MASK) |
+             (packGPSDateTime(year, month, day, 0, 0, 0) & DATE_MASK);
+  return true;
+}
+
+/**
+ * Parse an "HH:MM:SS" time into the time bits of a dateTime word.
+ *
+ * An empty text means the module has no time yet and clears the time bits.
+ *
+ * @param text The time.
+ * @param dateTime The word whose time bits are replaced; the date bits are
+ * kept.
+ * @return true if the time was well-formed and in range; otherwise, false,
+ * and dateTime is unchanged.
+ */
+bool parseGPSTime(const char *text, uint32_t &dateTime) {
+  uint16_t hour = 0, minute = 0, second = 0;
+  if (*text != '\0') {
+    if (!readDigits(text, 2, hour) || *text++ != ':' ||
+        !readDigits(text, 2, minute) || *text++ != ':' ||
+        !readDigits(text, 2, second) || *text != '\0')
+      return false;
+    if (hour > 23 || minute > 59 || second > 59) return false;
+  }
+  dateTime = (dateTime & DATE_MASK) |
+             (packGPSDateTime(2000, 0, 0, hour, minute, second) & TIME_MASK);
+  return true;
+}
+
+/**
+ * Parse a "YYYY-MM-DD HH:MM:SS" timestamp into a dateTime word.
+ *
+ * @param text The timestamp.
+ * @param dateTime Receives the date and time.
+ * @return true if both parts were well-formed and in range; otherwise, false,
+ * and dateTime is unchanged.
+ */
+bool parseGPSTimestamp(const char *text, uint32_t &dateTime) {
+  const char *sep = strchr(text, ' ');
+  if (sep == nullptr || sep - text >= GPS_DATE_TEXT_SIZE) return false;
+  char date[GPS_DATE_TEXT_SIZE];
+  memcpy(date, text, sep - text);
+  date[sep - text] = '\0';
+
+  uint32_t parsed = 0;
+  if (!parseGPSDate(date, parsed) || !parseGPSTime(sep + 1, parsed)) {
+    return false;
+  }
+  dateTime = parsed;
+  return true;
+}
+
+/**
+ * Format a fixed-point coordinate as decimal degrees, e.g. "-0.1869640".
+ *
+ * @param value The coordinate in degrees scaled by GPS_COORD_SCALE.
+ * @param buffer Receives the text; GPS_COORD_TEXT_SIZE bytes always suffice.
+ * @param size The size of the buffer.
+ * @return The length of the text, as snprintf reports it.
+ */
+size_t formatGPSCoordinate(int32_t value, char *buffer, size_t size) {
+  uint32_t magnitude = value < 0 ? -uint32_t(value) : uint32_t(value);
+  return snprintf(buffer, size, "%s%lu.%07lu", value < 0 ? "-" : "",
+                  (unsigned long)(magnitude / GPS_COORD_SCALE),
+                  (unsigned long)(magnitude % GPS_COORD_SCALE));
+}
+
+/**
+ * Format the date of a dateTime word as "YYYY-MM-DD".
+ *
+ * @param dateTime The packed date and time.
+ * @param buffer Receives the text; GPS_DATE_TEXT_SIZE bytes always suffice.
+ * @param size The size of the buffer.
+ * @return The length of the text, as snprintf reports it.
+ */
+size_t formatGPSDate(uint32_t dateTime, char *buffer, size_t size) {
+  return snprintf(buffer, size, "%04u-%02u-%02u", gpsYear(dateTime),
+                  gpsMonth(dateTime), gpsDay(dateTime));
+}
+
+/**
+ * Format the time of a dateTime word as "HH:MM:SS".
+ *
+ * @param dateTime The packed date and time.
+ * @param buffer Receives the text; GPS_TIME_TEXT_SIZE bytes always suffice.
+ * @param size The size of the buffer.
+ * @return The length of the text, as snprintf reports it.
+ */
+size_t formatGPSTime(uint32_t dateTime, char *buffer, size_t size) {
+  return snprintf(buffer, size, "%02u:%02u:%02u", gpsHour(dateTime),
+                  gpsMinute(dateTime), gpsSecond(dateTime));
+}
+
+/**
+ * Format a dateTime word as "YYYY-MM-DD HH:MM:SS".
+ *
+ * @param dateTime The packed date and time.
+ * @param buffer Receives the text; GPS_TIMESTAMP_TEXT_SIZE bytes always
+ * suffice.
+ * @param size The size of the buffer.
+ * @return The length of the text, as snprintf reports it.
+ */
+size_t formatGPSTimestamp(uint32_t dateTime, char *buffer, size_t size) {
+  return snprintf(buffer, size, "%04u-%02u-%02u %02u:%02u:%02u",
+                  gpsYear(dateTime), gpsMonth(dateTime), gpsDay(dateTime),
+                  gpsHour(dateTime), gpsMinute(dateTime), gpsSecond(dateTime));
+}
+
+static void writeLE(byte *&out, uint32_t value, byte size) {
+  for (byte i = 0; i < size; i++, value >>= 8) *out++ = byte(value);
+}
+
+static uint32_t readLE(const byte *&in, byte size) {
+  uint32_t value = 0;
+  for (byte i = 0; i < size; i++) value |= uint32_t(*in++) << (8 * i);
+  return value;
+}
+
+/**
+ * Serialise a GPSData record in its GPS_RECORD_SIZE byte wire layout.
+ *
+ * @param gps The record.
+ * @param record Receives GPS_RECORD_SIZE bytes.
+ */
+void writeGPSRecord(const GPSData &gps, byte *record) {
+  writeLE(record, uint32_t(gps.lat), 4);
+  writeLE(record, uint32_t(gps.lon), 4);
+  writeLE(record, gps.dateTime, 4);
+  writeLE(record, gps.speed, 2);
+  writeLE(record, gps.distanceFromHome, 2);
+  writeLE(record, gps.nSats, 1);
+}
+
+/**
+ * Deserialise a GPSData record from its GPS_RECORD_SIZE byte wire layout.
+ *
+ * @param record GPS_RECORD_SIZE bytes as written by writeGPSRecord.
+ * @param gps Receives the record.
+ */
+void readGPSRecord(const byte *record, GPSData &gps) {
+  gps.lat = int32_t(readLE(record, 4));
+  gps.lon = int32_t(readLE(record, 4));
+  gps.dateTime = readLE(record, 4);
+  gps.speed = uint16_t(readLE(record, 2));
+  gps.distanceFromHome = uint16_t(readLE(record, 2));
+  gps.nSats = byte(readLE(record, 1));
+}
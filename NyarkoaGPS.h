@@ -0,0 +1,58 @@
+#ifndef NYARKOA_GPS_H
+#define NYARKOA_GPS_H
+#include <Arduino.h>
+#include <NyarkoaTypes.h>
+
+/*
+ * Helpers for the packed GPSData record.
+ *
+ * Coordinates are fixed-point degrees scaled by GPS_COORD_SCALE. The UTC date
+ * and time share one 32-bit word:
+ *
+ *   bits 31-26  year - 2000    bits 16-12  hour
+ *   bits 25-22  month          bits 11-6   minute
+ *   bits 21-17  day            bits  5-0   second
+ *
+ * A date the module has not acquired yet reads as month 0; an unknown time
+ * reads as 00:00:00.
+ *
+ * On a binary link the record travels as GPS_RECORD_SIZE bytes, little-endian:
+ *
+ *   lat (4) | lon (4) | dateTime (4) | speed (2) | distanceFromHome (2) |
+ *   nSats (1)
+ */
+const byte GPS_COORD_DECIMALS{7};
+const long GPS_COORD_SCALE{10000000L};
+const byte GPS_RECORD_SIZE{17};
+
+// Buffer sizes for the formatting helpers, including the terminating NUL.
+const byte GPS_COORD_TEXT_SIZE{13};  // "-180.0000000"
+const byte GPS_DATE_TEXT_SIZE{11};   // "2023-10-25"
+const byte GPS_TIME_TEXT_SIZE{9};    // "12:34:56"
+const byte GPS_TIMESTAMP_TEXT_SIZE{20};  // "2023-10-25 12:34:56"
+
+uint32_t packGPSDateTime(uint16_t year, byte month, byte day, byte hour,
+                         byte minute, byte second);
+inline uint16_t gpsYear(uint32_t dateTime) { return 2000 + (dateTime >> 26); }
+inline byte gpsMonth(uint32_t dateTime) { return (dateTime >> 22) & 0x0F; }
+inline byte gpsDay(uint32_t dateTime) { return (dateTime >> 17) & 0x1F; }
+inline byte gpsHour(uint32_t dateTime) { return (dateTime >> 12) & 0x1F; }
+inline byte gpsMinute(uint32_t dateTime) { return (dateTime >> 6) & 0x3F; }
+inline byte gpsSecond(uint32_t dateTime) { return dateTime & 0x3F; }
+
+uint32_t gpsToSeconds(uint32_t dateTime);
+uint32_t gpsFromSeconds(uint32_t seconds);
+
+bool parseGPSDate(const char *text, uint32_t &dateTime);
+bool parseGPSTime(const char *text, uint32_t &dateTime);
+bool parseGPSTimestamp(const char *text, uint32_t &dateTime);
+
+size_t formatGPSCoordinate(int32_t value, char *buffer, size_t size);
+size_t formatGPSDate(uint32_t dateTime, char *buffer, size_t size);
+size_t formatGPSTime(uint32_t dateTime, char *buffer, size_t size);
+size_t formatGPSTimestamp(uint32_t dateTime, char *buffer, size_t size);
+
+void writeGPSRecord(const GPSData &gps, byte *record);
+void readGPSRecord(const byte *record, GPSData &gps);
+
+#endif
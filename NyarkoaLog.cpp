@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include <NyarkoaLog.h>
+
+/**
+ * Print a message.
+ *
+ * @param level The message's level, from NYARKOA_LOG_ERROR to
+ * NYARKOA_LOG_DEBUG.
+ * @param text The message, wrapped in F().
+ * @param newline Whether to end the line after the message.
+ */
+void NyarkoaLogger::print(byte level, const __FlashStringHelper *text,
+                          bool newline) {
+  if (!isEnabled(level)) return;
+  Serial.print(text);
+  if (newline) Serial.print('\n');
+}
+
+/**
+ * Print a labelled message.
+ *
+ * The label and the text are printed one after the other, so no String is
+ * built to join them.
+ *
+ * @param level The message's level.
+ * @param label The label to print first, wrapped in F().
+ * @param text The text to print after the label.
+ */
+void NyarkoaLogger::print(byte level, const __FlashStringHelper *label,
+                          const char *text) {
+  if (!isEnabled(level)) return;
+  Serial.print(label);
+  Serial.print(text);
+  Serial.print('\n');
+}
+
+/**
+ * Print a labelled number.
+ *
+ * @param level The message's level.
+ * @param label The label to print before the number, wrapped in F().
+ * @param value The number, printed in decimal.
+ * @param suffix The text to print after the number, wrapped in F().
+ */
+void NyarkoaLogger::print(byte level, const __FlashStringHelper *label,
+                          unsigned long value,
+                          const __FlashStringHelper *suffix) {
+  if (!isEnabled(level)) return;
+  Serial.print(label);
+  Serial.print(value);
+  Serial.print(suffix);
+  Serial.print('\n');
+}
@@ -0,0 +1,55 @@
+#ifndef NYARKOA_LOG_H
+#define NYARKOA_LOG_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+
+/*
+ * Diagnostic output of the library.
+ *
+ * Messages are logged with the NLOG_* macros, which take the same arguments
+ * as NyarkoaLogger::print. Messages above NYARKOA_LOG_LEVEL
+ * (NyarkoaConfig.h) are removed by the preprocessor: neither their text,
+ * which lives in flash through F(), nor the evaluation of their arguments
+ * reaches the build. The messages that remain can be filtered at run time
+ * with NyarkoaLogger::setLevel.
+ */
+#if NYARKOA_LOG_LEVEL >= NYARKOA_LOG_ERROR
+#define NLOG_ERROR(...) logger.print(NYARKOA_LOG_ERROR, __VA_ARGS__)
+#else
+#define NLOG_ERROR(...) ((void)0)
+#endif
+
+#if NYARKOA_LOG_LEVEL >= NYARKOA_LOG_WARN
+#define NLOG_WARN(...) logger.print(NYARKOA_LOG_WARN, __VA_ARGS__)
+#else
+#define NLOG_WARN(...) ((void)0)
+#endif
+
+#if NYARKOA_LOG_LEVEL >= NYARKOA_LOG_INFO
+#define NLOG_INFO(...) logger.print(NYARKOA_LOG_INFO, __VA_ARGS__)
+#else
+#define NLOG_INFO(...) ((void)0)
+#endif
+
+#if NYARKOA_LOG_LEVEL >= NYARKOA_LOG_DEBUG
+#define NLOG_DEBUG(...) logger.print(NYARKOA_LOG_DEBUG, __VA_ARGS__)
+#else
+#define NLOG_DEBUG(...) ((void)0)
+#endif
+
+class NyarkoaLogger {
+ public:
+  void setLevel(byte level) { this->level = level; }
+  byte getLevel() const { return level; }
+  bool isEnabled(byte level) const { return level <= this->level; }
+
+  void print(byte level, const __FlashStringHelper *text, bool newline = true);
+  void print(byte level, const __FlashStringHelper *label, const char *text);
+  void print(byte level, const __FlashStringHelper *label,
+             unsigned long value, const __FlashStringHelper *suffix);
+
+ private:
+  byte level{NYARKOA_LOG_DEBUG};
+};
+
+#endif
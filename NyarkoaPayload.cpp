@@ -1,7 +1,21 @@
 #include <Arduino.h>
 #include <NyarkoaPayload.h>
+#include <stdio.h>
 
-NyarkoaPayload::NyarkoaPayload() {}
+// Update a link statistics counter, e.g. LINK_STAT(retries++); compiled out
+// when NYARKOA_LINK_STATS is 0.
+#if NYARKOA_LINK_STATS
+#define LINK_STAT(update) (linkStats.update)
+#else
+#define LINK_STAT(update) ((void)0)
+#endif
+
+NyarkoaPayload::NyarkoaPayload() {
+  for (byte i = 0; i < REQUEST_SLOTS; i++) releaseRequest(requests[i]);
+#if NYARKOA_LINK_STATS
+  resetLinkStats();
+#endif
+}
 
 NyarkoaPayload::~NyarkoaPayload() {}
 
@@ -18,20 +32,67 @@ NyarkoaPayload::~NyarkoaPayload() {}
  * @note To view the debugging information, ensure that the Serial Monitor is
  * correctly initialized and opened in your Arduino IDE.
  */
-void NyarkoaPayload::debug(String text, bool newline) {
-  if (DEBUG) {
-    Serial.print(text + String(newline ? "\n" : ""));
+void NyarkoaPayload::debug(const char *text, bool newline) {
+  if (logger.isEnabled(NYARKOA_LOG_DEBUG)) {
+    Serial.print(text);
+    if (newline) Serial.print('\n');
+  }
+}
+
+/**
+ * Print debugging information stored in flash memory.
+ *
+ * @param text The text to print, wrapped in F().
+ * @param newline Whether to add a newline character.
+ */
+void NyarkoaPayload::debug(const __FlashStringHelper *text, bool newline) {
+  if (logger.isEnabled(NYARKOA_LOG_DEBUG)) {
+    Serial.print(text);
+    if (newline) Serial.print('\n');
+  }
+}
+
+/**
+ * Print a labelled line of debugging information.
+ *
+ * The label and the text are printed one after the other, so no String is
+ * built to join them.
+ *
+ * @param label The label to print first, wrapped in F().
+ * @param text The text to print after the label.
+ */
+void NyarkoaPayload::debug(const __FlashStringHelper *label,
+                           const char *text) {
+  if (logger.isEnabled(NYARKOA_LOG_DEBUG)) {
+    Serial.print(label);
+    Serial.print(text);
+    Serial.print('\n');
   }
 }
 
+#ifndef NYARKOA_NO_HEAP
+/**
+ * Print debugging information held in a String.
+ *
+ * @param text The text to print.
+ * @param newline Whether to add a newline character.
+ */
+void NyarkoaPayload::debug(String text, bool newline) {
+  debug(text.c_str(), newline);
+}
+#endif
+
 /**
  * Activate development mode for debugging.
  *
  * This method activates development mode, which enables debugging output.
  * When in development mode, debugging information will be printed to the
- * Serial Monitor for troubleshooting and testing purposes.
+ * Serial Monitor for troubleshooting and testing purposes. Only the library
+ * messages compiled in with NYARKOA_LOG_LEVEL can be printed.
  */
-void NyarkoaPayload::activateDevMode() { DEBUG = true; }
+void NyarkoaPayload::activateDevMode() {
+  logger.setLevel(NYARKOA_LOG_DEBUG);
+}
 
 /**
  * Activate production mode to disable debugging.
@@ -40,8 +101,99 @@ void NyarkoaPayload::activateDevMode() { DEBUG = true; }
  * In production mode, debugging information will not be printed to the
  * Serial Monitor, ensuring normal operation without debug messages.
  */
-void NyarkoaPayload::activateProdMode() { DEBUG = false; }
+void NyarkoaPayload::activateProdMode() {
+  logger.setLevel(NYARKOA_LOG_NONE);
+}
+
+/**
+ * Choose which of the library's diagnostic messages are printed.
+ *
+ * @param level The most detailed level to print: NYARKOA_LOG_NONE,
+ * NYARKOA_LOG_ERROR, NYARKOA_LOG_WARN, NYARKOA_LOG_INFO or NYARKOA_LOG_DEBUG.
+ *
+ * Messages above NYARKOA_LOG_LEVEL in NyarkoaConfig.h are not compiled in and
+ * cannot be enabled here. `debug` prints only at NYARKOA_LOG_DEBUG.
+ */
+void NyarkoaPayload::setLogLevel(byte level) { logger.setLevel(level); }
+
+/**
+ * Request the binary link protocol.
+ *
+ * This method asks `connectCommModule` to offer the binary framed protocol to
+ * the communication module. The binary protocol is only used if the module
+ * accepts it during the connection handshake; otherwise the library falls
+ * back to the text protocol. Call this before `connectCommModule`.
+ */
+void NyarkoaPayload::enableBinaryLink() { binaryLinkEnabled = true; }
+
+/**
+ * Use the text protocol only.
+ *
+ * This method stops the library from offering the binary framed protocol on
+ * the next connection, and switches the current link back to text.
+ */
+void NyarkoaPayload::disableBinaryLink() {
+  binaryLinkEnabled = false;
+  binaryLink = false;
+}
+
+/**
+ * Check which protocol the link is using.
+ *
+ * @return true if the communication module accepted the binary framed
+ * protocol; false if the text protocol is in use.
+ */
+bool NyarkoaPayload::isBinaryLink() { return binaryLink; }
+
+/**
+ * Check whether text lines on the link are protected by a CRC.
+ *
+ * @return true if the communication module accepted CRC-checked text lines;
+ * false if the binary protocol or the legacy text protocol is in use.
+ */
+bool NyarkoaPayload::isCrcLink() { return crcLink; }
+
+/**
+ * Get the retry policy the library starts with.
+ *
+ * @return Four attempts per command, retransmission timeouts of at least
+ * 40 ms, and up to four doublings of the timeout after losses.
+ */
+RetryPolicy NyarkoaPayload::defaultRetryPolicy() {
+  return {.attempts = 4, .minTimeout = 40, .maxBackoff = 4};
+}
+
+/**
+ * Change how hard commands are retried.
+ *
+ * @param policy The attempts per command (at least 1), the shortest
+ * retransmission timeout in milliseconds, and how many times losses may
+ * double the timeout (at most 16).
+ *
+ * Requests already waiting keep the attempts they have made. More attempts
+ * and a longer backoff ride out a lossy link at the cost of time; a shorter
+ * timeout notices a lost answer sooner on a fast link.
+ */
+void NyarkoaPayload::setRetryPolicy(const RetryPolicy &policy) {
+  retryPolicy = policy;
+  if (retryPolicy.attempts == 0) retryPolicy.attempts = 1;
+  if (retryPolicy.maxBackoff > 16) retryPolicy.maxBackoff = 16;
+}
+
+/**
+ * Check if a string contains a substring.
+ *
+ * This method checks if the given `str` contains the specified `substr`.
+ *
+ * @param str The string to search in.
+ * @param substr The substring to search for.
+ * @return true if the `substr` is found within the `str`; otherwise, false.
+ */
+bool NyarkoaPayload::contains(const char *str, const char *substr) {
+  return strstr(str, substr) != nullptr;
+}
 
+#ifndef NYARKOA_NO_HEAP
 /**
  * Check if a string contains a substring.
  *
@@ -61,7 +213,8 @@ bool NyarkoaPayload::contains(String str, String substr) {
  * This method computes a simple hash for the provided data by summing up the
  * ASCII values of its characters. The hash is represented as a string
  * containing information about the data length, the ASCII value of the first
- * character, the hash sum, and a checksum byte.
+ * character, the hash sum, and a checksum byte. It is only used on the link
+ * by modules that do not accept a CRC link.
  *
  * @param data The data to hash.
  * @return The computed hash as a string.
@@ -89,7 +242,32 @@ String NyarkoaPayload::simpleHash(String data) {
  * @return true if the data and hash match; otherwise, false.
  */
 bool NyarkoaPayload::compareHash(String data, String hash) {
-  return simpleHash(data) == hash;
+  return checkHash(data.c_str(), hash.c_str(), hash.length());
+}
+#endif
+
+/**
+ * Check a legacy `simpleHash` echo without building Strings.
+ *
+ * @param data The text that was hashed.
+ * @param hash The received hash; it need not be NUL-terminated.
+ * @param hashLength The length of the received hash.
+ * @return true if `hash` is the simpleHash of `data`; otherwise, false.
+ */
+bool NyarkoaPayload::checkHash(const char *data, const char *hash,
+                               size_t hashLength) {
+  size_t length = strlen(data);
+  unsigned long hashSum = 0;
+  for (size_t i = 0; i < length; i++) hashSum += int(data[i]);
+
+  char expected[32];
+  int first = length ? int(data[0]) : 0;
+  int last = length ? int(data[length - 1]) : 0;
+  size_t expectedLength =
+      snprintf(expected, sizeof(expected), "%u%d%lu%d%u", unsigned(length),
+               first, hashSum, last, unsigned(byte(hashSum % 256)));
+  return expectedLength == hashLength &&
+         memcmp(expected, hash, hashLength) == 0;
 }
 
 /**
@@ -99,8 +277,9 @@ bool NyarkoaPayload::compareHash(String data, String hash) {
  * communication buffer.
  */
 void NyarkoaPayload::clearSerial() {
-  while (commSerial->available()) {
-    commSerial->read();
+  while (commLink->available()) {
+    commLink->read();
+    countReceived(1);
   }
 }
 
@@ -109,21 +288,17 @@ void NyarkoaPayload::clearSerial() {
  *
  * @param cmd The command to execute.
  * @return A Response object with success status and message.
+ *
+ * This method queues the command and drives `poll` until the communication
+ * module has echoed its hash or all attempts have failed.
  */
-Response NyarkoaPayload::executeCmd(String cmd) {
-  byte attempts = 0;
-  while (attempts <= 3) {
-    transmit(cmd);
-    String response = receive();
-
-    debug("RCVD: " + response);
-    if (compareHash(cmd, response)) {
-      debug("Trans OK");
-      return {.isOk = true, .message = "OK"};
-    }
-    attempts++;
-  }
-  return {.isOk = false, .message = "Req. failed"};
+Response NyarkoaPayload::executeCmd(const char *cmd) {
+  byte handle = queueRequest(cmd, true, OWNER_LIBRARY);
+  PendingRequest *req = awaitRequest(handle);
+  if (req == nullptr) return {.isOk = false, .message = "Req. failed"};
+  Response response = requestResult(*req);
+  releaseRequest(*req);
+  return response;
 }
 
 /**
@@ -140,72 +315,125 @@ Response NyarkoaPayload::executeCmd(String cmd) {
  * true, and the message is the payload received. If the response hash does not
  * match, it will make up to three attempts to send the request. If all attempts
  * fail or if the hash doesn't match, it returns a Response object with 'isOk'
- * set to false, and a message indicating failure.
+ * set to false, and a message indicating failure. On a binary link the request
+ * is sent as a frame instead and the message is the reply's text payload.
+ *
+ * The request runs on the same engine as `beginRequest`; this method simply
+ * drives `poll` until it has finished.
  */
-Response NyarkoaPayload::request(String req) {
-  clearSerial();
-  byte attempts = 0;
-  while (attempts <= 3) {
-    transmit("REQ:" + req);
-    String response = receive();
-
-    byte nPos = response.indexOf(':');
-    String respHash = response.substring(0, nPos);
-    String payload = response.substring(nPos + 1);
-
-    if (compareHash(req, respHash)) {
-      debug("Trans OK");
-      return {.isOk = true, .message = payload};
-    }
-    attempts++;
-  }
-  return {.isOk = false, .message = "FAILED"};
+Response NyarkoaPayload::request(const char *req) {
+  byte handle = queueRequest(req, false, OWNER_LIBRARY);
+  PendingRequest *pending = awaitRequest(handle);
+  if (pending == nullptr) return {.isOk = false, .message = "FAILED"};
+  Response response = requestResult(*pending);
+  releaseRequest(*pending);
+  return response;
 }
 
 /**
  * Transmit data through the serial communication.
  *
+ * @param prefix Text sent ahead of the data, such as "REQ:", or "".
  * @param data The data to transmit.
  *
- * This method sends the provided 'data' over the serial communication channel.
- * It first clears the serial communication buffer to ensure that no residual
- * data is present. Then, it writes the 'data' followed by a newline character
- * to the communication module. A delay of 1000 milliseconds (1 second) is added
- * to allow for data transmission. Use this method to send commands or data to
+ * This method sends the provided 'prefix' and 'data' over the serial
+ * communication channel as one line. It first clears the serial communication
+ * buffer to ensure that no residual data is present, unless a sensor is
+ * subscribed: its readings may arrive at any time, and clearing the buffer
+ * could cut one in half. Then, it writes the line
+ * followed by a newline character to the communication module. On a CRC link
+ * the line ends with '*' and the CRC-16 of the line as four hex digits. It
+ * returns as soon as the data has been handed to the serial port; waiting for
+ * the answer is left to `receive`. Use this method to send commands or data to
  * the communication module.
  */
-void NyarkoaPayload::transmit(String data) {
-  clearSerial();
-  commSerial->println(data);
-  delay(1000);
+void NyarkoaPayload::transmit(const char *prefix, const char *data) {
+  if (subscriptions == 0) {
+    clearSerial();
+    rxLength = 0;
+  }
+  size_t sent = commLink->print(prefix);
+  sent += commLink->print(data);
+  if (crcLink) {
+    char hex[CRC16_HEX_SIZE];
+    crc16ToHex(crc16(data, strlen(data), crc16(prefix, strlen(prefix))), hex);
+    sent += commLink->print('*');
+    sent += commLink->print(hex);
+  }
+  sent += commLink->println();
+  countSent(sent);
 }
 
 /**
  * Receive data from the serial communication.
  *
- * @return The received data as a string.
+ * @param timeout The longest time to wait for a complete response, in
+ * milliseconds.
+ * @return true once a complete line is in `rxLine`; false on timeout.
  *
- * This method reads and collects data received through the serial communication
- * channel. It waits until data becomes available, ensuring that no data is
- * missed. If a timeout of 10 seconds (or the duration specified by
- * SERIAL_TIMEOUT) is exceeded without data reception, it returns "TIMEOUT" as a
- * string. Otherwise, it reads the received data, trims any leading or trailing
- * whitespace, and returns it as a string. Use this method to retrieve responses
- * or data from the communication module.
+ * This method collects one response line from the serial communication
+ * channel. It returns as soon as the line is complete: when its newline
+ * arrives or, for modules that do not terminate their answers, when the link
+ * has been quiet for RX_IDLE_TIMEOUT after the last byte. If no complete line
+ * arrives within 'timeout' it returns false. Leading and
+ * trailing whitespace is removed from the line. Use this method to retrieve
+ * responses or data from the communication module.
  */
-String NyarkoaPayload::receive() {
+bool NyarkoaPayload::receive(unsigned long timeout) {
   unsigned long startTime = millis();
-  String data;
+  rxLength = 0;
 
-  while (!commSerial->available()) {
-    if (millis() - startTime >= SERIAL_TIMEOUT) {
-      return "TIMEOUT";
+  while (!readLine()) {
+    if (millis() - startTime >= timeout) {
+      return false;
     }
   }
-  data = commSerial->readString();
-  commSerial->read();
-  data.trim();
-  return data;
+  return true;
+}
+
+/**
+ * Collect response bytes that have already arrived.
+ *
+ * @return true once a complete, non-empty line is in `rxLine`; false if the
+ * line is still incomplete.
+ *
+ * This method never waits for data. It moves whatever the serial port has
+ * buffered into `rxLine` and checks for the end of the line, so it can be
+ * called repeatedly until the response is complete.
+ */
+bool NyarkoaPayload::readLine() {
+  bool lineEnded = false;
+  while (!lineEnded && commLink->available()) {
+    char c = commLink->read();
+    countReceived(1);
+    lastRxTime = millis();
+    if (c == '\n') {
+      lineEnded = rxLength > 0;  // skip blank lines between responses
+    } else if (c == '\r' || (rxLength == 0 && isspace(c))) {
+      continue;
+    } else if (rxLength < sizeof(rxLine) - 1) {
+      rxLine[rxLength++] = c;
+    }
+  }
+
+  if (rxLength == 0) return false;
+  if (!lineEnded && millis() - lastRxTime < RX_IDLE_TIMEOUT) return false;
+  while (rxLength > 0 && isspace(rxLine[rxLength - 1])) rxLength--;
+  rxLine[rxLength] = '\0';
+  rxLength = 0;
+  return true;
+}
+
+/**
+ * Get the response deadline for a command.
+ *
+ * @param cmd The command or request being sent.
+ * @return The longest time in milliseconds to wait for its response: the
+ * command's own deadline, or SERIAL_TIMEOUT for commands without one.
+ */
+unsigned long NyarkoaPayload::responseTimeout(const char *cmd) {
+  unsigned long timeout = commandTimeout(cmd);
+  return timeout ? timeout : SERIAL_TIMEOUT;
 }
 
 /**
@@ -222,58 +450,1018 @@ String NyarkoaPayload::receive() {
  * "OK" is found, it returns a response object with "System Online" as the
  * message to indicate a successful connection. If the response doesn't contain
  * "OK," it returns a response object with "CRC Error." Use this method to
- * establish a connection with the communication module.
+ * establish a connection with the communication module. Requests still
+ * outstanding from an earlier connection are dropped, so their handles are
+ * no longer valid.
+ *
+ * @param transport The stream the module is attached to. A module that
+ * refused the CRC link on this stream is not offered it again. An offer
+ * that went unanswered, for example because its reply was lost, is made
+ * again at the next connection, so that one bad reply does not leave the
+ * link on the weaker legacy check.
  */
-Response NyarkoaPayload::connect() {
+Response NyarkoaPayload::connect(Stream &transport) {
+  // requests of an earlier session are never answered on the new link
+  for (byte i = 0; i < REQUEST_SLOTS; i++) releaseRequest(requests[i]);
+  clockRequest = 0;
+#if NYARKOA_DOWNLINK_SIZE
+  downlinkHandle = 0;
+  // a module that refused batches is not sent them again
+  if (&transport != batchTransport || batchMode == BATCH_PROBE) {
+    batchMode = BATCH_ON;
+  }
+  batchTransport = &transport;
+#endif
+  rxParser.reset();
+  rxLength = 0;
+  memset(rttEstimates, 0, sizeof(rttEstimates));
+  // "AT?" restarts the module's link, which ends its subscriptions
+  subscriptions = 0;
+#if NYARKOA_STREAM_DEPTH
+  mpuStream.clear();
+  mplStream.clear();
+  gpsStream.clear();
+#endif
   clearSerial();
-  commSerial->println("AT?");
-  delay(1000);
+  countSent(commLink->println("AT?"));
 
   unsigned long startTime = millis();
   byte recallCount{1};
-  debug("Waiting for comm.", false);
+  NLOG_INFO(F("Waiting for comm."), false);
 
-  while (!commSerial->available()) {
+  while (!commLink->available()) {
     if (millis() - startTime >= CONNECT_SERIAL_TIMEOUT) {
       return {.isOk = false, .message = "TIMEOUT"};
     }
 
     if (recallCount++ % 50 == 0) {
-      debug("\nResending...");
-      commSerial->println("AT?");
+      NLOG_INFO(F("\nResending..."));
+      countSent(commLink->println("AT?"));
     }
-    debug(".", false);
+    NLOG_INFO(F("."), false);
     delay(100);
   }
 
   // this is an acknowledgment (returns the number of characters received)
-  String response = commSerial->readString();
-  commSerial->read();
-
-  if (!contains(response, "OK")) return {.isOk = false, .message = "CRC Error"};
+  if (!receive(SERIAL_TIMEOUT) || !contains(rxLine, "OK")) {
+    return {.isOk = false, .message = "CRC Error"};
+  }
+  binaryLink = false;
+  crcLink = false;
+  if (binaryLinkEnabled && negotiateLink("BIN") == LINK_ACCEPTED) {
+    binaryLink = true;
+    NLOG_INFO(F("\nBinary link"));
+  } else if (&transport != crcRefusedBy) {
+    LinkAnswer answer = negotiateLink("CRC");
+    if (answer == LINK_ACCEPTED) {
+      crcLink = true;
+      NLOG_INFO(F("\nCRC link"));
+    } else if (answer == LINK_REFUSED) {
+      crcRefusedBy = &transport;
+    }
+  }
   return {.isOk = true, .message = "\nSystem Online"};
 }
 
+/**
+ * Negotiate a link protocol with the communication module.
+ *
+ * @param mode The protocol to offer: "BIN" for binary frames, "CRC" for text
+ * lines carrying a CRC-16.
+ * @return LINK_ACCEPTED if the module switched to the protocol;
+ * LINK_REFUSED if it answered "ERR", or echoed the request's hash with
+ * another mode or none; otherwise, LINK_UNANSWERED.
+ *
+ * This method offers the protocol with a single "AT_LINK:<mode>" request,
+ * sent in the legacy text form every module understands. A module that
+ * supports the protocol echoes the request hash followed by the mode and
+ * expects it from then on. Any other answer, including a timeout from older
+ * firmware, leaves the link on the legacy text protocol. The offer is not
+ * retried so that older modules do not delay the connection further.
+ */
+LinkAnswer NyarkoaPayload::negotiateLink(const char *mode) {
+  char offer[16];
+  snprintf(offer, sizeof(offer), "AT_LINK:%s", mode);
+  transmit("REQ:", offer);
+  if (!receive(LINK_TIMEOUT)) return LINK_UNANSWERED;
+  if (strcmp(rxLine, "ERR") == 0) return LINK_REFUSED;
+  const char *sep = strchr(rxLine, ':');
+  size_t hashLength = sep != nullptr ? sep - rxLine : strlen(rxLine);
+  if (!checkHash(offer, rxLine, hashLength)) return LINK_UNANSWERED;
+  return sep != nullptr && strcmp(sep + 1, mode) == 0 ? LINK_ACCEPTED
+                                                      : LINK_REFUSED;
+}
+
 /**
  * Start the communication module and connect to it.
  *
  * @return A Response object with success status and message.
  *
- * This method initializes the communication module by creating a SoftwareSerial
- * instance with specified Tx and Rx pins. It sets the communication module's
+ * This method initializes the communication module's SoftwareSerial port on
+ * the Tx and Rx pins in `commUARTPins`. It sets the communication module's
  * baud rate to the value defined by UART_BAUD_RATE. After initializing the
  * module, it attempts to establish a connection using the `connect` method. The
  * `connect` method will handle the connection process and return a response
  * object with details. Use this method to start the communication module and
  * connect to it.
  */
+#ifndef NYARKOA_NO_SOFTWARE_SERIAL
 Response NyarkoaPayload::connectCommModule() {
   // keep sending AT? to the communication module;
-  commSerial = new SoftwareSerial(commUARTPins.Tx, commUARTPins.Rx);
-  commSerial->begin(UART_BAUD_RATE);
-  return connect();
+  commSerial.begin(UART_BAUD_RATE);
+  return connectCommModule(commSerial);
+}
+#endif
+
+/**
+ * Connect to the communication module over a given transport.
+ *
+ * @param transport The stream the communication module is attached to, for
+ * example `Serial1`, an AltSoftSerial port, or a pipe on a host build. It must
+ * already be started at the module's baud rate.
+ * @return A Response object with success status and message.
+ *
+ * This method is the same as `connectCommModule()` except that the library
+ * talks to the module through `transport` instead of its own SoftwareSerial
+ * port. A hardware UART receives in its interrupt handler, so it can run at
+ * higher baud rates without losing bytes while the sketch is busy.
+ */
+Response NyarkoaPayload::connectCommModule(Stream &transport) {
+  commLink = &transport;
+  if (trace != nullptr) {
+    trace->attach(transport);
+    commLink = trace;
+  }
+  moduleClock.reset();
+#if NYARKOA_LINK_STATS
+  resetLinkStats();
+#endif
+  return connect(transport);
+}
+
+/**
+ * Record the traffic with the communication module.
+ *
+ * @param recorder The recorder to pass every byte through, or nullptr to stop
+ * recording. Call this before `connectCommModule`, which puts the recorder
+ * between the payload and the module's stream.
+ *
+ * The recorder keeps the latest traffic in RAM and can write all of it to a
+ * file; a trace can be played back to the payload with NyarkoaTraceReplay.
+ */
+void NyarkoaPayload::setTrace(NyarkoaTraceRecorder *recorder) {
+  trace = recorder;
+}
+
+/**
+ * Start a request without waiting for the response.
+ *
+ * @param req The request to send, e.g. "AT_MPU".
+ * @return A handle identifying the request, or 0 if too many requests are
+ * already outstanding.
+ *
+ * This method queues the request and returns immediately. The request is sent
+ * and its response collected by `poll`, which must be called regularly, for
+ * example from `loop()`. Use `isReady` and `getResult` with the returned
+ * handle, or a callback set with `setRequestCallback`, to obtain the result.
+ * The response is checked and retried exactly as by `requestAction`.
+ */
+byte NyarkoaPayload::beginRequest(const char *req) {
+  return queueRequest(req, false, OWNER_SKETCH);
+}
+
+/**
+ * Start a command without waiting for the response.
+ *
+ * @param cmd The command to execute, e.g. "AT_EJECT".
+ * @return A handle identifying the command, or 0 if too many requests are
+ * already outstanding.
+ *
+ * This method is the asynchronous counterpart of `commAction`: the command is
+ * sent by `poll` and its result reported through `isReady`/`getResult` or the
+ * request callback. Unlike `commAction` it does not report the result to the
+ * ground station.
+ */
+byte NyarkoaPayload::beginCommand(const char *cmd) {
+  return queueRequest(cmd, true, OWNER_SKETCH);
 }
 
+/**
+ * Drive outstanding requests.
+ *
+ * This method never blocks. It collects whatever part of the pending
+ * responses has arrived, retries a request whose response failed its check or
+ * did not arrive in time, and sends queued requests once the link can take
+ * them. Finished requests are reported to the request callback, if one is
+ * set. Call it as often as possible while requests are outstanding.
+ *
+ * On the text protocol responses cannot be told apart, so one request is on
+ * the link at a time. On a binary link every queued request is sent at once
+ * and replies are matched to requests by sequence number, in any order.
+ *
+ * When the local clock is due to be checked against the module and the link
+ * is idle, `poll` also starts an "AT_TSTAMP" request of its own, and it sends
+ * the ground station records queued by `queueDownlink` once a batch is due.
+ *
+ * Readings pushed by subscribed sensors are collected here as well, and
+ * queued for `readSample`.
+ */
+void NyarkoaPayload::poll() {
+  if (commLink == nullptr) return;
+  if (binaryLink) {
+    receiveFrames();
+  } else if (crcLink) {
+    receiveCheckedLines();
+  }
+
+  bool linkBusy = false;
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    PendingRequest &req = requests[i];
+    if (req.state != REQ_WAITING) continue;
+    if (!binaryLink && !crcLink) receiveLine(req);
+    if (req.state == REQ_WAITING && millis() - req.sentAt >= req.timeout) {
+      NLOG_WARN(F("RCVD: TIMEOUT"));
+      LINK_STAT(timeouts++);
+      backOff(req);
+      retryRequest(req);
+    }
+    if (req.state == REQ_WAITING) linkBusy = true;
+  }
+
+  if (binaryLink) {
+    PendingRequest *next;
+    while ((next = oldestQueued()) != nullptr) sendRequest(*next);
+  } else if (!linkBusy) {
+    PendingRequest *next = oldestQueued();
+    if (next != nullptr) sendRequest(*next);
+  }
+  serviceClock();
+#if NYARKOA_DOWNLINK_SIZE
+  serviceDownlink();
+#endif
+}
+
+/**
+ * Check whether a request has finished.
+ *
+ * @param handle The handle returned by `beginRequest` or `beginCommand`.
+ * @return true if the request succeeded or failed, or if the handle is not
+ * known; false while it is still in progress.
+ */
+bool NyarkoaPayload::isReady(byte handle) {
+  PendingRequest *req = findRequest(handle);
+  return req == nullptr || req->state == REQ_DONE || req->state == REQ_FAILED;
+}
+
+/**
+ * Collect the result of a finished request.
+ *
+ * @param handle The handle returned by `beginRequest` or `beginCommand`.
+ * @return A Response object with success status and message, as returned by
+ * the blocking calls. A request that has not finished yet is reported as not
+ * OK with the message "PENDING".
+ *
+ * Collecting a result frees the request's slot and invalidates the handle.
+ */
+Response NyarkoaPayload::getResult(byte handle) {
+  PendingRequest *req = findRequest(handle);
+  if (req == nullptr) return {.isOk = false, .message = "FAILED"};
+  if (!isReady(handle)) return {.isOk = false, .message = "PENDING"};
+  Response response = requestResult(*req);
+  releaseRequest(*req);
+  return response;
+}
+
+/**
+ * Set a function to be called when an asynchronous request finishes.
+ *
+ * @param callback The function to call with the request's handle and result,
+ * or nullptr to collect results with `getResult` instead.
+ *
+ * The callback is called from `poll`. Its slot is freed once it returns, so
+ * `getResult` must not be used for requests reported through the callback.
+ */
+void NyarkoaPayload::setRequestCallback(RequestCallback callback) {
+  requestCallback = callback;
+}
+
+/**
+ * Reserve a slot for a new request.
+ *
+ * @param cmd The command or request text.
+ * @param isCommand true for a command (hash echo only), false for a request
+ * that returns a payload.
+ * @param owner Whom the request is for; only the sketch's requests are
+ * reported to the request callback, and a blocking call first lets a
+ * running clock check finish.
+ * @return The request's handle, or 0 if no slot is free or the text is too
+ * long.
+ *
+ * Only the text after the command's name is kept, in NYARKOA_ARGS_SIZE
+ * bytes. A blocking call's longer text, such as a ground station message,
+ * is used where it is, since the caller waits for the request to finish.
+ */
+byte NyarkoaPayload::queueRequest(const char *cmd, bool isCommand,
+                                  RequestOwner owner) {
+  byte index = commandIndex(cmd);
+  const char *args = index < COMMAND_COUNT ? cmd + strcspn(cmd, ":") : cmd;
+  size_t argsLength = strlen(args);
+  // only a blocking call's text outlives the request
+  if (strlen(cmd) >= NYARKOA_CMD_SIZE ||
+      (owner == OWNER_SKETCH && argsLength >= NYARKOA_ARGS_SIZE)) {
+    NLOG_ERROR(F("Cmd too long: "), cmd);
+    return 0;
+  }
+  // a clock check was started on an idle link, so it takes about one round
+  // trip; blocking calls wait for the slot it holds
+  while (owner == OWNER_LIBRARY && clockRequest != 0) poll();
+  PendingRequest *req = freeSlot(owner);
+  if (req == nullptr) {
+    NLOG_ERROR(F("Request queue full"));
+    return 0;
+  }
+
+  if (++nextHandle == 0) nextHandle = 1;
+  req->handle = nextHandle;
+  req->state = REQ_QUEUED;
+  if (++sequence == 0) sequence = 1;
+  req->seq = sequence;
+  req->attempts = 0;
+  req->cmdIndex = index;
+  req->rttClass = commandRttClass(index);
+  req->isCommand = isCommand;
+  req->notify = owner == OWNER_SKETCH;
+  req->replySize = 0;
+  req->maxTimeout = responseTimeout(cmd);
+  if (argsLength < NYARKOA_ARGS_SIZE) {
+    req->text = nullptr;
+    memcpy(req->args, args, argsLength + 1);
+  } else {
+    req->text = cmd;
+  }
+  LINK_STAT(requests++);
+  return req->handle;
+}
+
+/**
+ * Find a free slot for a new request.
+ *
+ * @param owner Whom the request is for.
+ * @return The slot, or nullptr if none is free.
+ *
+ * The sketch's requests take one of its NYARKOA_MAX_PENDING slots. The
+ * library's take the slot kept for it, so that a blocking call such as
+ * `ejectBalloon()` is sent however many of the sketch's requests are
+ * outstanding. Only while that slot is busy, for example with a blocking
+ * call made from the request callback, do they take one of the sketch's.
+ * A clock check never does, and a batch of ground station records only
+ * takes its own slot.
+ */
+PendingRequest *NyarkoaPayload::freeSlot(RequestOwner owner) {
+#if NYARKOA_DOWNLINK_SIZE
+  if (owner == OWNER_DOWNLINK) {
+    PendingRequest &req = requests[DOWNLINK_SLOT];
+    return req.state == REQ_FREE ? &req : nullptr;
+  }
+#endif
+  if (owner != OWNER_SKETCH && requests[LIBRARY_SLOT].state == REQ_FREE) {
+    return &requests[LIBRARY_SLOT];
+  }
+  if (owner == OWNER_CLOCK) return nullptr;
+  for (byte i = 0; i < NYARKOA_MAX_PENDING; i++) {
+    if (requests[i].state == REQ_FREE) return &requests[i];
+  }
+  return nullptr;
+}
+
+/**
+ * Find the slot of an outstanding request.
+ *
+ * @param handle The request's handle.
+ * @return The request, or nullptr if the handle is not in use.
+ */
+PendingRequest *NyarkoaPayload::findRequest(byte handle) {
+  if (handle == 0) return nullptr;
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    if (requests[i].handle == handle) return &requests[i];
+  }
+  return nullptr;
+}
+
+/**
+ * Block until a request has finished.
+ *
+ * @param handle The request's handle.
+ * @return The finished request, or nullptr if the handle is not in use.
+ */
+PendingRequest *NyarkoaPayload::awaitRequest(byte handle) {
+  PendingRequest *req = findRequest(handle);
+  if (req == nullptr) return nullptr;
+  while (!isReady(handle)) poll();
+  return req;
+}
+
+/**
+ * Find the queued request that has waited longest.
+ *
+ * @return The request, or nullptr if none is queued.
+ */
+PendingRequest *NyarkoaPayload::oldestQueued() {
+  PendingRequest *oldest = nullptr;
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    PendingRequest &req = requests[i];
+    // Handles grow with every request, so the largest distance from the
+    // newest handle marks the request that has waited longest.
+    if (req.state == REQ_QUEUED &&
+        (oldest == nullptr ||
+         byte(nextHandle - req.handle) > byte(nextHandle - oldest->handle))) {
+      oldest = &req;
+    }
+  }
+  return oldest;
+}
+
+/**
+ * Send, or resend, a request.
+ *
+ * @param req The request to send.
+ *
+ * On the text protocol commands are sent as they are and requests prefixed
+ * with "REQ:". On a binary link both are sent as a frame carrying the
+ * request's sequence number, which stays the same on every attempt so that
+ * the module can recognise duplicates. Other requests may still be waiting
+ * for their replies, and subscribed sensors may be pushing readings, so the
+ * link is only cleared when neither is the case. Each attempt is given the
+ * retransmission timeout current when it is sent.
+ */
+void NyarkoaPayload::sendRequest(PendingRequest &req) {
+  const char *text = formatRequest(req);
+  if (binaryLink) {
+    if (!encodeCommand(text, txFrame)) {
+      NLOG_ERROR(F("Unknown cmd: "), text);
+      completeRequest(req, false);
+      return;
+    }
+    txFrame.seq = req.seq;
+    req.cmdId = txFrame.cmd;
+    if (!isLinkBusy() && subscriptions == 0) {
+      clearSerial();
+      rxParser.reset();
+    }
+    countSent(writeFrame(*commLink, txFrame));
+  } else {
+    transmit(req.isCommand ? "" : "REQ:", text);
+  }
+  req.state = REQ_WAITING;
+  req.timeout = retryTimeout(req);
+  req.attempts++;
+  req.sentAt = millis();
+}
+
+/**
+ * Resend a request, or fail it once it has used all its attempts.
+ *
+ * @param req The request whose last attempt failed.
+ */
+void NyarkoaPayload::retryRequest(PendingRequest &req) {
+  if (req.attempts >= retryPolicy.attempts) {
+    completeRequest(req, false);
+  } else {
+    LINK_STAT(retries++);
+    sendRequest(req);
+  }
+}
+
+/**
+ * Get the time to wait for the answer to a request's next attempt.
+ *
+ * @param req The request about to be sent.
+ * @return The retransmission timeout in milliseconds.
+ *
+ * Until an answer to a command of the same RTT class has been timed, the
+ * command's own deadline is used. After that the timeout is the smoothed
+ * round-trip time plus four times its variation, at least the retry policy's
+ * `minTimeout`, doubled for every backoff step of the class and never longer
+ * than the command's deadline.
+ */
+unsigned long NyarkoaPayload::retryTimeout(PendingRequest &req) {
+  if (req.rttClass >= RTT_CLASS_COUNT) return req.maxTimeout;
+  RttEstimate &estimate = rttEstimates[req.rttClass];
+  if (!estimate.isValid) return req.maxTimeout;
+
+  unsigned long timeout = (estimate.srtt8 >> 3) + estimate.rttvar4;
+  if (timeout < retryPolicy.minTimeout) timeout = retryPolicy.minTimeout;
+  timeout <<= estimate.backoff;
+  return timeout < req.maxTimeout ? timeout : req.maxTimeout;
+}
+
+/**
+ * Update the round-trip time estimate with an answered request.
+ *
+ * @param req The request whose answer has just been accepted.
+ *
+ * Following Karn's algorithm, only answers to a request's first attempt are
+ * timed: a retried request may have been answered by any of its attempts.
+ * A timed answer also ends the backoff of its class.
+ */
+void NyarkoaPayload::sampleRtt(PendingRequest &req) {
+  if (req.rttClass >= RTT_CLASS_COUNT || req.attempts != 1) return;
+  RttEstimate &estimate = rttEstimates[req.rttClass];
+  unsigned long elapsed = millis() - req.sentAt;
+  long rtt = elapsed > 8191 ? 8191 : elapsed;  // keeps srtt8 within 16 bits
+
+  if (!estimate.isValid) {
+    estimate.srtt8 = rtt << 3;
+    estimate.rttvar4 = rtt << 1;
+    estimate.isValid = true;
+  } else {
+    long error = rtt - (estimate.srtt8 >> 3);
+    estimate.srtt8 += error;  // srtt += error / 8
+    if (error < 0) error = -error;
+    estimate.rttvar4 += error - (estimate.rttvar4 >> 2);  // rttvar += ... / 4
+  }
+  estimate.backoff = 0;
+}
+
+/**
+ * Lengthen the retransmission timeout after an attempt went unanswered.
+ *
+ * @param req The request whose attempt timed out.
+ *
+ * The class's timeout doubles with each of the request's attempts, up to
+ * the retry policy's `maxBackoff` times, so retries spread out while the
+ * link is slow or lossy. The backoff stays in force for later requests of
+ * the class until one of them is answered at the first attempt. Requests
+ * timing out together only count once.
+ */
+void NyarkoaPayload::backOff(PendingRequest &req) {
+  if (req.rttClass >= RTT_CLASS_COUNT) return;
+  RttEstimate &estimate = rttEstimates[req.rttClass];
+  byte steps = req.attempts < retryPolicy.maxBackoff ? req.attempts
+                                                     : retryPolicy.maxBackoff;
+  if (estimate.backoff < steps) estimate.backoff = steps;
+}
+
+/**
+ * Find the request waiting for its response, if it is the only one.
+ *
+ * @return The request, or nullptr if none or several are waiting.
+ */
+PendingRequest *NyarkoaPayload::soleWaiting() {
+  PendingRequest *waiting = nullptr;
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    if (requests[i].state != REQ_WAITING) continue;
+    if (waiting != nullptr) return nullptr;
+    waiting = &requests[i];
+  }
+  return waiting;
+}
+
+/**
+ * Check whether any request is waiting for its response.
+ *
+ * @return true if a request has been sent and not yet answered.
+ */
+bool NyarkoaPayload::isLinkBusy() {
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    if (requests[i].state == REQ_WAITING) return true;
+  }
+  return false;
+}
+
+/**
+ * Collect the legacy text response to the request on the link.
+ *
+ * @param req The request waiting for a response.
+ *
+ * The response must echo the hash of the command, followed for requests by
+ * ':' and the payload. A response that fails the check is retried while
+ * attempts remain.
+ */
+void NyarkoaPayload::receiveLine(PendingRequest &req) {
+  if (!readLine()) return;
+  NLOG_DEBUG(F("RCVD: "), rxLine);
+
+  const char *text = formatRequest(req);
+  size_t length = strlen(rxLine);
+  const char *sep = strchr(rxLine, ':');
+  if (req.isCommand || sep == nullptr) {
+    acceptReply(req, checkHash(text, rxLine, length), nullptr, 0);
+  } else {
+    acceptReply(req, checkHash(text, rxLine, sep - rxLine),
+                reinterpret_cast<const byte *>(sep + 1),
+                length - (sep + 1 - rxLine));
+  }
+}
+
+/**
+ * Collect the lines that have arrived on a CRC link.
+ *
+ * Each complete line is either the response to the request on the link or
+ * a reading pushed by a subscribed sensor.
+ */
+void NyarkoaPayload::receiveCheckedLines() {
+  while (readLine()) {
+    NLOG_DEBUG(F("RCVD: "), rxLine);
+    acceptCheckedLine(soleWaiting());
+  }
+}
+
+/**
+ * Check a CRC link line and hand it to its request or sensor.
+ *
+ * @param req The request waiting for a response, or nullptr if none is.
+ *
+ * A response line reads "<echo>:<payload>*<crc>", or "<echo>*<crc>" for a
+ * command. The echo is the CRC-16 of the command the line answers; the final
+ * CRC-16 covers everything before the '*'. A pushed reading reads
+ * "!<command>:<payload>*<crc>", with the sensor's command and the payload of
+ * its response. Only a response line whose CRC fails is retried. An intact
+ * line whose echo belongs to another command, such as the late answer to an
+ * earlier request, is dropped and the request keeps waiting.
+ */
+void NyarkoaPayload::acceptCheckedLine(PendingRequest *req) {
+  char *mark = strrchr(rxLine, '*');
+  uint16_t crc;
+  if (mark == nullptr || !hexToCrc16(mark + 1, crc) ||
+      crc != crc16(rxLine, mark - rxLine)) {
+    NLOG_WARN(F("RCVD: bad CRC"));
+    LINK_STAT(checkFailures++);
+    if (req != nullptr && rxLine[0] != '!') retryRequest(*req);
+    return;
+  }
+  *mark = '\0';
+
+  char *sep = strchr(rxLine, ':');
+  if (sep != nullptr) *sep = '\0';
+  if (rxLine[0] == '!') {
+    if (sep == nullptr) return;
+    acceptPush(commandId(commandIndex(rxLine + 1)),
+               reinterpret_cast<const byte *>(sep + 1), mark - sep - 1);
+    return;
+  }
+  uint16_t echo;
+  const char *text = req != nullptr ? formatRequest(*req) : nullptr;
+  if (text == nullptr || !hexToCrc16(rxLine, echo) ||
+      echo != crc16(text, strlen(text))) {
+    NLOG_DEBUG(F("RCVD: stray reply"));
+    return;
+  }
+  if (req->isCommand || sep == nullptr) {
+    acceptReply(*req, true, nullptr, 0);
+  } else {
+    acceptReply(*req, true, reinterpret_cast<const byte *>(sep + 1),
+                mark - sep - 1);
+  }
+}
+
+/**
+ * Collect binary replies and hand each to its request.
+ *
+ * Replies are matched to waiting requests by sequence number, so they may
+ * arrive in any order. A reply nobody is waiting for, such as the late answer
+ * to an attempt that has already been retried, is dropped. Frames with
+ * FRAME_PUSH_SEQ carry readings of subscribed sensors. A frame that fails
+ * its CRC cannot be trusted to name its request. If only one request is
+ * waiting and no sensor is subscribed the frame must be its reply and it is
+ * retried at once; otherwise the request it belonged to is retried when its
+ * deadline passes. A CMD_NACK reply, the module saying it cannot execute
+ * the request, fails the request at once: another attempt would be refused
+ * too.
+ */
+void NyarkoaPayload::receiveFrames() {
+  while (commLink->available()) {
+    FrameStatus status = rxParser.feed(commLink->read());
+    countReceived(1);
+    if (status == FRAME_CORRUPT) {
+      NLOG_WARN(F("RCVD: bad frame"));
+      LINK_STAT(checkFailures++);
+      PendingRequest *only = soleWaiting();
+      if (only != nullptr && subscriptions == 0) retryRequest(*only);
+    }
+    if (status != FRAME_COMPLETE) continue;
+
+    const Frame &reply = rxParser.frame();
+    if (reply.seq == FRAME_PUSH_SEQ) {
+      acceptPush(reply.cmd & ~FRAME_REPLY, reply.payload, reply.length);
+      continue;
+    }
+    for (byte i = 0; i < REQUEST_SLOTS; i++) {
+      PendingRequest &req = requests[i];
+      if (req.state != REQ_WAITING || req.seq != reply.seq) continue;
+      if (reply.cmd == CMD_NACK) {
+        NLOG_WARN(F("RCVD: NACK"));
+        completeRequest(req, false);
+      } else {
+        acceptReply(req, reply.cmd == (req.cmdId | FRAME_REPLY),
+                    reply.payload, reply.length);
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * Finish or retry a request once its response has been checked.
+ *
+ * @param req The request the response belongs to.
+ * @param isValid Whether the response passed its integrity checks.
+ * @param payload The response payload, if any.
+ * @param length The payload length in bytes.
+ */
+void NyarkoaPayload::acceptReply(PendingRequest &req, bool isValid,
+                                 const byte *payload, byte length) {
+  if (!isValid) {
+    LINK_STAT(checkFailures++);
+    retryRequest(req);
+    return;
+  }
+  if (!req.isCommand && !keepReply(req, payload, length)) {
+    // left to time out and be asked again, once results have been collected
+    NLOG_WARN(F("RCVD: reply buffer full"));
+    return;
+  }
+  sampleRtt(req);
+  recordRtt(req);
+  NLOG_DEBUG(F("Trans OK"));
+  completeRequest(req, true);
+}
+
+static_assert(NYARKOA_RESULT_SIZE < 255, "reply offsets are kept in a byte");
+
+/**
+ * Keep the payload of a reply in the shared reply buffer.
+ *
+ * @param req The request the reply answers.
+ * @param payload The reply payload.
+ * @param length The payload length in bytes.
+ * @return true if the payload was kept; false if the replies of finished
+ * requests whose results have not been collected leave no room for it.
+ *
+ * Replies are kept one after the other, each followed by a NUL. A reply
+ * longer than NYARKOA_RESULT_SIZE is truncated.
+ */
+bool NyarkoaPayload::keepReply(PendingRequest &req, const byte *payload,
+                               byte length) {
+  if (length > NYARKOA_RESULT_SIZE) length = NYARKOA_RESULT_SIZE;
+  byte top = 0;
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    const PendingRequest &held = requests[i];
+    if (held.replySize && held.replyAt + held.replySize > top) {
+      top = held.replyAt + held.replySize;
+    }
+  }
+  if (top + length > NYARKOA_RESULT_SIZE) top = packReplies();
+  if (top + length > NYARKOA_RESULT_SIZE) return false;
+
+  if (length) memcpy(replies + top, payload, length);
+  replies[top + length] = '\0';
+  req.replyAt = top;
+  req.replySize = length + 1;
+  return true;
+}
+
+/**
+ * Move the replies held in the reply buffer to its start.
+ *
+ * @return The number of bytes they take.
+ */
+byte NyarkoaPayload::packReplies() {
+  byte top = 0;
+  while (true) {
+    // the lowest reply not moved yet; every moved one ends at or below top
+    PendingRequest *next = nullptr;
+    for (byte i = 0; i < REQUEST_SLOTS; i++) {
+      PendingRequest &held = requests[i];
+      if (held.replySize && held.replyAt >= top &&
+          (next == nullptr || held.replyAt < next->replyAt)) {
+        next = &held;
+      }
+    }
+    if (next == nullptr) return top;
+    memmove(replies + top, replies + next->replyAt, next->replySize);
+    next->replyAt = top;
+    top += next->replySize;
+  }
+}
+
+/**
+ * Queue a reading pushed by a subscribed sensor.
+ *
+ * @param cmdId The sensor's command, e.g. CMD_MPU.
+ * @param payload The reading, in the form of the command's response payload.
+ * @param length The payload length in bytes.
+ *
+ * Without subscriptions (NYARKOA_STREAM_DEPTH 0) no reading is expected, and
+ * any that arrives is dropped.
+ */
+void NyarkoaPayload::acceptPush(byte cmdId, const byte *payload,
+                                byte length) {
+#if NYARKOA_STREAM_DEPTH
+  unsigned long now = millis();
+  float values[7];
+  GPSData gps;
+  bool isOk = false;
+  switch (cmdId) {
+    case CMD_MPU:
+      isOk = decodeValues(payload, length, values, 7);
+      if (isOk) mpuStream.push(toMPUData(values), now);
+      break;
+    case CMD_MPL:
+      isOk = decodeValues(payload, length, values, 3);
+      if (isOk) mplStream.push(toMPLData(values), now);
+      break;
+    case CMD_GPS:
+      isOk = decodeGPSData(payload, length, gps);
+      if (isOk) gpsStream.push(gps, now);
+      break;
+    default:
+      break;
+  }
+  if (!isOk) NLOG_WARN(F("RCVD: bad push"));
+#else
+  NLOG_WARN(F("RCVD: push without subscriptions"));
+#endif
+}
+
+/**
+ * Mark a request as finished and report it.
+ *
+ * @param req The request.
+ * @param isOk Whether the request succeeded.
+ *
+ * Asynchronous requests are handed to the request callback, if one is set,
+ * and their slot freed; otherwise the result waits for `getResult`.
+ */
+void NyarkoaPayload::completeRequest(PendingRequest &req, bool isOk) {
+  req.state = isOk ? REQ_DONE : REQ_FAILED;
+  if (!isOk) LINK_STAT(failures++);
+  if (!req.notify || requestCallback == nullptr) return;
+  byte handle = req.handle;
+  Response response = requestResult(req);
+  releaseRequest(req);
+  requestCallback(handle, response);
+}
+
+/**
+ * Free a request's slot.
+ *
+ * @param req The request to forget.
+ */
+void NyarkoaPayload::releaseRequest(PendingRequest &req) {
+  req.handle = 0;
+  req.state = REQ_FREE;
+  req.replySize = 0;
+}
+
+/**
+ * Write out the text of a request, as the comm module receives it.
+ *
+ * @param req The request.
+ * @return The text, e.g. "AT_ALERT:100", valid until the next request is
+ * formatted.
+ *
+ * Requests keep no copy of their text. It is rebuilt from the command table
+ * for every attempt and for checking the response, and a batch of ground
+ * station records from the records still queued.
+ */
+const char *NyarkoaPayload::formatRequest(const PendingRequest &req) {
+  if (req.text != nullptr) return req.text;
+#if NYARKOA_DOWNLINK_SIZE
+  if (req.handle == downlinkHandle) {
+    const char *prefix =
+        memchr(downlink, ';', downlinkSent) ? "GS::BATCH::" : "GS::";
+    size_t at = strlen(prefix);
+    memcpy(cmdText, prefix, at);
+    memcpy(cmdText + at, downlink, downlinkSent);
+    cmdText[at + downlinkSent] = '\0';
+    return cmdText;
+  }
+#endif
+  byte at = commandName(req.cmdIndex, cmdText);
+  strcpy(cmdText + at, req.args);
+  return cmdText;
+}
+
+/**
+ * Build the Response object for a finished request.
+ *
+ * @param req The finished request.
+ * @return "OK" for a successful command, the payload for a successful
+ * request, and the same failure messages as `executeCmd` and `request`.
+ */
+Response NyarkoaPayload::requestResult(PendingRequest &req) {
+  if (req.state != REQ_DONE) {
+    return {.isOk = false, .message = req.isCommand ? "Req. failed" : "FAILED"};
+  }
+  if (req.isCommand) return {.isOk = true, .message = "OK"};
+  return {.isOk = true,
+          .message = NyarkoaText(
+              reinterpret_cast<const char *>(replyData(req)))};
+}
+
+/**
+ * Record the round-trip time of an answered request.
+ *
+ * @param req The request whose answer has just been accepted.
+ */
+void NyarkoaPayload::recordRtt(PendingRequest &req) {
+#if NYARKOA_LINK_STATS >= 2
+  if (req.cmdIndex >= COMMAND_COUNT) return;
+  CommandStats &stats = commandStats[req.cmdIndex];
+  unsigned long elapsed = millis() - req.sentAt;
+  uint16_t rtt = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+  if (stats.count == 0xFFFF) {
+    // keep the average, forget half the history
+    stats.count /= 2;
+    stats.rttTotal /= 2;
+  }
+  if (stats.count == 0 || rtt < stats.rttMin) stats.rttMin = rtt;
+  if (rtt > stats.rttMax) stats.rttMax = rtt;
+  stats.count++;
+  stats.rttTotal += rtt;
+#else
+  (void)req;
+#endif
+}
+
+#if NYARKOA_LINK_STATS
+/**
+ * Get the link statistics.
+ *
+ * @return The counters of requests, retries, timeouts, failed checks, failed
+ * requests and bytes in each direction since the last connection or
+ * `resetLinkStats`. The counters are updated in place, so the reference
+ * always shows the current values; copy the struct to keep a snapshot.
+ */
+const LinkStats &NyarkoaPayload::getLinkStats() { return linkStats; }
+
+/**
+ * Get the round-trip times of one command.
+ *
+ * @param id The command, e.g. CMD_MPU for "AT_MPU".
+ * @return The number of answers timed and their minimum, maximum and total
+ * round-trip time in milliseconds. All fields are zero for an unknown
+ * command, or if NYARKOA_LINK_STATS is below 2.
+ */
+CommandStats NyarkoaPayload::getCommandStats(CommandId id) {
+  CommandStats stats = {};
+#if NYARKOA_LINK_STATS >= 2
+  byte index = commandIndex(id);
+  if (index < COMMAND_COUNT) stats = commandStats[index];
+#else
+  (void)id;
+#endif
+  return stats;
+}
+
+/**
+ * Clear the link statistics.
+ */
+void NyarkoaPayload::resetLinkStats() {
+  memset(&linkStats, 0, sizeof(linkStats));
+#if NYARKOA_LINK_STATS >= 2
+  memset(commandStats, 0, sizeof(commandStats));
+#endif
+}
+
+// Each report goes out as "GS::<cmd>::" plus up to four 10-digit counters
+// and their commas, and must fit in a command.
+static const size_t STATS_PAYLOAD_SIZE =
+    NYARKOA_CMD_SIZE - (sizeof("GS::STATS::") - 1);
+static_assert(4 * 10 + 3 < STATS_PAYLOAD_SIZE,
+              "a link statistics report must fit in NYARKOA_CMD_SIZE");
+static_assert(sizeof("GS::BYTES::") == sizeof("GS::STATS::"),
+              "both reports leave the same room for counters");
+
+/**
+ * Report the link statistics to the ground station.
+ *
+ * @return true if the ground station acknowledged both reports; otherwise,
+ * false.
+ *
+ * This method sends two messages, so that every counter fits in a command.
+ * "GS::STATS::" carries the requests, retries, timeouts and failed requests,
+ * "GS::BYTES::" the bytes sent, bytes received and failed checks, each as
+ * comma-separated decimals. The values are those from before the reports
+ * were sent. The second report is not sent if the first one fails.
+ */
+bool NyarkoaPayload::downlinkLinkStats() {
+  char stats[STATS_PAYLOAD_SIZE];
+  snprintf(stats, sizeof(stats), "%lu,%lu,%lu,%lu",
+           (unsigned long)linkStats.requests, (unsigned long)linkStats.retries,
+           (unsigned long)linkStats.timeouts,
+           (unsigned long)linkStats.failures);
+  char bytes[STATS_PAYLOAD_SIZE];
+  snprintf(bytes, sizeof(bytes), "%lu,%lu,%lu",
+           (unsigned long)linkStats.bytesSent,
+           (unsigned long)linkStats.bytesReceived,
+           (unsigned long)linkStats.checkFailures);
+  return contactGroundStation("STATS", stats) &&
+         contactGroundStation("BYTES", bytes);
+}
+#endif
+
 /**
  * Check if a pin is a special pin that requires special handling.
  *
@@ -297,17 +1485,16 @@ bool NyarkoaPayload::pinInfo(byte pin) {
   static const char* specialMessages[] = {
       "SPI CS",  "SPI MISO", "SPI MOSI", "SPI SCK", "I2C SDA", "I2C SCL",
       "Comm Rx", "Comm Tx",  analog,     analog,    analog,    analog};
+  (void)specialMessages;  // only read by log messages
 
   for (size_t i = 0; i < sizeof(specialPins) / sizeof(specialPins[0]); i++) {
     if (pin == specialPins[i]) {
-      
       if (pin == commUARTPins.Rx || pin == commUARTPins.Tx) {
-        debug("ERROR: Pin #" + String(pin) + " is special: " + specialMessages[i]);
+        NLOG_ERROR(F("ERROR: Pin is special: "), specialMessages[i]);
         return false;
-      } else {
-        debug("WARNING: Pin #" + String(pin) + " is special: " + specialMessages[i]);
-        break;
       }
+      NLOG_WARN(F("WARNING: Pin is special: "), specialMessages[i]);
+      break;
     }
   }
   return true;
@@ -384,7 +1571,7 @@ void NyarkoaPayload::setAnalogValue(byte pin, int value) {
   }
 
   // If the function reaches here, it's an invalid PWM pin
-  debug("Pin D" + String(pin) + " lacks PWM capability.");
+  NLOG_WARN(F("Pin D"), pin, F(" lacks PWM capability."));
 }
 
 /**
@@ -405,12 +1592,145 @@ void NyarkoaPayload::setAnalogValue(byte pin, int value) {
  * @param payload The payload to include in the request.
  * @return true if the operation was successful; otherwise, false.
  */
-bool NyarkoaPayload::contactGroundStation(String cmd, String payload) {
-  String req = +"GS::" + cmd + "::" + payload;
-  debug("TRANS: " + req);
-  String resp = requestAction(req);
-  return contains(resp, "GS_OK");
+bool NyarkoaPayload::contactGroundStation(const char *cmd,
+                                          const char *payload) {
+  char req[NYARKOA_CMD_SIZE];
+  size_t length = snprintf(req, sizeof(req), "GS::%s::%s", cmd, payload);
+  if (length >= sizeof(req)) {
+    NLOG_ERROR(F("GS message too long: "), cmd);
+    return false;
+  }
+  NLOG_DEBUG(F("TRANS: "), req);
+  Response response = request(req);
+  return response.isOk && contains(response.message, "GS_OK");
+}
+
+#if NYARKOA_DOWNLINK_SIZE
+/**
+ * Queue a record for the ground station.
+ *
+ * @param cmd The record's command, e.g. "AT_EJECT".
+ * @param payload The record's payload, e.g. "OK".
+ * @return true if the record was queued; false if it is too long or holds a
+ * ';'.
+ *
+ * Records wait in a queue of NYARKOA_DOWNLINK_SIZE bytes and are sent
+ * together as one "GS::BATCH::cmd::payload;cmd::payload" message, which the
+ * ground station acknowledges once with "GS_OK". `poll` sends a batch once
+ * the queued records fill a message or the oldest has waited
+ * NYARKOA_DOWNLINK_AGE ms; a batch of one record is sent as
+ * "GS::cmd::payload", as `contactGroundStation` would. Records of a batch
+ * that is not acknowledged stay queued and are sent again, the oldest alone
+ * first: if it gets through where the batch did not, the module or ground
+ * station does not know "GS::BATCH::", and from then on every record is sent
+ * in a message of its own (see `isBatchingRefused`). When the queue is full
+ * this method waits for the batch on its way, or sends one and waits for
+ * it, and drops the oldest records only if the ground station did not
+ * acknowledge them.
+ *
+ * A record may be up to DOWNLINK_RECORD_MAX characters as "cmd::payload".
+ */
+bool NyarkoaPayload::queueDownlink(const char *cmd, const char *payload) {
+  size_t length = strlen(cmd) + 2 + strlen(payload);
+  if (length > DOWNLINK_RECORD_MAX || length >= NYARKOA_DOWNLINK_SIZE ||
+      strchr(cmd, ';') != nullptr || strchr(payload, ';') != nullptr) {
+    NLOG_ERROR(F("Bad GS record: "), cmd);
+    return false;
+  }
+  while (downlinkLength + (downlinkLength ? 1 : 0) + length >
+         NYARKOA_DOWNLINK_SIZE) {
+    // a failed batch is followed by its oldest record alone before any drop
+    if (!sendBatch() && batchMode != BATCH_PROBE) dropDownlinkRecord();
+  }
+  if (downlinkLength == 0) {
+    downlinkSince = millis();
+  } else {
+    downlink[downlinkLength++] = ';';
+  }
+  // the record fits, so its parts can be copied without checks
+  char *record = downlink + downlinkLength;
+  size_t cmdLength = strlen(cmd);
+  memcpy(record, cmd, cmdLength);
+  memcpy(record + cmdLength, "::", 2);
+  memcpy(record + cmdLength + 2, payload, length - cmdLength - 2);
+  downlinkLength += length;
+  serviceDownlink();
+  return true;
+}
+
+static_assert(4 + 2 + DELTA_TEXT_SIZE - 1 <= DOWNLINK_RECORD_MAX,
+              "the longest delta record must fit a ground station record");
+
+/**
+ * Queue an MPU reading for the ground station as a compact delta record.
+ *
+ * @param data The reading.
+ * @return true if the record was queued; otherwise, false.
+ *
+ * The reading is queued with `queueDownlink` as a "DMPU" record, encoded by
+ * NyarkoaDeltaEncoder as its change from the previous reading. In flight a
+ * record takes about 19 characters, its name included, where "MPU::" and
+ * the decimal text take 42. NyarkoaDeltaDecoder reads the records back.
+ */
+bool NyarkoaPayload::queueTelemetry(const MPUData &data) {
+  char text[DELTA_TEXT_SIZE];
+  if (telemetryEncoder.encode(data, text, sizeof(text)) == 0) return false;
+  return queueDownlink(deltaStreamName(DELTA_MPU), text);
+}
+
+/**
+ * Queue an MPL reading for the ground station as a compact delta record.
+ *
+ * @param data The reading.
+ * @return true if the record was queued; otherwise, false.
+ */
+bool NyarkoaPayload::queueTelemetry(const MPLData &data) {
+  char text[DELTA_TEXT_SIZE];
+  if (telemetryEncoder.encode(data, text, sizeof(text)) == 0) return false;
+  return queueDownlink(deltaStreamName(DELTA_MPL), text);
+}
+
+/**
+ * Queue a GPS fix for the ground station as a compact delta record.
+ *
+ * @param data The fix.
+ * @return true if the record was queued; otherwise, false.
+ */
+bool NyarkoaPayload::queueTelemetry(const GPSData &data) {
+  char text[DELTA_TEXT_SIZE];
+  if (telemetryEncoder.encode(data, text, sizeof(text)) == 0) return false;
+  return queueDownlink(deltaStreamName(DELTA_GPS), text);
+}
+
+/**
+ * Queue a snapshot for the ground station as three delta records.
+ *
+ * @param snapshot The snapshot.
+ * @return true if every record was queued; otherwise, false.
+ */
+bool NyarkoaPayload::queueTelemetry(const Snapshot &snapshot) {
+  bool isOk = queueTelemetry(snapshot.mpu);
+  isOk = queueTelemetry(snapshot.mpl) && isOk;
+  return queueTelemetry(snapshot.gps) && isOk;
+}
+
+/**
+ * Send every queued ground station record and wait for the acknowledgements.
+ *
+ * @return true if the queue is empty; false if a message failed, in which
+ * case its records stay queued. A failed batch of several records is first
+ * followed by its oldest record alone, as described for `queueDownlink`.
+ *
+ * Call this, for example, before a step that keeps the sketch from calling
+ * `poll` for a while.
+ */
+bool NyarkoaPayload::flushDownlink() {
+  while (downlinkLength > 0) {
+    if (!sendBatch() && batchMode != BATCH_PROBE) return false;
+  }
+  return true;
 }
+#endif
 
 /**
  * Perform a communication module action.
@@ -423,14 +1743,13 @@ bool NyarkoaPayload::contactGroundStation(String cmd, String payload) {
  * response. If the response is successful (isOk is true), the message "OK" is
  * sent to the ground station using the `contactGroundStation` method. If the
  * response is not successful, the message "FAILED" is sent to the ground
- * station.
+ * station. The report is sent at once, not queued with `queueDownlink`.
  *
  * @param cmd The command to execute using the communication module.
  */
-void NyarkoaPayload::commAction(String cmd) {
+void NyarkoaPayload::commAction(const char *cmd) {
   Response response = executeCmd(cmd);
-  String message = response.isOk ? "OK" : "FAILED";
-  contactGroundStation(cmd, message);
+  contactGroundStation(cmd, response.isOk ? "OK" : "FAILED");
 }
 
 /**
@@ -450,9 +1769,343 @@ void NyarkoaPayload::commAction(String cmd) {
  * @return The response message from the communication module, or an empty
  * string if the request failed.
  */
-String NyarkoaPayload::requestAction(String cmd) {
+NyarkoaText NyarkoaPayload::requestAction(const char *cmd) {
   Response response = request(cmd);
-  return response.isOk ? response.message : "";
+  return response.isOk ? response.message : NyarkoaText("");
+}
+
+/**
+ * Send a request and wait for its payload.
+ *
+ * @param req The request command to send.
+ * @return The finished request holding the payload, or nullptr if the request
+ * failed. The caller must release the request once it has read the payload.
+ */
+PendingRequest *NyarkoaPayload::runRequest(const char *req) {
+  byte handle = queueRequest(req, false, OWNER_LIBRARY);
+  PendingRequest *pending = awaitRequest(handle);
+  if (pending == nullptr) return nullptr;
+  if (pending->state != REQ_DONE) {
+    releaseRequest(*pending);
+    return nullptr;
+  }
+  return pending;
+}
+
+/**
+ * Sync the local clock with the communication module.
+ *
+ * @return true if the module's time was read and applied; otherwise, false.
+ *
+ * `getDate`, `getTime`, `getTimestamp` and `getTimeAfter` are answered from a
+ * local clock that runs on millis(). The first of these calls sets it with an
+ * "AT_TSTAMP" request; call this method, for example from setup(), to do so
+ * ahead of time. Afterwards `poll`, and with it every blocking call, checks
+ * the clock against the module in the background and corrects its offset and
+ * drift.
+ */
+bool NyarkoaPayload::syncClock() {
+  if (commLink == nullptr) return false;
+  for (byte attempt = 0; attempt < 2; attempt++) {
+    clockSampled = false;
+    if (clockRequest == 0) {
+      clockRequest = queueRequest("AT_TSTAMP", false, OWNER_CLOCK);
+      if (clockRequest == 0) return false;
+    }
+    while (clockRequest != 0) poll();
+    if (clockSampled) return true;
+    // only an answer to a retried request is worth asking again for
+    if (!moduleClock.isSyncDue(millis())) return false;
+  }
+  return false;
+}
+
+/**
+ * Start or finish the request that checks the local clock.
+ *
+ * Called at the end of every `poll`. A new check is only started while no
+ * other request is on the link or queued, so that it does not hold up the
+ * sketch's requests, and only in the library's slot, so that it never
+ * takes one of the sketch's.
+ */
+void NyarkoaPayload::serviceClock() {
+  if (clockRequest != 0) {
+    PendingRequest *req = findRequest(clockRequest);
+    if (req == nullptr) {
+      clockRequest = 0;
+    } else if (req->state == REQ_DONE || req->state == REQ_FAILED) {
+      finishClockRequest(*req);
+    }
+    return;
+  }
+  if (!moduleClock.isSynced() || !moduleClock.isSyncDue(millis())) return;
+
+  for (byte i = 0; i < REQUEST_SLOTS; i++) {
+    byte state = requests[i].state;
+    if (state == REQ_QUEUED || state == REQ_WAITING) return;
+  }
+  if (requests[LIBRARY_SLOT].state == REQ_FREE) {
+    clockRequest = queueRequest("AT_TSTAMP", false, OWNER_CLOCK);
+  }
+}
+
+/**
+ * Apply the answer to a clock check.
+ *
+ * @param req The finished "AT_TSTAMP" request; its slot is freed.
+ *
+ * Following Karn's algorithm, an answer to a retried request is not used:
+ * it may belong to an earlier attempt, so its round trip is unknown. The
+ * check stays due and is repeated. A failed request, or a timestamp that
+ * cannot be read (such as a module clock without a date yet), postpones the
+ * next check.
+ */
+void NyarkoaPayload::finishClockRequest(PendingRequest &req) {
+  unsigned long receivedAt = millis();
+  uint32_t dateTime;
+  if (req.state == REQ_DONE &&
+      parseGPSTimestamp(reinterpret_cast<const char *>(replyData(req)),
+                        dateTime) &&
+      gpsMonth(dateTime) != 0) {
+    if (req.attempts == 1) {
+      moduleClock.addSample(gpsToSeconds(dateTime), req.sentAt, receivedAt);
+      clockSampled = true;
+    }
+  } else {
+    NLOG_WARN(F("Clock sync failed"));
+    moduleClock.deferSync(receivedAt);
+  }
+  clockRequest = 0;
+  releaseRequest(req);
+}
+
+#if NYARKOA_DOWNLINK_SIZE
+/**
+ * Start or finish the batch of ground station records.
+ *
+ * Called at the end of every `poll`. A batch is sent once the queued records
+ * fill a message or the oldest has waited NYARKOA_DOWNLINK_AGE ms.
+ */
+void NyarkoaPayload::serviceDownlink() {
+  if (downlinkHandle != 0) {
+    PendingRequest *req = findRequest(downlinkHandle);
+    if (req == nullptr) {
+      downlinkHandle = 0;
+    } else if (req->state == REQ_DONE || req->state == REQ_FAILED) {
+      finishBatch(*req);
+    }
+    return;
+  }
+  if (downlinkLength == 0 || commLink == nullptr) return;
+  if (downlinkLength < DOWNLINK_BATCH_MAX &&
+      millis() - downlinkSince < NYARKOA_DOWNLINK_AGE) {
+    return;
+  }
+  startBatch();
+}
+
+/**
+ * Queue a message carrying the oldest ground station records.
+ *
+ * @return true if the message was queued; false if no record is queued or
+ * a batch is already on its way.
+ *
+ * The message takes as many whole records as fit, and at least the oldest;
+ * only the oldest unless `batchMode` is BATCH_ON. Its text is built from the
+ * queue whenever it is sent. It runs in a slot of its own, so however long
+ * its attempts take, it holds up none of the sketch's requests or blocking
+ * calls.
+ */
+bool NyarkoaPayload::startBatch() {
+  if (downlinkLength == 0) return false;
+
+  uint16_t end = 0;
+  byte records = 0;
+  for (uint16_t i = 0; i <= downlinkLength; i++) {
+    if (i < downlinkLength && downlink[i] != ';') continue;
+    if (records > 0 && (i > DOWNLINK_BATCH_MAX || batchMode != BATCH_ON)) {
+      break;
+    }
+    end = i;
+    records++;
+  }
+  byte handle = queueRequest("GS::", false, OWNER_DOWNLINK);
+  PendingRequest *req = findRequest(handle);
+  if (req == nullptr) return false;
+  downlinkHandle = handle;
+  downlinkSent = end;
+  NLOG_DEBUG(F("TRANS: "), formatRequest(*req));
+  return true;
+}
+
+/**
+ * Apply the answer to a batch of ground station records.
+ *
+ * @param req The finished batch request; its slot is freed.
+ *
+ * Acknowledged records leave the queue. The records left keep the time of
+ * the oldest, so that they follow at once: they only remain if the queue
+ * held more than one message.
+ *
+ * A failed batch of several records is followed by its oldest record alone.
+ * If that one is acknowledged, batches are refused rather than lost, and
+ * records go one per message until a different transport is connected; if
+ * it fails too, the link is to blame and batching resumes.
+ */
+void NyarkoaPayload::finishBatch(PendingRequest &req) {
+  bool isBatch = memchr(downlink, ';', downlinkSent) != nullptr;
+  if (req.state == REQ_DONE &&
+      contains(reinterpret_cast<const char *>(replyData(req)), "GS_OK")) {
+    if (batchMode == BATCH_PROBE) {
+      NLOG_WARN(F("GS batches refused"));
+      batchMode = BATCH_OFF;
+    }
+    downlinkStats.records++;
+    for (uint16_t i = 0; i < downlinkSent; i++) {
+      if (downlink[i] == ';') downlinkStats.records++;
+    }
+    downlinkStats.batches++;
+    uint16_t removed = downlinkSent + (downlinkSent < downlinkLength);
+    downlinkLength -= removed;
+    memmove(downlink, downlink + removed, downlinkLength);
+  } else {
+    NLOG_WARN(F("GS batch failed"));
+    downlinkStats.failures++;
+    if (isBatch) {
+      batchMode = BATCH_PROBE;
+    } else if (batchMode == BATCH_PROBE) {
+      batchMode = BATCH_ON;
+    }
+  }
+  downlinkHandle = 0;
+  releaseRequest(req);
+}
+
+/**
+ * Send a batch of ground station records and wait for it.
+ *
+ * @return true if the ground station acknowledged the batch; otherwise,
+ * false. A batch already on its way is waited for instead.
+ */
+bool NyarkoaPayload::sendBatch() {
+  if (commLink == nullptr) return false;
+  uint32_t failures = downlinkStats.failures;
+  if (downlinkHandle == 0 && !startBatch()) return false;
+  while (downlinkHandle != 0) poll();
+  return downlinkStats.failures == failures;
+}
+
+/**
+ * Drop the oldest queued ground station record.
+ */
+void NyarkoaPayload::dropDownlinkRecord() {
+  uint16_t removed = 0;
+  while (removed < downlinkLength && downlink[removed] != ';') removed++;
+  if (removed < downlinkLength) removed++;
+  downlinkLength -= removed;
+  memmove(downlink, downlink + removed, downlinkLength);
+  downlinkStats.dropped++;
+  // the ground station cannot follow the deltas past the gap
+  telemetryEncoder.requestKey();
+  NLOG_WARN(F("GS record dropped"));
+}
+#endif
+
+/**
+ * Read the local copy of the module's clock, syncing it first if needed.
+ *
+ * @param seconds Receives the time in seconds since 2000-01-01.
+ * @return true if the clock is synced; otherwise, false.
+ */
+bool NyarkoaPayload::readClock(uint32_t &seconds) {
+  if (!moduleClock.isSynced() && moduleClock.isSyncDue(millis())) syncClock();
+  if (!moduleClock.isSynced()) return false;
+  seconds = moduleClock.read(millis());
+  return true;
+}
+
+/**
+ * Request a list of sensor readings.
+ *
+ * @param req The request command to send, e.g. "AT_MPU".
+ * @param values The array that receives the readings.
+ * @param count The number of readings expected.
+ * @return true if all readings were received; otherwise, false, with the
+ * missing readings set to zero.
+ *
+ * On the text protocol the readings arrive as comma-separated decimals and
+ * are converted where they lie in the reply buffer. On a binary link they
+ * arrive as packed floats and are copied without parsing.
+ */
+bool NyarkoaPayload::requestValues(const char *req, float *values,
+                                   byte count) {
+  for (byte i = 0; i < count; i++) values[i] = 0;
+
+  PendingRequest *reply = runRequest(req);
+  if (reply == nullptr) return false;
+
+  bool isOk =
+      decodeValues(replyData(*reply), replyLength(*reply), values, count);
+  releaseRequest(*reply);
+  if (!isOk) NLOG_WARN(F("Bad payload: "), req);
+  return isOk;
+}
+
+/**
+ * Decode the sensor readings of a response payload.
+ *
+ * @param payload The payload: comma-separated decimals on the text protocol,
+ * NUL-terminated, or packed floats on a binary link.
+ * @param length The payload length in bytes.
+ * @param values The array that receives the readings.
+ * @param count The number of readings expected.
+ * @return true if exactly `count` readings were decoded; otherwise, false.
+ */
+bool NyarkoaPayload::decodeValues(const byte *payload, byte length,
+                                  float *values, byte count) {
+  if (binaryLink) {
+    if (length != count * sizeof(float)) return false;
+    memcpy(values, payload, length);
+    return true;
+  }
+  CsvTokenizer csv(reinterpret_cast<const char *>(payload));
+  return parseValues(csv, values, count) && csv.atEnd();
+}
+
+/**
+ * Decode the GPS fields of a response payload.
+ *
+ * @param payload The payload: comma-separated fields on the text protocol,
+ * NUL-terminated, or the packed GPS record on a binary link.
+ * @param length The payload length in bytes.
+ * @param gps Receives the fields.
+ * @return true if every field was decoded; otherwise, false.
+ */
+bool NyarkoaPayload::decodeGPSData(const byte *payload, byte length,
+                                   GPSData &gps) {
+  if (binaryLink) {
+    if (length != GPS_RECORD_SIZE) return false;
+    readGPSRecord(payload, gps);
+    return true;
+  }
+  CsvTokenizer csv(reinterpret_cast<const char *>(payload));
+  return parseGPSData(csv, gps) && csv.atEnd();
+}
+
+/**
+ * Parse comma-separated readings.
+ *
+ * @param csv The tokenizer positioned at the first reading.
+ * @param values The array that receives the readings.
+ * @param count The number of readings to parse.
+ * @return true if all readings were present and numeric; otherwise, false.
+ */
+bool NyarkoaPayload::parseValues(CsvTokenizer &csv, float *values,
+                                 byte count) {
+  for (byte i = 0; i < count; i++) {
+    if (!csv.nextFloat(values[i])) return false;
+  }
+  return true;
 }
 
 /**
@@ -469,8 +2122,8 @@ String NyarkoaPayload::requestAction(String cmd) {
  * the ground station, indicating whether the ejection was successful or not.
  */
 void NyarkoaPayload::ejectBalloon() {
-  String action = "AT_EJECT";
-  debug("\nCMD: " + action);
+  const char *action = "AT_EJECT";
+  NLOG_DEBUG(F("\nCMD: "), action);
   commAction(action);
 }
 
@@ -487,8 +2140,9 @@ void NyarkoaPayload::ejectBalloon() {
  * longer alerts.
  */
 void NyarkoaPayload::alert(unsigned long duration) {
-  String action = "AT_ALERT:" + String(duration);
-  debug("\nCMD: " + action);
+  char action[24];
+  snprintf(action, sizeof(action), "AT_ALERT:%lu", duration);
+  NLOG_DEBUG(F("\nCMD: "), action);
   commAction(action);
 }
 
@@ -500,8 +2154,8 @@ void NyarkoaPayload::alert(unsigned long duration) {
  * scenarios where the payload module needs to be located or identified.
  */
 void NyarkoaPayload::enableBeacon() {
-  String action = "AT_EN_BEC:";
-  debug("\nCMD: " + action);
+  const char *action = "AT_EN_BEC:";
+  NLOG_DEBUG(F("\nCMD: "), action);
   commAction(action);
 }
 
@@ -513,65 +2167,79 @@ void NyarkoaPayload::enableBeacon() {
  * to be tracked or identified and should remain silent.
  */
 void NyarkoaPayload::disableBeacon() {
-  String action = "AT_DIS_BEC:";
-  debug("\nCMD: " + action);
+  const char *action = "AT_DIS_BEC:";
+  NLOG_DEBUG(F("\nCMD: "), action);
   commAction(action);
 }
 
 /**
- * Request the date from the communication module.
+ * Get the date of the communication module's clock.
  *
- * This method sends a request to the communication module to obtain the current
- * date. It then returns the date string received from the communication module,
- * allowing the payload module to synchronize its date information.
+ * This method returns the current date as "YYYY-MM-DD". It is read from the
+ * local copy of the module's clock (see `syncClock`), so no request is sent.
+ * If the clock cannot be synced, the date is requested from the module.
  *
- * @return The date string received from the communication module.
+ * @return The date string, or an empty string if it could not be obtained.
  */
-String NyarkoaPayload::getDate() {
-  String request = "AT_DATE";
-  debug("\nREQ: " + request);
+NyarkoaText NyarkoaPayload::getDate() {
+  uint32_t seconds;
+  if (readClock(seconds)) {
+    formatGPSDate(gpsFromSeconds(seconds), clockText, sizeof(clockText));
+    return NyarkoaText(clockText);
+  }
+  const char *request = "AT_DATE";
+  NLOG_DEBUG(F("\nREQ: "), request);
   return requestAction(request);
 }
 
 /**
- * Request the time from the communication module.
+ * Get the time of the communication module's clock.
  *
- * This method sends a request to the communication module to obtain the current
- * time. It then returns the time string received from the communication module,
- * allowing the payload module to synchronize its time information.
+ * This method returns the current time as "HH:MM:SS". It is read from the
+ * local copy of the module's clock (see `syncClock`), so no request is sent.
+ * If the clock cannot be synced, the time is requested from the module.
  *
- * @return The time string received from the communication module.
+ * @return The time string, or an empty string if it could not be obtained.
  */
-String NyarkoaPayload::getTime() {
-  String request = "AT_TIME";
-  debug("\nREQ: " + request);
+NyarkoaText NyarkoaPayload::getTime() {
+  uint32_t seconds;
+  if (readClock(seconds)) {
+    formatGPSTime(gpsFromSeconds(seconds), clockText, sizeof(clockText));
+    return NyarkoaText(clockText);
+  }
+  const char *request = "AT_TIME";
+  NLOG_DEBUG(F("\nREQ: "), request);
   return requestAction(request);
 }
 
 /**
- * Request the timestamp from the communication module.
+ * Get the timestamp of the communication module's clock.
  *
- * This method sends a request to the communication module to obtain the current
- * timestamp. It then returns the timestamp string received from the
- * communication module, allowing the payload module to obtain synchronized
- * timestamp information.
+ * This method returns the current date and time as "YYYY-MM-DD HH:MM:SS",
+ * read from the local copy of the module's clock (see `syncClock`). If the
+ * clock cannot be synced, the timestamp is requested from the module.
  *
- * @return The timestamp string received from the communication module.
+ * @return The timestamp string, or an empty string if it could not be
+ * obtained.
  */
-String NyarkoaPayload::getTimestamp() {
-  String request = "AT_TSTAMP";
-  debug("\nREQ: " + request);
+NyarkoaText NyarkoaPayload::getTimestamp() {
+  uint32_t seconds;
+  if (readClock(seconds)) {
+    formatGPSTimestamp(gpsFromSeconds(seconds), clockText, sizeof(clockText));
+    return NyarkoaText(clockText);
+  }
+  const char *request = "AT_TSTAMP";
+  NLOG_DEBUG(F("\nREQ: "), request);
   return requestAction(request);
 }
 
 /**
- * Request the time after a specific duration.
+ * Get the time after a specific duration.
  *
- * This method sends a request to the communication module to calculate the time
- * after adding a specified number of seconds, minutes, hours, and days to the
- * current time. The request includes the durations to be added in each unit,
- * and the method returns the updated time string as received from the
- * communication module.
+ * This method adds the specified number of seconds, minutes, hours, and days
+ * to the local copy of the module's clock (see `syncClock`) and returns the
+ * result as "YYYY-MM-DD HH:MM:SS". If the clock cannot be synced, the module
+ * is asked to do the calculation.
  *
  * @param sec The seconds to add.
  * @param mins The minutes to add.
@@ -579,11 +2247,18 @@ String NyarkoaPayload::getTimestamp() {
  * @param days The days to add.
  * @return The updated time string.
  */
-String NyarkoaPayload::getTimeAfter(int sec, int mins, int hours,
-                                        int days) {
-  String request = "AT_F_TIME:" + String(sec) + "," + String(mins) + "," +
-                   String(hours) + "," + String(days);
-  debug("\nREQ: " + request);
+NyarkoaText NyarkoaPayload::getTimeAfter(int sec, int mins, int hours,
+                                         int days) {
+  uint32_t seconds;
+  if (readClock(seconds)) {
+    seconds += sec + 60L * mins + 3600L * hours + 86400L * days;
+    formatGPSTimestamp(gpsFromSeconds(seconds), clockText, sizeof(clockText));
+    return NyarkoaText(clockText);
+  }
+  char request[40];
+  snprintf(request, sizeof(request), "AT_F_TIME:%d,%d,%d,%d", sec, mins, hours,
+           days);
+  NLOG_DEBUG(F("\nREQ: "), request);
   return requestAction(request);
 }
 
@@ -598,16 +2273,35 @@ String NyarkoaPayload::getTimeAfter(int sec, int mins, int hours,
  * data.
  */
 MPUData NyarkoaPayload::getMPUData() {
-  String request = "AT_MPU";
-  debug("\nREQ: " + request);
-  String payload = requestAction(request);
+  MPUData data;
+  getMPUData(data);
+  return data;
+}
+
+/**
+ * Request MPU sensor data and report whether it arrived intact.
+ *
+ * @param data Receives the accelerometer, gyro, and temperature data; fields
+ * that could not be read are zero.
+ * @return true if the request succeeded and every field was read; false if
+ * the request failed or the payload was short or malformed.
+ */
+bool NyarkoaPayload::getMPUData(MPUData &data) {
+  const char *request = "AT_MPU";
+  NLOG_DEBUG(F("\nREQ: "), request);
   float values[7];
-  String val;
-  for (byte i = 0; i < 7; i++) {
-    val = payload.substring(0, payload.indexOf(','));
-    values[i] = val.toFloat();
-    payload = payload.substring(payload.indexOf(',') + 1);
-  }
+  bool isOk = requestValues(request, values, 7);
+  data = toMPUData(values);
+  return isOk;
+}
+
+/**
+ * Build an MPUData struct from its seven readings, in transmission order.
+ *
+ * @param values The accelerometer, gyro and temperature readings.
+ * @return The MPUData struct.
+ */
+MPUData NyarkoaPayload::toMPUData(const float *values) {
   return {.accelX = values[0],
           .accelY = values[1],
           .accelZ = values[2],
@@ -628,16 +2322,35 @@ MPUData NyarkoaPayload::getMPUData() {
  * data.
  */
 MPLData NyarkoaPayload::getMPLData() {
-  String request = "AT_MPL";
-  debug("\nREQ: " + request);
-  String payload = requestAction(request);
+  MPLData data;
+  getMPLData(data);
+  return data;
+}
+
+/**
+ * Request MPL sensor data and report whether it arrived intact.
+ *
+ * @param data Receives the pressure, altitude, and temperature data; fields
+ * that could not be read are zero.
+ * @return true if the request succeeded and every field was read; false if
+ * the request failed or the payload was short or malformed.
+ */
+bool NyarkoaPayload::getMPLData(MPLData &data) {
+  const char *request = "AT_MPL";
+  NLOG_DEBUG(F("\nREQ: "), request);
   float values[3];
-  String val;
-  for (byte i = 0; i < 3; i++) {
-    val = payload.substring(0, payload.indexOf(','));
-    values[i] = val.toFloat();
-    payload = payload.substring(payload.indexOf(',') + 1);
-  }
+  bool isOk = requestValues(request, values, 3);
+  data = toMPLData(values);
+  return isOk;
+}
+
+/**
+ * Build an MPLData struct from its three readings, in transmission order.
+ *
+ * @param values The pressure, altitude and temperature readings.
+ * @return The MPLData struct.
+ */
+MPLData NyarkoaPayload::toMPLData(const float *values) {
   return {
       .pressure = values[0], .altitude = values[1], .temperature = values[2]};
 }
@@ -654,21 +2367,284 @@ MPLData NyarkoaPayload::getMPLData() {
  * time, speed, and distance from home.
  */
 GPSData NyarkoaPayload::getGPSData() {
-  String request = "AT_GPS";
-  debug("\nREQ: " + request);
-  String payload = requestAction(request);
-  const byte SIZE = 7;
-  String values[SIZE];
-  String val;
-  for (byte i = 0; i < SIZE; i++) {
-    values[i] = payload.substring(0, payload.indexOf(','));
-    payload = payload.substring(payload.indexOf(',') + 1);
-  }
-  return {.nSats = values[0],
-          .lat = values[1],
-          .lon = values[2],
-          .date = values[3],
-          .time = values[4],
-          .speed = values[5],
-          .distanceFromHome = values[6]};
+  GPSData data;
+  getGPSData(data);
+  return data;
+}
+
+/**
+ * Request GPS sensor data and report whether it arrived intact.
+ *
+ * @param data Receives the GPS fields; all fields are zero if they could not
+ * be read.
+ * @return true if the request succeeded and every field was read; false if
+ * the request failed or the payload was short or malformed.
+ */
+bool NyarkoaPayload::getGPSData(GPSData &data) {
+  const char *request = "AT_GPS";
+  NLOG_DEBUG(F("\nREQ: "), request);
+  data = GPSData();
+
+  PendingRequest *reply = runRequest(request);
+  if (reply == nullptr) return false;
+  bool isOk = decodeGPSData(replyData(*reply), replyLength(*reply), data);
+  releaseRequest(*reply);
+  if (!isOk) NLOG_WARN(F("Bad payload: "), request);
+  return isOk;
+}
+
+/**
+ * Parse the comma-separated GPS fields of a payload.
+ *
+ * The fields are converted straight to the packed GPSData record: coordinates
+ * to fixed point, date and time into the dateTime word. Speed and distance
+ * beyond the range of their fields are clamped.
+ *
+ * @param csv The tokenizer positioned at the satellite count, followed by
+ * latitude, longitude, date, time, speed and distance from home.
+ * @param gps Receives the fields.
+ * @return true if all seven fields were present and in range; otherwise,
+ * false.
+ */
+bool NyarkoaPayload::parseGPSData(CsvTokenizer &csv, GPSData &gps) {
+  long nSats, lat, lon, speed, distance;
+  char date[GPS_DATE_TEXT_SIZE];
+  char time[GPS_TIME_TEXT_SIZE];
+  if (!csv.nextLong(nSats) || !csv.nextFixed(lat, GPS_COORD_DECIMALS) ||
+      !csv.nextFixed(lon, GPS_COORD_DECIMALS) ||
+      !csv.nextText(date, sizeof(date)) || !csv.nextText(time, sizeof(time)) ||
+      !csv.nextLong(speed) || !csv.nextLong(distance))
+    return false;
+
+  uint32_t dateTime = 0;
+  if (!parseGPSDate(date, dateTime) || !parseGPSTime(time, dateTime))
+    return false;
+  if (nSats < 0 || nSats > 0xFF || speed < 0 || distance < 0) return false;
+  if (lat < -90 * GPS_COORD_SCALE || lat > 90 * GPS_COORD_SCALE) return false;
+  if (lon < -180 * GPS_COORD_SCALE || lon > 180 * GPS_COORD_SCALE)
+    return false;
+
+  gps.lat = lat;
+  gps.lon = lon;
+  gps.dateTime = dateTime;
+  gps.speed = speed > 0xFFFF ? 0xFFFF : speed;
+  gps.distanceFromHome = distance > 0xFFFF ? 0xFFFF : distance;
+  gps.nSats = nSats;
+  return true;
+}
+
+/**
+ * Request a snapshot of all sensor data.
+ *
+ * This method sends a single "AT_ALL" request to the communication module,
+ * which samples the MPU, MPL and GPS together and returns all of them in one
+ * response. Compared with calling `getMPUData`, `getMPLData` and `getGPSData`
+ * in turn, this costs one round trip instead of three and the readings belong
+ * to the same instant.
+ *
+ * @return A Snapshot struct holding MPUData, MPLData and GPSData. Readings
+ * are zero if the request failed.
+ */
+Snapshot NyarkoaPayload::getSnapshot() {
+  Snapshot snapshot;
+  getSnapshot(snapshot);
+  return snapshot;
+}
+
+/**
+ * Request a snapshot of all sensor data and report whether it arrived intact.
+ *
+ * @param snapshot Receives the MPU, MPL and GPS data; fields that could not
+ * be read are zero.
+ * @return true if the request succeeded and every field was read; false if
+ * the request failed or the payload was short or malformed.
+ */
+bool NyarkoaPayload::getSnapshot(Snapshot &snapshot) {
+  const char *request = "AT_ALL";
+  NLOG_DEBUG(F("\nREQ: "), request);
+
+  const byte COUNT = 10;  // 7 MPU readings followed by 3 MPL readings
+  float values[COUNT] = {0};
+  snapshot.gps = GPSData();
+  bool isOk = false;
+
+  PendingRequest *reply = runRequest(request);
+  if (reply != nullptr) {
+    if (!binaryLink) {
+      CsvTokenizer csv(reinterpret_cast<const char *>(replyData(*reply)));
+      isOk = parseValues(csv, values, COUNT) &&
+             parseGPSData(csv, snapshot.gps) && csv.atEnd();
+    } else if (replyLength(*reply) == COUNT * sizeof(float) + GPS_RECORD_SIZE) {
+      // packed floats followed by the packed GPS record
+      memcpy(values, replyData(*reply), COUNT * sizeof(float));
+      readGPSRecord(replyData(*reply) + COUNT * sizeof(float), snapshot.gps);
+      isOk = true;
+    }
+    releaseRequest(*reply);
+    if (!isOk) NLOG_WARN(F("Bad payload: "), request);
+  }
+
+  snapshot.mpu = toMPUData(values);
+  snapshot.mpl = toMPLData(values + 7);
+  return isOk;
+}
+
+#if NYARKOA_STREAM_DEPTH
+/**
+ * Have the communication module push a sensor's readings at a fixed rate.
+ *
+ * @param sensor The sensor: CMD_MPU, CMD_MPL or CMD_GPS.
+ * @param rateHz Readings per second, from about 0.016 (one a minute) to
+ * 1000; 0 stops the readings, as `unsubscribe` does.
+ * @return true if the module confirmed the subscription; otherwise, false.
+ *
+ * This method sends "AT_SUB:<sensor command>,<period in ms>", for example
+ * "AT_SUB:AT_MPU,100" for 10 Hz. From then on the module sends the readings
+ * without being asked, so they cost no request and no round trip. `poll`, and
+ * every blocking call, collects them into a queue of NYARKOA_STREAM_DEPTH
+ * readings per sensor, which `readSample` empties. Pushed readings need the
+ * CRC or binary link protocol; on the legacy text protocol they could not be
+ * told apart from responses, so this method fails.
+ */
+bool NyarkoaPayload::subscribe(CommandId sensor, float rateHz) {
+  byte bit = subscriptionBit(sensor);
+  if (commLink == nullptr || bit == 0) return false;
+  if (!binaryLink && !crcLink) {
+    NLOG_WARN(F("Subscriptions need a CRC or binary link"));
+    return false;
+  }
+
+  unsigned long period = 0;
+  if (rateHz > 0) {
+    float periodMs = 1000 / rateHz;
+    period = periodMs >= 0xFFFF ? 0xFFFF : periodMs < 1 ? 1 : lround(periodMs);
+  }
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT_SUB:%s,%lu",
+           sensor == CMD_MPU ? "AT_MPU" : sensor == CMD_MPL ? "AT_MPL"
+                                                             : "AT_GPS",
+           period);
+
+  // Readings may start before the confirmation arrives, so the link must
+  // no longer be cleared from now on.
+  byte previous = subscriptions;
+  if (period) subscriptions |= bit;
+  if (!executeCmd(cmd).isOk) {
+    subscriptions = previous;
+    return false;
+  }
+  if (!period) subscriptions &= ~bit;
+  return true;
+}
+
+/**
+ * Stop the readings of a subscribed sensor.
+ *
+ * @param sensor The sensor: CMD_MPU, CMD_MPL or CMD_GPS.
+ * @return true if the module confirmed; otherwise, false. Readings already
+ * queued can still be read.
+ */
+bool NyarkoaPayload::unsubscribe(CommandId sensor) {
+  return subscribe(sensor, 0);
+}
+
+/**
+ * Get the number of pushed readings waiting to be read.
+ *
+ * @param sensor The sensor: CMD_MPU, CMD_MPL or CMD_GPS.
+ * @return The number of readings `readSample` can take, or 0 for any other
+ * command.
+ */
+byte NyarkoaPayload::samplesAvailable(CommandId sensor) {
+  switch (sensor) {
+    case CMD_MPU:
+      return mpuStream.available();
+    case CMD_MPL:
+      return mplStream.available();
+    case CMD_GPS:
+      return gpsStream.available();
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Get the number of pushed readings overwritten before they were read.
+ *
+ * @param sensor The sensor: CMD_MPU, CMD_MPL or CMD_GPS.
+ * @return The number of readings lost since the last connection, up to
+ * 65535. A growing number means the sketch reads less often than the
+ * sensor pushes; read more often, lower the rate or raise
+ * NYARKOA_STREAM_DEPTH.
+ */
+uint16_t NyarkoaPayload::getSamplesLost(CommandId sensor) {
+  switch (sensor) {
+    case CMD_MPU:
+      return mpuStream.getOverruns();
+    case CMD_MPL:
+      return mplStream.getOverruns();
+    case CMD_GPS:
+      return gpsStream.getOverruns();
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Take the oldest pushed MPU reading.
+ *
+ * @param data Receives the reading.
+ * @param receivedAt Receives the millis() at which it arrived, unless
+ * nullptr.
+ * @return true if a reading was taken; false if none is waiting.
+ *
+ * Readings are collected by `poll`, which must be called regularly.
+ */
+bool NyarkoaPayload::readSample(MPUData &data, unsigned long *receivedAt) {
+  return mpuStream.pop(data, receivedAt);
+}
+
+/**
+ * Take the oldest pushed MPL reading.
+ *
+ * @param data Receives the reading.
+ * @param receivedAt Receives the millis() at which it arrived, unless
+ * nullptr.
+ * @return true if a reading was taken; false if none is waiting.
+ */
+bool NyarkoaPayload::readSample(MPLData &data, unsigned long *receivedAt) {
+  return mplStream.pop(data, receivedAt);
+}
+
+/**
+ * Take the oldest pushed GPS reading.
+ *
+ * @param data Receives the reading.
+ * @param receivedAt Receives the millis() at which it arrived, unless
+ * nullptr.
+ * @return true if a reading was taken; false if none is waiting.
+ */
+bool NyarkoaPayload::readSample(GPSData &data, unsigned long *receivedAt) {
+  return gpsStream.pop(data, receivedAt);
+}
+
+/**
+ * Get the bit that marks a sensor as subscribed.
+ *
+ * @param sensor The sensor's command.
+ * @return SUB_MPU, SUB_MPL or SUB_GPS, or 0 if the command is not a sensor
+ * that can push readings.
+ */
+byte NyarkoaPayload::subscriptionBit(CommandId sensor) {
+  switch (sensor) {
+    case CMD_MPU:
+      return SUB_MPU;
+    case CMD_MPL:
+      return SUB_MPL;
+    case CMD_GPS:
+      return SUB_GPS;
+    default:
+      return 0;
+  }
 }
+#endif
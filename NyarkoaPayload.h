@@ -1,108 +1,253 @@
 #ifndef NYARKOA_PAYLOAD_H
 #define NYARKOA_PAYLOAD_H
 #include <Arduino.h>
+#include <NyarkoaClock.h>
+#include <NyarkoaCrc.h>
+#include <NyarkoaCsv.h>
+#include <NyarkoaDelta.h>
+#include <NyarkoaFrame.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaLog.h>
+#include <NyarkoaRing.h>
+#include <NyarkoaTrace.h>
+#include <NyarkoaTypes.h>
+#ifndef NYARKOA_NO_SOFTWARE_SERIAL
 #include <SoftwareSerial.h>
+#endif
 
-struct Response {
-  bool isOk;
-  String message;
+enum RequestState : byte {
+  REQ_FREE,
+  REQ_QUEUED,
+  REQ_WAITING,
+  REQ_DONE,
+  REQ_FAILED
 };
 
-struct AnalogPins {
-  byte A0;
-  byte A1;
-  byte A2;
-  byte A3;
+// Whom a request slot is taken for.
+enum RequestOwner : byte {
+  OWNER_SKETCH,   // beginRequest()/beginCommand(), reported to the callback
+  OWNER_LIBRARY,  // blocking calls and the library's own requests
+  OWNER_CLOCK,    // the clock check, which only takes the library's slot
+  OWNER_DOWNLINK  // a batch of ground station records, in a slot of its own
 };
 
-struct I2CPins {
-  byte SDA;
-  byte SCL;
+// A command or request started with beginRequest()/beginCommand() (or by one
+// of the blocking calls). Its text is not copied: every attempt rebuilds it
+// from the command table and args, and its reply is kept in the payload's
+// shared reply buffer.
+struct PendingRequest {
+  byte handle;  // 0 while the slot is free
+  byte state;
+  byte seq;
+  byte cmdId;
+  byte cmdIndex;  // position in the command table, COMMAND_COUNT if unknown
+  byte rttClass;
+  byte attempts;
+  bool isCommand;
+  bool notify;
+  byte replyAt;    // offset of the reply in the reply buffer
+  byte replySize;  // bytes of the reply buffer held, NUL included; 0 if none
+  unsigned long sentAt;
+  unsigned long timeout;     // for the attempt on the link
+  unsigned long maxTimeout;  // the command's own deadline
+  const char *text;  // caller's text of a blocking call whose arguments do
+                     // not fit args, or nullptr
+  char args[NYARKOA_ARGS_SIZE];  // text after the command's name, or all of
+                                 // it for a command not in the table
 };
 
-struct SPIPins {
-  byte CS;
-  byte MOSI;
-  byte MISO;
-  byte SCK;
+// Round-trip time estimate shared by the commands of one RttClass, kept as
+// TCP does (RFC 6298). The averages are scaled so that integer arithmetic
+// keeps their fractions.
+struct RttEstimate {
+  bool isValid;      // false until the first answer has been timed
+  byte backoff;      // retransmission timeout doublings since then
+  uint16_t srtt8;    // smoothed round-trip time x 8, in ms
+  uint16_t rttvar4;  // round-trip time variation x 4, in ms
 };
 
-struct DigitalPins {
-  byte D2;
-  byte D3;
-  byte D6;
-  byte D7;
-  byte D8;
-  byte D9;
-  byte D10;
-  byte D11;
-  byte D12;
-  byte D13;
-};
-
-struct InterruptPins {
-  byte D2;
-  byte D3;
-};
+// Longest text of records a "GS::BATCH::rec;rec" message carries, and
+// longest record sent as "GS::cmd::payload". Frames carry the text after
+// "GS::", so the frame payload bounds both as well.
+const byte DOWNLINK_BATCH_MAX{NYARKOA_CMD_SIZE - 12 < FRAME_MAX_PAYLOAD - 7
+                                  ? NYARKOA_CMD_SIZE - 12
+                                  : FRAME_MAX_PAYLOAD - 7};
+const byte DOWNLINK_RECORD_MAX{NYARKOA_CMD_SIZE - 5 < FRAME_MAX_PAYLOAD
+                                   ? NYARKOA_CMD_SIZE - 5
+                                   : FRAME_MAX_PAYLOAD};
 
-struct PWMPins {
-  byte D3;
-  byte D6;
-  byte D7;
-  byte D9;
-  byte D10;
-  byte D11;
+// How queued ground station records are grouped into messages.
+enum BatchMode : byte {
+  BATCH_ON,     // as many records as fit in one "GS::BATCH::" message
+  BATCH_PROBE,  // a batch failed: one record, to tell a refusal from the link
+  BATCH_OFF     // the module or ground station refused batches: one record
 };
 
-struct CommUART {
-  byte Rx;
-  byte Tx;
+// The communication module's answer to an "AT_LINK:<mode>" offer.
+enum LinkAnswer : byte {
+  LINK_ACCEPTED,
+  LINK_REFUSED,    // answered, with another mode or "ERR"
+  LINK_UNANSWERED  // no answer in time, or one that failed its check
 };
 
-struct MPUData {
-  float accelX;
-  float accelY;
-  float accelZ;
-  float gyroX;
-  float gyroY;
-  float gyroZ;
-  float temp;
+// How hard a command is retried, set with NyarkoaPayload::setRetryPolicy.
+struct RetryPolicy {
+  byte attempts;              // attempts per command, the first included
+  unsigned long minTimeout;   // shortest retransmission timeout, in ms
+  byte maxBackoff;            // doublings of the timeout after losses
 };
 
-struct MPLData {
-  float pressure;
-  float altitude;
-  float temperature;
-};
-
-struct GPSData {
-  String nSats;
-  String lat;
-  String lon;
-  String date;
-  String time;
-  String speed;
-  String distanceFromHome;
-};
+typedef void (*RequestCallback)(byte handle, const Response &response);
 
 class NyarkoaPayload {
  private:
-  SoftwareSerial *commSerial = nullptr;
-
   // Generic variable declarations
-  bool DEBUG{true};
+  NyarkoaLogger logger;
+  bool binaryLinkEnabled{false};  // offer the binary link when connecting
+  bool binaryLink{false};         // the module accepted it
+  bool crcLink{false};
+  Stream *crcRefusedBy{nullptr};  // transport whose module refused AT_LINK:CRC
+  byte sequence{0};
+  Frame txFrame;
+  FrameParser rxParser;
+  char rxLine[NYARKOA_RX_LINE_SIZE];
+  byte rxLength{0};
+  unsigned long lastRxTime{0};
+  // The sketch's NYARKOA_MAX_PENDING slots, then one kept for the library
+  // and one for ground station batches
+  static const byte LIBRARY_SLOT{NYARKOA_MAX_PENDING};
+#if NYARKOA_DOWNLINK_SIZE
+  static const byte DOWNLINK_SLOT{NYARKOA_MAX_PENDING + 1};
+  static const byte REQUEST_SLOTS{NYARKOA_MAX_PENDING + 2};
+#else
+  static const byte REQUEST_SLOTS{NYARKOA_MAX_PENDING + 1};
+#endif
+  PendingRequest requests[REQUEST_SLOTS];
+  char cmdText[NYARKOA_CMD_SIZE];  // text of the request being sent or checked
+  byte replies[NYARKOA_RESULT_SIZE + 1];  // replies of finished requests
+  byte nextHandle{0};
+  RequestCallback requestCallback{nullptr};
+  RttEstimate rttEstimates[RTT_CLASS_COUNT]{};
+  NyarkoaClock moduleClock;
+  byte clockRequest{0};  // handle of the AT_TSTAMP request syncing the clock
+  bool clockSampled{false};
+  char clockText[GPS_TIMESTAMP_TEXT_SIZE];
+  byte subscriptions{0};  // SUB_* bits of the sensors pushing readings
+#if NYARKOA_STREAM_DEPTH
+  SampleRing<MPUData, NYARKOA_STREAM_DEPTH> mpuStream;
+  SampleRing<MPLData, NYARKOA_STREAM_DEPTH> mplStream;
+  SampleRing<GPSData, NYARKOA_STREAM_DEPTH> gpsStream;
+#endif
+#if NYARKOA_DOWNLINK_SIZE
+  char downlink[NYARKOA_DOWNLINK_SIZE];  // queued records, ';'-separated
+  uint16_t downlinkLength{0};
+  unsigned long downlinkSince{0};  // millis() the oldest record was queued
+  byte downlinkHandle{0};          // request carrying a batch
+  uint16_t downlinkSent{0};        // bytes of `downlink` in that batch
+  BatchMode batchMode{BATCH_ON};
+  Stream *batchTransport{nullptr};  // transport batchMode was learnt on
+  DownlinkStats downlinkStats{};
+  NyarkoaDeltaEncoder telemetryEncoder;
+#endif
+#if NYARKOA_LINK_STATS
+  LinkStats linkStats;
+#if NYARKOA_LINK_STATS >= 2
+  CommandStats commandStats[COMMAND_COUNT];
+#endif
+#endif
+  RetryPolicy retryPolicy{defaultRetryPolicy()};
   const unsigned long SERIAL_TIMEOUT{10000};
   const unsigned long CONNECT_SERIAL_TIMEOUT{30000};
+  const unsigned long RX_IDLE_TIMEOUT{20};
+  const unsigned long LINK_TIMEOUT{1000};
+#if NYARKOA_STREAM_DEPTH
+  const byte SUB_MPU{0x01};
+  const byte SUB_MPL{0x02};
+  const byte SUB_GPS{0x04};
+#endif
 
   const int UNASSIGNED_PIN{-1};
   CommUART commUARTPins = {.Rx = 5, .Tx = 4};
+#ifndef NYARKOA_NO_SOFTWARE_SERIAL
+  SoftwareSerial commSerial{commUARTPins.Tx, commUARTPins.Rx};
+#endif
+  Stream *commLink{nullptr};
+  NyarkoaTraceRecorder *trace{nullptr};
 
   void clearSerial();
-  Response executeCmd(String cmd);
-  Response request(String req);
-  void transmit(String data);
-  String receive();
-  Response connect();
+  Response executeCmd(const char *cmd);
+  Response request(const char *req);
+  void transmit(const char *prefix, const char *data);
+  bool receive(unsigned long timeout);
+  bool readLine();
+  unsigned long responseTimeout(const char *cmd);
+  Response connect(Stream &transport);
+  LinkAnswer negotiateLink(const char *mode);
+  bool checkHash(const char *data, const char *hash, size_t hashLength);
+  byte queueRequest(const char *cmd, bool isCommand, RequestOwner owner);
+  PendingRequest *freeSlot(RequestOwner owner);
+  PendingRequest *findRequest(byte handle);
+  PendingRequest *awaitRequest(byte handle);
+  PendingRequest *oldestQueued();
+  void sendRequest(PendingRequest &req);
+  void retryRequest(PendingRequest &req);
+  unsigned long retryTimeout(PendingRequest &req);
+  void sampleRtt(PendingRequest &req);
+  void backOff(PendingRequest &req);
+  PendingRequest *soleWaiting();
+  bool isLinkBusy();
+  void receiveLine(PendingRequest &req);
+  void receiveCheckedLines();
+  void acceptCheckedLine(PendingRequest *req);
+  void receiveFrames();
+  void acceptPush(byte cmdId, const byte *payload, byte length);
+#if NYARKOA_STREAM_DEPTH
+  byte subscriptionBit(CommandId sensor);
+#endif
+  void acceptReply(PendingRequest &req, bool isValid, const byte *payload,
+                   byte length);
+  void completeRequest(PendingRequest &req, bool isOk);
+  void releaseRequest(PendingRequest &req);
+  const char *formatRequest(const PendingRequest &req);
+  bool keepReply(PendingRequest &req, const byte *payload, byte length);
+  byte packReplies();
+  const byte *replyData(const PendingRequest &req) {
+    return replies + req.replyAt;
+  }
+  byte replyLength(const PendingRequest &req) {
+    return req.replySize ? req.replySize - 1 : 0;
+  }
+  Response requestResult(PendingRequest &req);
+  void recordRtt(PendingRequest &req);
+  void countSent(size_t bytes) {
+#if NYARKOA_LINK_STATS
+    linkStats.bytesSent += bytes;
+#endif
+  }
+  void countReceived(size_t bytes) {
+#if NYARKOA_LINK_STATS
+    linkStats.bytesReceived += bytes;
+#endif
+  }
+  PendingRequest *runRequest(const char *req);
+  void serviceClock();
+#if NYARKOA_DOWNLINK_SIZE
+  void serviceDownlink();
+  bool startBatch();
+  void finishBatch(PendingRequest &req);
+  bool sendBatch();
+  void dropDownlinkRecord();
+#endif
+  void finishClockRequest(PendingRequest &req);
+  bool readClock(uint32_t &seconds);
+  bool requestValues(const char *req, float *values, byte count);
+  bool decodeValues(const byte *payload, byte length, float *values,
+                    byte count);
+  bool decodeGPSData(const byte *payload, byte length, GPSData &gps);
+  bool parseValues(CsvTokenizer &csv, float *values, byte count);
+  MPUData toMPUData(const float *values);
+  MPLData toMPLData(const float *values);
+  bool parseGPSData(CsvTokenizer &csv, GPSData &gps);
   // unsigned int readADC(byte pin);
 
  public:
@@ -126,13 +271,6 @@ class NyarkoaPayload {
                              .D12 = 12,
                              .D13 = 13};
   PWMPins pwmPin = {.D3 = 3, .D6 = 6, .D7 = 7, .D9 = 9, .D10 = 10, .D11 = 11};
-  GPSData gpsData = {.nSats = "",
-                     .lat = "",
-                     .lon = "",
-                     .date = "",
-                     .time = "",
-                     .speed = "",
-                     .distanceFromHome = ""};
 
   ~NyarkoaPayload();
   bool pinInfo(byte pin);
@@ -141,12 +279,26 @@ class NyarkoaPayload {
   static NyarkoaPayload getInstance();
 
   // utility functions
+  void debug(const char *text, bool newline = true);
+  void debug(const __FlashStringHelper *text, bool newline = true);
+  void debug(const __FlashStringHelper *label, const char *text);
+  bool contains(const char *str, const char *substr);
+#ifndef NYARKOA_NO_HEAP
   void debug(String text, bool newline = true);
   bool contains(String str, String substr);
   String simpleHash(String data);
   bool compareHash(String data, String hash);
+#endif
   void activateDevMode();
   void activateProdMode();
+  void setLogLevel(byte level);
+  void enableBinaryLink();
+  void disableBinaryLink();
+  bool isBinaryLink();
+  bool isCrcLink();
+  void setRetryPolicy(const RetryPolicy &policy);
+  const RetryPolicy &getRetryPolicy() const { return retryPolicy; }
+  static RetryPolicy defaultRetryPolicy();
   void (*resetPayload)(void) = 0;
 
   // Wrapper functions
@@ -155,24 +307,86 @@ class NyarkoaPayload {
   void setAnalogValue(byte pin, int value);
 
   // Transmission functions
+#ifndef NYARKOA_NO_SOFTWARE_SERIAL
   Response connectCommModule();
+#endif
+  Response connectCommModule(Stream &transport);
+  void setTrace(NyarkoaTraceRecorder *recorder);
+
+  // Asynchronous requests
+  byte beginRequest(const char *req);
+  byte beginCommand(const char *cmd);
+#ifndef NYARKOA_NO_HEAP
+  byte beginRequest(String req) { return beginRequest(req.c_str()); }
+  byte beginCommand(String cmd) { return beginCommand(cmd.c_str()); }
+#endif
+  void poll();
+  bool isReady(byte handle);
+  Response getResult(byte handle);
+  void setRequestCallback(RequestCallback callback);
+
+  // Link statistics
+#if NYARKOA_LINK_STATS
+  const LinkStats &getLinkStats();
+  CommandStats getCommandStats(CommandId id);
+  void resetLinkStats();
+  bool downlinkLinkStats();
+#endif
+
+  // Ground station downlink
+#if NYARKOA_DOWNLINK_SIZE
+  bool queueDownlink(const char *cmd, const char *payload);
+  bool flushDownlink();
+  uint16_t getDownlinkLength() const { return downlinkLength; }
+  const DownlinkStats &getDownlinkStats() const { return downlinkStats; }
+  bool isBatchingRefused() const { return batchMode == BATCH_OFF; }
+  bool queueTelemetry(const MPUData &data);
+  bool queueTelemetry(const MPLData &data);
+  bool queueTelemetry(const GPSData &data);
+  bool queueTelemetry(const Snapshot &snapshot);
+#endif
 
   // Action Methods
-  void commAction(String cmd);
-  String requestAction(String cmd);
-  bool contactGroundStation(String cmd, String payload);
+  void commAction(const char *cmd);
+  NyarkoaText requestAction(const char *cmd);
+  bool contactGroundStation(const char *cmd, const char *payload);
+#ifndef NYARKOA_NO_HEAP
+  void commAction(String cmd) { commAction(cmd.c_str()); }
+  String requestAction(String cmd) { return requestAction(cmd.c_str()); }
+  bool contactGroundStation(String cmd, String payload) {
+    return contactGroundStation(cmd.c_str(), payload.c_str());
+  }
+#endif
 
   void ejectBalloon();
   void alert(unsigned long duration = 100);
+  bool syncClock();
   void enableBeacon();
   void disableBeacon();
-  String getDate();
-  String getTime();
-  String getTimestamp();
-  String getTimeAfter(int sec = 30, int mins = 0, int hours = 0, int days = 0);
+  NyarkoaText getDate();
+  NyarkoaText getTime();
+  NyarkoaText getTimestamp();
+  NyarkoaText getTimeAfter(int sec = 30, int mins = 0, int hours = 0,
+                           int days = 0);
   MPUData getMPUData();
+  bool getMPUData(MPUData &data);
   MPLData getMPLData();
+  bool getMPLData(MPLData &data);
   GPSData getGPSData();
+  bool getGPSData(GPSData &data);
+  Snapshot getSnapshot();
+  bool getSnapshot(Snapshot &snapshot);
+
+#if NYARKOA_STREAM_DEPTH
+  // Pushed sensor readings
+  bool subscribe(CommandId sensor, float rateHz);
+  bool unsubscribe(CommandId sensor);
+  byte samplesAvailable(CommandId sensor);
+  uint16_t getSamplesLost(CommandId sensor);
+  bool readSample(MPUData &data, unsigned long *receivedAt = nullptr);
+  bool readSample(MPLData &data, unsigned long *receivedAt = nullptr);
+  bool readSample(GPSData &data, unsigned long *receivedAt = nullptr);
+#endif
 };
 
 #endif
\ No newline at end of file
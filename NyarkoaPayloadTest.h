@@ -1,180 +1,78 @@
 #ifndef NYARKOA_PAYLOAD_TEST_H
 #define NYARKOA_PAYLOAD_TEST_H
 #include <Arduino.h>
-#include <SoftwareSerial.h>
-
-struct Response {
-  bool isOk;
-  String message;
-};
-
-struct AnalogPins {
-  byte A0;
-  byte A1;
-  byte A2;
-  byte A3;
-};
-
-struct I2CPins {
-  byte SDA;
-  byte SCL;
-};
-
-struct SPIPins {
-  byte CS;
-  byte MOSI;
-  byte MISO;
-  byte SCK;
-};
-
-struct DigitalPins {
-  byte D2;
-  byte D3;
-  byte D6;
-  byte D7;
-  byte D8;
-  byte D9;
-  byte D10;
-  byte D11;
-  byte D12;
-  byte D13;
-};
-
-struct InterruptPins {
-  byte D2;
-  byte D3;
-};
-
-struct PWMPins {
-  byte D3;
-  byte D6;
-  byte D7;
-  byte D9;
-  byte D10;
-  byte D11;
-};
-
-struct CommUART {
-  byte Rx;
-  byte Tx;
-};
-
-struct MPUData {
-  float accelX;
-  float accelY;
-  float accelZ;
-  float gyroX;
-  float gyroY;
-  float gyroZ;
-  float temp;
-};
-
-struct MPLData {
-  float pressure;
-  float altitude;
-  float temperature;
-};
-
-struct GPSData {
-  String nSats;
-  String lat;
-  String lon;
-  String date;
-  String time;
-  String speed;
-  String distanceFromHome;
-};
-
-class NyarkoaPayloadTest {
+#include <NyarkoaPayload.h>
+#ifdef NYARKOA_HOST
+#include <NyarkoaCommSim.h>
+#include <NyarkoaFlight.h>
+#else
+#include <NyarkoaSampleModule.h>
+#endif
+
+/*
+ * NyarkoaPayload connected to an emulated communication module.
+ *
+ * Every call runs through the same protocol engine as on flight hardware:
+ * requests are framed, checked, timed and retried exactly as by
+ * NyarkoaPayload, only the module at the other end is emulated. The
+ * `generateError` arguments kept from the earlier test class damage every
+ * reply for the duration of the one call.
+ *
+ * On a board the module is a NyarkoaSampleModule, which answers at once on
+ * the legacy protocol with noisy readings from the launch pad. The host
+ * build (NYARKOA_HOST, set by CMakeLists.txt) uses a NyarkoaCommSim instead,
+ * whose latency, jitter and share of lost or damaged replies are set
+ * through getCommModule(), and whose sensors follow a balloon flight, set
+ * and replayed through getFlight(); ejectBalloon() releases the CanSat from
+ * the balloon.
+ */
+class NyarkoaPayloadTest : public NyarkoaPayload {
  private:
-  SoftwareSerial *commSerial = nullptr;
+#ifdef NYARKOA_HOST
+  NyarkoaCommSim commModule;
+  NyarkoaFlight flight;
+  CommSimConfig savedConfig;
+#else
+  NyarkoaSampleModule commModule;
+#endif
 
-  // Generic variable declarations
-  bool DEBUG{true};
-  const unsigned long SERIAL_TIMEOUT{10000};
-  const unsigned long CONNECT_SERIAL_TIMEOUT{30000};
-
-  const int UNASSIGNED_PIN{-1};
-  CommUART commUARTPins = {.Rx = 5, .Tx = 4};
-
-  void clearSerial();
-
-  // Transmission functions
-  void transmit(String data);
-  Response request(String req);
-  Response executeCmd(String cmd);
-  String receive();
-  Response connect();
-  unsigned int readADC(byte pin);
+  void injectFaults(bool generateError);
+  void clearFaults(bool generateError);
 
  public:
-  const unsigned long UART_BAUD_RATE{115200};
   NyarkoaPayloadTest();
-  // Pin declarations
-  const byte LED{13};
-  const byte BTN{12};
-
-  AnalogPins analogPins = {.A0 = A0, .A1 = A1, .A2 = A2, .A3 = A3};
-  I2CPins i2cPins = {.SDA = A4, .SCL = A5};
-  SPIPins spiPins = {.CS = 10, .MOSI = 11, .MISO = 12, .SCK = 13};
-  DigitalPins digitalPins = {.D2 = 2,
-                             .D3 = 3,
-                             .D6 = 6,
-                             .D7 = 7,
-                             .D8 = 8,
-                             .D9 = 9,
-                             .D10 = 10,
-                             .D11 = 11,
-                             .D12 = 12,
-                             .D13 = 13};
-  PWMPins pwmPin = {.D3 = 3, .D6 = 6, .D7 = 7, .D9 = 9, .D10 = 10, .D11 = 11};
-  GPSData gpsData = {.nSats = "",
-                     .lat = "",
-                     .lon = "",
-                     .date = "",
-                     .time = "",
-                     .speed = "",
-                     .distanceFromHome = ""};
-
   ~NyarkoaPayloadTest();
-  bool pinInfo(byte pin);
   // Delete copy constructor
   NyarkoaPayloadTest(const NyarkoaPayloadTest &obj) = delete;
   static NyarkoaPayloadTest *getInstance();
 
+#ifdef NYARKOA_HOST
+  NyarkoaCommSim &getCommModule() { return commModule; }
+  NyarkoaFlight &getFlight() { return flight; }
+#endif
+  Response connectCommModule();
   Response connectToCommModule(bool generateError = false);
 
-  // utility functions
-  void debug(String text, bool newline = true);
-  bool contains(String str, String substr);
-  String simpleHash(String data);
-  bool compareHash(String data, String hash);
-  void activateDevMode();
-  void activateProdMode();
-  void (*resetPayload)(void) = 0;
-
-  // Wrapper functions
-  void setPinMode(byte pin, bool mode);
-  void digitalWrite(byte pin, bool mode);
-  void setAnalogValue(byte pin, int value);
-
   // Action Methods
   void commAction(String cmd, bool generateError = false);
   String requestAction(String cmd, bool generateError = false);
   bool contactGroundStation(String cmd, String payload,
                             bool generateError = false);
-  void ejectBalloon();
-  void alert(unsigned long duration = 100);
-  void enableBeacon();
-  void disableBeacon();
   String getDate(bool generateError = false);
   String getTime(bool generateError = false);
   String getTimestamp(bool generateError = false);
   String getTimeAfter(int sec = 30, int mins = 0, int hours = 0, int days = 0,
                       bool generateError = false);
   MPUData getMPUData(bool generateError = false);
+  bool getMPUData(MPUData &data) { return NyarkoaPayload::getMPUData(data); }
   MPLData getMPLData(bool generateError = false);
+  bool getMPLData(MPLData &data) { return NyarkoaPayload::getMPLData(data); }
   GPSData getGPSData(bool generateError = false);
+  bool getGPSData(GPSData &data) { return NyarkoaPayload::getGPSData(data); }
+  Snapshot getSnapshot(bool generateError = false);
+  bool getSnapshot(Snapshot &snapshot) {
+    return NyarkoaPayload::getSnapshot(snapshot);
+  }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,70 @@
+#ifndef NYARKOA_RING_H
+#define NYARKOA_RING_H
+#include <Arduino.h>
+
+/**
+ * Fixed-size queue of timestamped readings.
+ *
+ * Readings pushed by the communication module are kept here until the sketch
+ * reads them. When the queue is full the oldest reading is overwritten, so
+ * a sketch that falls behind always finds the latest readings; the number of
+ * readings lost that way is counted.
+ */
+template <typename T, byte N>
+class SampleRing {
+ public:
+  byte available() const { return count; }
+  uint16_t getOverruns() const { return overruns; }
+
+  /**
+   * Forget all readings and the overrun count.
+   */
+  void clear() {
+    head = 0;
+    count = 0;
+    overruns = 0;
+  }
+
+  /**
+   * Add a reading, overwriting the oldest one if the queue is full.
+   *
+   * @param value The reading.
+   * @param at The millis() at which it arrived.
+   */
+  void push(const T &value, unsigned long at) {
+    byte slot = (head + count) % N;
+    if (count == N) {
+      head = (head + 1) % N;
+      if (overruns < 0xFFFF) overruns++;
+    } else {
+      count++;
+    }
+    items[slot] = value;
+    stamps[slot] = at;
+  }
+
+  /**
+   * Take the oldest reading.
+   *
+   * @param value Receives the reading.
+   * @param at Receives the millis() at which it arrived, unless nullptr.
+   * @return true if a reading was taken; false if the queue is empty.
+   */
+  bool pop(T &value, unsigned long *at) {
+    if (count == 0) return false;
+    value = items[head];
+    if (at != nullptr) *at = stamps[head];
+    head = (head + 1) % N;
+    count--;
+    return true;
+  }
+
+ private:
+  T items[N];
+  unsigned long stamps[N];
+  byte head{0};
+  byte count{0};
+  uint16_t overruns{0};
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <NyarkoaFrame.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaSampleModule.h>
+#include <stdio.h>
+
+// Readings of a payload resting on a launch pad in Accra, 500 m above sea
+// level, in hundredths: accelX, accelY, accelZ, gyroX, gyroY, gyroZ, temp,
+// then pressure, altitude and temperature.
+static const int32_t RESTING[] PROGMEM = {0,    0,     981,   0,   0, 0,
+                                          2500, 95461, 50000, 2500};
+const int32_t SAMPLE_LAT{56037160};
+const int32_t SAMPLE_LON{-1869640};
+
+// Length after appending `written` bytes, kept within the buffer.
+static size_t advance(size_t length, size_t written, size_t size) {
+  length += written;
+  return length < size ? length : size - 1;
+}
+
+// Append resting readings with up to 0.05 of noise, e.g. "0.01,-0.03,9.80".
+static size_t formatResting(byte first, byte count, char *text, size_t size) {
+  size_t length = 0;
+  for (byte i = first; i < first + count; i++) {
+    long value = int32_t(pgm_read_dword(&RESTING[i])) + random(-5, 6);
+    unsigned long magnitude = value < 0 ? -value : value;
+    length = advance(length,
+                     snprintf(text + length, size - length, "%s%s%lu.%02lu",
+                              i > first ? "," : "", value < 0 ? "-" : "",
+                              magnitude / 100, magnitude % 100),
+                     size);
+  }
+  return length;
+}
+
+// Append a GPS fix at the launch site with a little noise.
+static size_t formatGPS(uint32_t now, char *text, size_t size) {
+  char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+  char date[GPS_DATE_TEXT_SIZE], time[GPS_TIME_TEXT_SIZE];
+  formatGPSCoordinate(SAMPLE_LAT + random(-20, 21), lat, sizeof(lat));
+  formatGPSCoordinate(SAMPLE_LON + random(-20, 21), lon, sizeof(lon));
+  formatGPSDate(now, date, sizeof(date));
+  formatGPSTime(now, time, sizeof(time));
+  return snprintf(text, size, "%u,%s,%s,%s,%s,0,%u", unsigned(random(7, 11)),
+                  lat, lon, date, time, unsigned(random(0, 3)));
+}
+
+/**
+ * Get the number of reply bytes waiting.
+ *
+ * @return The number of bytes that can be read now.
+ */
+int NyarkoaSampleModule::available() { return replying ? length - readAt : 0; }
+
+/**
+ * Read one reply byte.
+ *
+ * @return The byte, or -1 if no reply is waiting.
+ */
+int NyarkoaSampleModule::read() {
+  if (available() == 0) return -1;
+  return byte(text[readAt++]);
+}
+
+/**
+ * Look at the next reply byte without consuming it.
+ *
+ * @return The byte, or -1 if no reply is waiting.
+ */
+int NyarkoaSampleModule::peek() {
+  if (available() == 0) return -1;
+  return byte(text[readAt]);
+}
+
+/**
+ * Receive one byte from the payload.
+ *
+ * @param data The byte.
+ * @return 1, as the byte is always accepted.
+ *
+ * A new request drops what is left of the previous reply. A line too long
+ * for the buffer is not answered.
+ */
+size_t NyarkoaSampleModule::write(uint8_t data) {
+  if (replying) {
+    replying = false;
+    length = 0;
+  }
+  if (data == '\n') {
+    while (length > 0 && text[length - 1] == '\r') length--;
+    text[length] = '\0';
+    if (!overflow && length > 0) answer();
+    if (!replying) length = 0;
+    overflow = false;
+  } else if (length < TEXT_SIZE - 1) {
+    text[length++] = data;
+  } else {
+    overflow = true;
+  }
+  return 1;
+}
+
+/**
+ * Replace the request in the buffer with its reply.
+ *
+ * With `setCorrupt(true)` one bit of every reply is flipped, so the payload
+ * rejects it.
+ */
+void NyarkoaSampleModule::answer() {
+  char hash[24];
+  size_t size = TEXT_SIZE - 2;  // room for "\r\n"
+  bool isRequest = strncmp(text, "REQ:", 4) == 0;
+  const char *cmd = isRequest ? text + 4 : text;
+  byte id = commandId(commandIndex(cmd));
+
+  if (strcmp(text, "AT?") == 0) {
+    strcpy(text, "OK");
+  } else if (id == CMD_NONE || id == CMD_SUB) {
+    strcpy(text, "ERR");
+  } else {
+    size_t cmdLength = strlen(cmd);
+    unsigned long hashSum = 0;
+    for (size_t i = 0; i < cmdLength; i++) hashSum += int(cmd[i]);
+    snprintf(hash, sizeof(hash), "%u%d%lu%d%u", unsigned(cmdLength),
+             int(cmd[0]), hashSum, int(cmd[cmdLength - 1]),
+             unsigned(byte(hashSum % 256)));
+
+    long offset = 0;
+    const char *args = strchr(cmd, ':');
+    if (id == CMD_F_TIME && args != nullptr) {
+      const long UNITS[] = {1, 60, 3600, 86400L};
+      char *end = const_cast<char *>(args);
+      for (byte i = 0; i < 4 && (*end == ':' || *end == ','); i++) {
+        offset += strtol(end + 1, &end, 10) * UNITS[i];
+      }
+    }
+
+    size_t replyLength = strlen(hash);
+    memcpy(text, hash, replyLength + 1);
+    if (isRequest) {
+      text[replyLength++] = ':';
+      respond(id, offset, text + replyLength, size - replyLength);
+    }
+  }
+  if (corrupt) text[0] ^= 0x01;
+  length = strlen(text);
+  text[length++] = '\r';
+  text[length++] = '\n';
+  readAt = 0;
+  replying = true;
+}
+
+/**
+ * Build the text payload of a request's reply.
+ *
+ * @param cmd The request's command ID.
+ * @param offset Seconds to add to the clock, for AT_F_TIME.
+ * @param payload Receives the payload text.
+ * @param size The size of the payload buffer.
+ */
+void NyarkoaSampleModule::respond(byte cmd, long offset, char *payload,
+                                  size_t size) {
+  uint32_t start = gpsToSeconds(packGPSDateTime(2023, 10, 25, 12, 34, 56));
+  uint32_t now = gpsFromSeconds(start + millis() / 1000 + offset);
+  size_t length = 0;
+
+  switch (cmd) {
+    case CMD_DATE:
+      formatGPSDate(now, payload, size);
+      return;
+    case CMD_TIME:
+      formatGPSTime(now, payload, size);
+      return;
+    case CMD_TSTAMP:
+    case CMD_F_TIME:
+      formatGPSTimestamp(now, payload, size);
+      return;
+    case CMD_MPU:
+      formatResting(0, 7, payload, size);
+      return;
+    case CMD_MPL:
+      formatResting(7, 3, payload, size);
+      return;
+    case CMD_ALL:
+      length = formatResting(0, 10, payload, size - 1);
+      payload[length++] = ',';
+      // fall through
+    case CMD_GPS:
+      formatGPS(now, payload + length, size - length);
+      return;
+    case CMD_GS:
+      snprintf(payload, size, "GS_OK");
+      return;
+    default:
+      snprintf(payload, size, "OK");
+      return;
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef NYARKOA_SAMPLE_MODULE_H
+#define NYARKOA_SAMPLE_MODULE_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+
+/*
+ * Stand-in Communication and Control Module for NyarkoaPayloadTest on a
+ * board.
+ *
+ * It answers on the legacy text protocol only, at once and in the same
+ * buffer the request arrived in, so it costs about 140 bytes of RAM:
+ *
+ *   - "AT?" is answered with "OK".
+ *   - Commands are echoed with their simpleHash, requests ("REQ:<cmd>") with
+ *     "<simpleHash(cmd)>:<payload>". Link offers ("AT_LINK:...") and
+ *     subscriptions are answered with "ERR", so the payload stays on the
+ *     legacy protocol.
+ *
+ * The sensors report a payload resting on the launch pad, with a little
+ * random noise, and the clock starts at 2023-10-25 12:34:56 UTC. The host
+ * build uses the full emulator, NyarkoaCommSim, instead.
+ */
+class NyarkoaSampleModule : public Stream {
+ public:
+  static const byte TEXT_SIZE{NYARKOA_RESULT_SIZE + 16};
+
+  void setCorrupt(bool damage) { corrupt = damage; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t data) override;
+  using Print::write;
+
+ private:
+  char text[TEXT_SIZE];  // the request, then its reply
+  byte length{0};
+  byte readAt{0};
+  bool replying{false};
+  bool overflow{false};
+  bool corrupt{false};
+
+  void answer();
+  void respond(byte cmd, long offset, char *payload, size_t size);
+};
+
+#endif
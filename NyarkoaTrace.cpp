@@ -0,0 +1,412 @@
+#include <Arduino.h>
+#include <NyarkoaTrace.h>
+
+// Largest encoded record: header, a five-byte DELTA and the data.
+const int TRACE_RECORD_SIZE{1 + 5 + TRACE_RECORD_MAX};
+static_assert(NYARKOA_TRACE_SIZE >= TRACE_RECORD_SIZE,
+              "NYARKOA_TRACE_SIZE must hold the largest record");
+
+/**
+ * Write a trace file header.
+ *
+ * @param out Where to write it.
+ * @param start The time the first record's DELTA counts from.
+ * @return The number of bytes written.
+ */
+static size_t writeHeader(Print &out, unsigned long start) {
+  size_t written = out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  for (byte i = 0; i < 4; i++) written += out.write(byte(start >> (8 * i)));
+  return written;
+}
+
+NyarkoaTraceRecorder::NyarkoaTraceRecorder() { begin(); }
+
+/**
+ * Set the stream to record.
+ *
+ * @param stream The module's stream. Bytes written to the recorder go to it
+ * and bytes read from the recorder come from it.
+ */
+void NyarkoaTraceRecorder::attach(Stream &stream) { inner = &stream; }
+
+/**
+ * Start a new trace.
+ *
+ * @param output A file to write the trace to as it is recorded, or nullptr
+ * to keep it in RAM only. The file header is written at once.
+ *
+ * The RAM trace and the counters are cleared.
+ */
+void NyarkoaTraceRecorder::begin(Print *output) {
+  memset(&stats, 0, sizeof(stats));
+  ringTail = ringCount = 0;
+  recordLength = 0;
+  rxSeen = false;
+  ringStart = lastStart = micros();
+  file = output;
+  if (file != nullptr) writeHeader(*file, ringStart);
+}
+
+/**
+ * Finish the record being collected, so that the trace holds every byte so
+ * far.
+ */
+void NyarkoaTraceRecorder::end() {
+  if (recordLength > 0) finishRecord();
+  if (file != nullptr) file->flush();
+}
+
+/**
+ * Write the trace kept in RAM as a trace file.
+ *
+ * @param out Where to write it, e.g. `Serial` or a file.
+ * @return The number of bytes written.
+ *
+ * The trace holds the latest records that fit in NYARKOA_TRACE_SIZE bytes,
+ * up to the last byte that crossed the link.
+ */
+size_t NyarkoaTraceRecorder::dump(Print &out) {
+  end();
+  size_t written = writeHeader(out, ringStart);
+  for (uint16_t i = 0; i < ringCount; i++) written += out.write(ringAt(i));
+  return written;
+}
+
+/**
+ * Record a byte that crossed the link.
+ *
+ * @param data The byte.
+ * @param rx Whether it came from the module.
+ *
+ * A byte joins the current record unless it travels the other way, the
+ * record is full or the link has paused since the record's last byte.
+ */
+void NyarkoaTraceRecorder::add(byte data, bool rx) {
+  unsigned long now = micros();
+  if (recordLength > 0 &&
+      (rx != recordRx || recordLength >= TRACE_RECORD_MAX ||
+       now - lastByte > TRACE_GAP_MICROS)) {
+    finishRecord();
+  }
+  if (recordLength == 0) {
+    recordRx = rx;
+    recordStart = rx && rxSeen ? rxSeenAt : now;
+  }
+  if (rx) rxSeen = false;
+  record[recordLength++] = data;
+  lastByte = now;
+  stats.bytes++;
+}
+
+/**
+ * Encode the current record into the RAM trace and the file.
+ */
+void NyarkoaTraceRecorder::finishRecord() {
+  byte encoded[TRACE_RECORD_SIZE];
+  byte length = 0;
+  encoded[length++] = (recordRx ? TRACE_RX : 0) | (recordLength - 1);
+  unsigned long delta = recordStart - lastStart;
+  do {
+    byte part = delta & 0x7F;
+    delta >>= 7;
+    encoded[length++] = part | (delta ? 0x80 : 0);
+  } while (delta);
+  memcpy(encoded + length, record, recordLength);
+  length += recordLength;
+
+  ringPush(encoded, length);
+  if (file != nullptr) file->write(encoded, length);
+  lastStart = recordStart;
+  recordLength = 0;
+  stats.records++;
+}
+
+/**
+ * Append an encoded record to the RAM trace, dropping the oldest records
+ * until it fits.
+ *
+ * @param data The encoded record.
+ * @param length Its length.
+ */
+void NyarkoaTraceRecorder::ringPush(const byte *data, byte length) {
+  while (sizeof(ring) - ringCount < length) dropOldest();
+  for (byte i = 0; i < length; i++) {
+    ring[(ringTail + ringCount++) % sizeof(ring)] = data[i];
+  }
+}
+
+/**
+ * Read a byte of the RAM trace.
+ *
+ * @param index The byte's position from the oldest record.
+ * @return The byte.
+ */
+byte NyarkoaTraceRecorder::ringAt(uint16_t index) const {
+  return ring[(ringTail + index) % sizeof(ring)];
+}
+
+/**
+ * Drop the oldest record from the RAM trace.
+ *
+ * Its DELTA moves the trace's start, so that the next record keeps its
+ * time.
+ */
+void NyarkoaTraceRecorder::dropOldest() {
+  byte length = (ringAt(0) & ~TRACE_RX) + 1;
+  uint16_t size = 1;
+  unsigned long delta = 0;
+  byte shift = 0;
+  byte part;
+  do {
+    part = ringAt(size++);
+    delta |= (unsigned long)(part & 0x7F) << shift;
+    shift += 7;
+  } while (part & 0x80);
+  size += length;
+  ringStart += delta;
+  ringTail = (ringTail + size) % sizeof(ring);
+  ringCount -= size;
+  stats.dropped++;
+}
+
+/**
+ * Check whether the module has sent bytes.
+ *
+ * @return The number of bytes that can be read.
+ */
+int NyarkoaTraceRecorder::available() {
+  int count = inner != nullptr ? inner->available() : 0;
+  if (count > 0 && !rxSeen) {
+    rxSeen = true;
+    rxSeenAt = micros();
+  }
+  return count;
+}
+
+/**
+ * Read and record a byte from the module.
+ *
+ * @return The byte, or -1 if none has arrived.
+ */
+int NyarkoaTraceRecorder::read() {
+  int data = inner != nullptr ? inner->read() : -1;
+  if (data >= 0) add(byte(data), true);
+  return data;
+}
+
+/**
+ * Look at the next byte from the module without reading or recording it.
+ *
+ * @return The byte, or -1 if none has arrived.
+ */
+int NyarkoaTraceRecorder::peek() {
+  return inner != nullptr ? inner->peek() : -1;
+}
+
+/**
+ * Record and send a byte to the module.
+ *
+ * @param data The byte to send.
+ * @return The number of bytes sent.
+ */
+size_t NyarkoaTraceRecorder::write(uint8_t data) {
+  if (inner == nullptr) return 0;
+  add(data, false);
+  return inner->write(data);
+}
+
+/**
+ * Wait for the bytes sent to the module to leave.
+ */
+void NyarkoaTraceRecorder::flush() {
+  if (inner != nullptr) inner->flush();
+}
+
+/**
+ * Create a replay of a trace.
+ *
+ * @param trace The trace file's bytes, as written by NyarkoaTraceRecorder.
+ * @param size Its length.
+ * @param originalTiming Whether to keep the recorded pauses; if false the
+ * module's bytes are delivered as soon as the payload has sent what came
+ * before them.
+ */
+NyarkoaTraceReplay::NyarkoaTraceReplay(const byte *trace, size_t size,
+                                       bool originalTiming)
+    : trace(trace), size(size), originalTiming(originalTiming) {
+  valid = size >= TRACE_HEADER_SIZE &&
+          memcmp(trace, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+  begin();
+}
+
+/**
+ * Start the replay from the beginning of the trace, now.
+ */
+void NyarkoaTraceReplay::begin() {
+  memset(&stats, 0, sizeof(stats));
+  unsigned long start = 0;
+  if (valid) {
+    for (byte i = 0; i < 4; i++) {
+      start |= (unsigned long)trace[sizeof(TRACE_MAGIC) + i] << (8 * i);
+    }
+  }
+  rxCursor = txCursor = {.offset = valid ? TRACE_HEADER_SIZE : size,
+                         .time = start};
+  rxRecord.length = txRecord.length = 0;
+  rxIndex = txIndex = 0;
+  txNeeded = 0;
+  anchorTrace = start;
+  anchorReal = micros();
+}
+
+/**
+ * Read the record at a cursor and move the cursor past it.
+ *
+ * @param cursor The cursor.
+ * @param record Receives the record.
+ * @return true if a whole record was read; false at the end of the trace.
+ */
+bool NyarkoaTraceReplay::nextRecord(Cursor &cursor, Record &record) const {
+  size_t at = cursor.offset;
+  if (at >= size) return false;
+  byte header = trace[at++];
+  unsigned long delta = 0;
+  byte shift = 0;
+  byte part;
+  do {
+    if (at >= size || shift > 28) return false;
+    part = trace[at++];
+    delta |= (unsigned long)(part & 0x7F) << shift;
+    shift += 7;
+  } while (part & 0x80);
+  byte length = (header & ~TRACE_RX) + 1;
+  if (size - at < length) return false;
+  cursor.time += delta;
+  cursor.offset = at + length;
+  record = {.rx = (header & TRACE_RX) != 0,
+            .length = length,
+            .data = trace + at,
+            .time = cursor.time};
+  return true;
+}
+
+/**
+ * Move to the next burst from the module once the current one is read,
+ * counting the payload's bytes that come before it.
+ */
+void NyarkoaTraceReplay::advance() {
+  while (rxIndex >= rxRecord.length) {
+    Record record;
+    if (!nextRecord(rxCursor, record)) return;
+    if (!record.rx) {
+      txNeeded += record.length;
+      continue;
+    }
+    rxRecord = record;
+    rxIndex = 0;
+  }
+}
+
+/**
+ * Move the replay's reference point forward.
+ *
+ * @param traceTime The trace time of an event.
+ * @param realTime The time it happened in the replay.
+ *
+ * Events are timed from the latest one in trace order, so the reference
+ * never moves back when the payload runs ahead of the trace.
+ */
+void NyarkoaTraceReplay::anchor(unsigned long traceTime,
+                                unsigned long realTime) {
+  if (long(traceTime - anchorTrace) < 0) return;
+  anchorTrace = traceTime;
+  anchorReal = realTime;
+}
+
+/**
+ * Check whether the current burst from the module may be delivered.
+ *
+ * @return true once the payload has sent the bytes before it and, with
+ * original timing, its recorded pause has passed.
+ */
+bool NyarkoaTraceReplay::isDue() {
+  advance();
+  if (rxIndex >= rxRecord.length || stats.txBytes < txNeeded) return false;
+  if (rxIndex > 0 || !originalTiming) return true;
+  long wait = long(rxRecord.time - anchorTrace);
+  if (long(micros() - anchorReal) + long(TRACE_EARLY_MICROS) < wait) {
+    return false;
+  }
+  anchor(rxRecord.time, anchorReal + (wait > 0 ? wait : 0));
+  return true;
+}
+
+/**
+ * Check whether the replayed module has sent bytes.
+ *
+ * @return The number of bytes of the current burst that can be read.
+ */
+int NyarkoaTraceReplay::available() {
+  return isDue() ? rxRecord.length - rxIndex : 0;
+}
+
+/**
+ * Read a byte of the replayed module.
+ *
+ * @return The byte, or -1 if none is due.
+ */
+int NyarkoaTraceReplay::read() {
+  if (!isDue()) return -1;
+  stats.rxBytes++;
+  return rxRecord.data[rxIndex++];
+}
+
+/**
+ * Look at the next byte of the replayed module without reading it.
+ *
+ * @return The byte, or -1 if none is due.
+ */
+int NyarkoaTraceReplay::peek() {
+  return isDue() ? rxRecord.data[rxIndex] : -1;
+}
+
+/**
+ * Take a byte from the payload and compare it with the trace.
+ *
+ * @param data The byte sent.
+ * @return 1; the replay accepts every byte.
+ */
+size_t NyarkoaTraceReplay::write(uint8_t data) {
+  stats.txBytes++;
+  while (txIndex >= txRecord.length) {
+    Record record;
+    if (!nextRecord(txCursor, record)) {
+      stats.extra++;
+      return 1;
+    }
+    if (record.rx) continue;
+    txRecord = record;
+    txIndex = 0;
+  }
+  if (txIndex == 0) anchor(txRecord.time, micros());
+  if (txRecord.data[txIndex++] != data) stats.mismatches++;
+  return 1;
+}
+
+/**
+ * Check whether the whole trace has been played.
+ *
+ * @return true once every recorded byte from the module has been read and
+ * every recorded byte from the payload has been sent.
+ */
+bool NyarkoaTraceReplay::isFinished() {
+  advance();
+  if (rxIndex < rxRecord.length) return false;
+  Cursor cursor = txCursor;
+  Record record;
+  if (txIndex < txRecord.length) return false;
+  while (nextRecord(cursor, record)) {
+    if (!record.rx) return false;
+  }
+  return true;
+}
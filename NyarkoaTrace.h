@@ -0,0 +1,155 @@
+#ifndef NYARKOA_TRACE_H
+#define NYARKOA_TRACE_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+
+/*
+ * Binary trace of the traffic on the comm module link.
+ *
+ *   "NYT1" | START (uint32 micros, little-endian) | RECORD...
+ *   RECORD: HEADER | DELTA (varint) | DATA[length]
+ *
+ * A record holds bytes that crossed the link in one direction in a single
+ * burst. HEADER bit 7 is set for bytes from the module (TRACE_RX) and clear
+ * for bytes from the payload; bits 0-6 hold the length minus one. DELTA is
+ * the time in microseconds from the previous record's first byte, or from
+ * START for the first record, as a little-endian base-128 varint. A session
+ * of sensor reads takes a little more than the bytes themselves.
+ */
+const byte TRACE_MAGIC[4]{'N', 'Y', 'T', '1'};
+const byte TRACE_HEADER_SIZE{8};
+const byte TRACE_RX{0x80};
+const byte TRACE_RECORD_MAX{32};              // bytes of data per record
+const unsigned long TRACE_GAP_MICROS{2000};   // a pause that ends a burst
+// A replayed burst may arrive this early, so that a payload polling for it
+// at the recorded moment does not miss it by the time its own calls take.
+const unsigned long TRACE_EARLY_MICROS{100};
+
+struct TraceStats {
+  unsigned long records;  // records written
+  unsigned long bytes;    // link bytes recorded
+  unsigned long dropped;  // oldest records dropped from the full ring
+};
+
+/**
+ * Stream that records what passes through it.
+ *
+ * The recorder sits between the payload and the module's stream, which is
+ * set with `attach`, usually by NyarkoaPayload::setTrace. It keeps the
+ * latest NYARKOA_TRACE_SIZE bytes of trace in RAM, dropping the oldest
+ * records when full, and can also write every record to a file as it is
+ * finished, e.g. an SD card file or a file on a host. Bytes from the module
+ * are timed from when `available` first reported them, which is when the
+ * payload learned of them.
+ */
+class NyarkoaTraceRecorder : public Stream {
+ public:
+  NyarkoaTraceRecorder();
+
+  void attach(Stream &inner);
+  void begin(Print *file = nullptr);
+  void end();
+  size_t dump(Print &out);
+  const TraceStats &getStats() const { return stats; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t data) override;
+  void flush() override;
+  using Print::write;
+
+ private:
+  Stream *inner{nullptr};
+  Print *file{nullptr};
+  TraceStats stats;
+  byte ring[NYARKOA_TRACE_SIZE];
+  uint16_t ringTail{0};   // oldest record
+  uint16_t ringCount{0};
+  unsigned long ringStart{0};  // time the oldest record's DELTA counts from
+  unsigned long lastStart{0};  // first byte of the last finished record
+  byte record[TRACE_RECORD_MAX];
+  byte recordLength{0};
+  bool recordRx{false};
+  unsigned long recordStart{0};
+  unsigned long lastByte{0};
+  bool rxSeen{false};          // available() reported bytes not read yet
+  unsigned long rxSeenAt{0};
+
+  void add(byte data, bool rx);
+  void finishRecord();
+  void ringPush(const byte *data, byte length);
+  byte ringAt(uint16_t index) const;
+  void dropOldest();
+};
+
+struct ReplayStats {
+  unsigned long rxBytes;     // bytes delivered to the payload
+  unsigned long txBytes;     // bytes the payload sent
+  unsigned long mismatches;  // bytes sent that differ from the trace
+  unsigned long extra;       // bytes sent beyond the end of the trace
+};
+
+/**
+ * Stream that plays a recorded trace back to the payload.
+ *
+ * The module's bytes are delivered in order, each burst only once the
+ * payload has sent everything that preceded it in the trace. With original
+ * timing a burst also waits as long after the last event, the payload's
+ * request or the previous burst, as it did when it was recorded; otherwise
+ * it is delivered at once. The bytes the payload sends are compared with
+ * the recorded ones, so a replay shows whether the payload still behaves as
+ * it did.
+ */
+class NyarkoaTraceReplay : public Stream {
+ public:
+  NyarkoaTraceReplay(const byte *trace, size_t size,
+                     bool originalTiming = true);
+
+  bool isValid() const { return valid; }
+  void begin();
+  bool isFinished();
+  const ReplayStats &getStats() const { return stats; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t data) override;
+  using Print::write;
+
+ private:
+  // Position in the trace and the time of the record there.
+  struct Cursor {
+    size_t offset;
+    unsigned long time;
+  };
+  // A record read at a cursor.
+  struct Record {
+    bool rx;
+    byte length;
+    const byte *data;
+    unsigned long time;
+  };
+
+  const byte *trace;
+  size_t size;
+  bool originalTiming;
+  bool valid;
+  ReplayStats stats;
+  Cursor rxCursor;
+  Record rxRecord;
+  byte rxIndex;
+  unsigned long txNeeded;  // payload bytes the current burst waits for
+  Cursor txCursor;
+  Record txRecord;
+  byte txIndex;
+  unsigned long anchorTrace;  // trace time of the last event
+  unsigned long anchorReal;   // micros() when it happened in the replay
+
+  bool nextRecord(Cursor &cursor, Record &record) const;
+  void advance();
+  bool isDue();
+  void anchor(unsigned long traceTime, unsigned long realTime);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef NYARKOA_TYPES_H
+#define NYARKOA_TYPES_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+
+// Text returned by the library. With NYARKOA_NO_HEAP defined it points into
+// the library's own buffers instead of being copied into a String, and stays
+// valid until the next request is started.
+#ifdef NYARKOA_NO_HEAP
+typedef const char *NyarkoaText;
+#else
+typedef String NyarkoaText;
+#endif
+
+struct Response {
+  bool isOk;
+  NyarkoaText message;
+};
+
+struct AnalogPins {
+  byte A0;
+  byte A1;
+  byte A2;
+  byte A3;
+};
+
+struct I2CPins {
+  byte SDA;
+  byte SCL;
+};
+
+struct SPIPins {
+  byte CS;
+  byte MOSI;
+  byte MISO;
+  byte SCK;
+};
+
+struct DigitalPins {
+  byte D2;
+  byte D3;
+  byte D6;
+  byte D7;
+  byte D8;
+  byte D9;
+  byte D10;
+  byte D11;
+  byte D12;
+  byte D13;
+};
+
+struct InterruptPins {
+  byte D2;
+  byte D3;
+};
+
+struct PWMPins {
+  byte D3;
+  byte D6;
+  byte D7;
+  byte D9;
+  byte D10;
+  byte D11;
+};
+
+struct CommUART {
+  byte Rx;
+  byte Tx;
+};
+
+struct MPUData {
+  float accelX;
+  float accelY;
+  float accelZ;
+  float gyroX;
+  float gyroY;
+  float gyroZ;
+  float temp;
+};
+
+struct MPLData {
+  float pressure;
+  float altitude;
+  float temperature;
+};
+
+// A GPS fix as plain numbers, so it can be copied, logged or downlinked
+// without heap allocation. Use the helpers in NyarkoaGPS.h to unpack the
+// date and time or to format fields as text.
+struct GPSData {
+  int32_t lat;                // degrees * GPS_COORD_SCALE (1e7)
+  int32_t lon;                // degrees * GPS_COORD_SCALE (1e7)
+  uint32_t dateTime;          // packed UTC date and time
+  uint16_t speed;             // km/h
+  uint16_t distanceFromHome;  // metres
+  uint8_t nSats;
+};
+
+// All sensor groups from a single AT_ALL request, sampled together by the
+// communication module.
+struct Snapshot {
+  MPUData mpu;
+  MPLData mpl;
+  GPSData gps;
+};
+
+// Round-trip times of one command, in milliseconds, from sending the
+// attempt that was answered to receiving the answer.
+struct CommandStats {
+  uint16_t count;     // answers timed; halved with rttTotal when it fills
+  uint16_t rttMin;
+  uint16_t rttMax;
+  uint32_t rttTotal;  // rttTotal / count is the average
+};
+
+// Counters of everything that happened on the comm link since connecting or
+// the last resetLinkStats().
+struct LinkStats {
+  uint32_t requests;       // commands and requests started
+  uint32_t retries;        // attempts sent again
+  uint32_t timeouts;       // attempts that were not answered in time
+  uint32_t checkFailures;  // answers that failed their hash, CRC or frame
+                           // check
+  uint32_t failures;       // commands and requests that used every attempt
+                           // or were refused by the module (NACK)
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+};
+
+// Counters of the ground station downlink queue, read with
+// getDownlinkStats().
+struct DownlinkStats {
+  uint32_t records;   // records the ground station acknowledged
+  uint32_t batches;   // messages the ground station acknowledged
+  uint32_t failures;  // messages that used every attempt; their records stay
+                      // queued
+  uint32_t dropped;   // oldest records dropped to make room
+};
+
+#endif
@@ -50,10 +50,16 @@ void loop() {
                  " | temperature: " + String(mpl.temperature));
 
   gps = nyarkoa.getGPSData();
-  Serial.println("nSats: " + gps.nSats + " | lat: " + gps.lat +
-                 " | lon: " + gps.lon + " | Date: " + gps.date +
-                 " | Time: " + gps.time + " | Speed: " + gps.speed +
-                 " | Distance from home: " + gps.distanceFromHome);
+  char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+  char date[GPS_DATE_TEXT_SIZE], time[GPS_TIME_TEXT_SIZE];
+  formatGPSCoordinate(gps.lat, lat, sizeof(lat));
+  formatGPSCoordinate(gps.lon, lon, sizeof(lon));
+  formatGPSDate(gps.dateTime, date, sizeof(date));
+  formatGPSTime(gps.dateTime, time, sizeof(time));
+  Serial.println("nSats: " + String(gps.nSats) + " | lat: " + lat +
+                 " | lon: " + lon + " | Date: " + date + " | Time: " + time +
+                 " | Speed: " + String(gps.speed) +
+                 " | Distance from home: " + String(gps.distanceFromHome));
 
   delay(10000);
 }
\ No newline at end of file
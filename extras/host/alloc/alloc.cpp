@@ -0,0 +1,174 @@
+// Check that a NYARKOA_NO_HEAP build of the library never allocates.
+//
+//   nyarkoa_alloc
+//
+// Every public NyarkoaPayload method, and the encoders and recorders a
+// flight sketch uses with it, runs against the emulated comm module on the
+// legacy, CRC and binary links. The shim counts operator new, String and
+// the C allocator (malloc, calloc, realloc), so an allocation anywhere in
+// the library fails the check. Exits with status 1 and names every step
+// that allocated.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaDelta.h>
+#include <NyarkoaPayload.h>
+#include <NyarkoaTrace.h>
+#include <ShimClock.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef NYARKOA_NO_HEAP
+#error "nyarkoa_alloc checks the NYARKOA_NO_HEAP build"
+#endif
+
+namespace {
+
+NyarkoaCommSim *module = nullptr;
+byte callbackHandle = 0;
+
+struct Step {
+  const char *name;
+  void (*run)(NyarkoaPayload &payload);
+};
+
+void onResult(byte handle, const Response &response) {
+  callbackHandle = handle;
+}
+
+void runAsync(NyarkoaPayload &p) {
+  byte handle = p.beginRequest("AT_MPU");
+  while (!p.isReady(handle)) p.poll();
+  p.getResult(handle);
+  p.setRequestCallback(onResult);
+  handle = p.beginCommand("AT_EN_BEC");
+  while (callbackHandle != handle) p.poll();
+  p.setRequestCallback(nullptr);
+}
+
+#if NYARKOA_STREAM_DEPTH
+void runStream(NyarkoaPayload &p) {
+  MPUData data;
+  if (!p.subscribe(CMD_MPU, 50)) return;  // not on the legacy link
+  unsigned long start = millis();
+  while (!p.readSample(data) && millis() - start < 1000) p.poll();
+  p.unsubscribe(CMD_MPU);
+}
+#endif
+
+#if NYARKOA_DOWNLINK_SIZE
+void runDownlink(NyarkoaPayload &p) {
+  p.queueDownlink("TLM", "alt=512.3");
+  p.queueTelemetry(p.getSnapshot());
+  p.flushDownlink();
+}
+#endif
+
+void runDelta(NyarkoaPayload &p) {
+  NyarkoaDeltaEncoder encoder;
+  NyarkoaDeltaDecoder decoder;
+  MPUData data = p.getMPUData();
+  char text[DELTA_TEXT_SIZE];
+  encoder.encode(data, text, sizeof(text));
+  decoder.decode(text, data);
+}
+
+const Step STEPS[] = {
+    {"connectCommModule",
+     [](NyarkoaPayload &p) { p.connectCommModule(*module); }},
+    {"syncClock", [](NyarkoaPayload &p) { p.syncClock(); }},
+    {"getDate", [](NyarkoaPayload &p) { p.getDate(); }},
+    {"getTime", [](NyarkoaPayload &p) { p.getTime(); }},
+    {"getTimestamp", [](NyarkoaPayload &p) { p.getTimestamp(); }},
+    {"getTimeAfter", [](NyarkoaPayload &p) { p.getTimeAfter(30, 1); }},
+    {"getMPUData", [](NyarkoaPayload &p) { p.getMPUData(); }},
+    {"getMPLData", [](NyarkoaPayload &p) { p.getMPLData(); }},
+    {"getGPSData", [](NyarkoaPayload &p) { p.getGPSData(); }},
+    {"getSnapshot", [](NyarkoaPayload &p) { p.getSnapshot(); }},
+    {"alert", [](NyarkoaPayload &p) { p.alert(100); }},
+    {"enableBeacon", [](NyarkoaPayload &p) { p.enableBeacon(); }},
+    {"disableBeacon", [](NyarkoaPayload &p) { p.disableBeacon(); }},
+    {"commAction", [](NyarkoaPayload &p) { p.commAction("AT_DIS_BEC"); }},
+    {"requestAction", [](NyarkoaPayload &p) { p.requestAction("AT_TIME"); }},
+    {"contactGroundStation",
+     [](NyarkoaPayload &p) { p.contactGroundStation("TLM", "alt=512.3"); }},
+    {"async", runAsync},
+#if NYARKOA_STREAM_DEPTH
+    {"subscribe", runStream},
+#endif
+#if NYARKOA_DOWNLINK_SIZE
+    {"downlink", runDownlink},
+#endif
+    {"delta", runDelta},
+    {"linkStats",
+     [](NyarkoaPayload &p) {
+       p.getLinkStats();
+       p.getCommandStats(CMD_MPU);
+       p.resetLinkStats();
+     }},
+    {"ejectBalloon", [](NyarkoaPayload &p) { p.ejectBalloon(); }},
+};
+
+const char *const LINKS[] = {"legacy", "crc", "binary"};
+
+// Whether the shim counts a malloc; without its --wrap link options it
+// cannot, and every check would pass.
+bool hookIsActive() {
+  void *(*volatile allocate)(size_t) = malloc;
+  shim::resetHeapStats();
+  void *block = allocate(16);
+  bool counted = shim::heapStats().allocations == 1;
+  free(block);
+  return counted;
+}
+
+unsigned long allocations() { return shim::heapStats().allocations; }
+
+}  // namespace
+
+int main() {
+  HardwareSerial::mute(true);
+  if (!hookIsActive()) {
+    fprintf(stderr, "malloc is not counted by the shim\n");
+    return 1;
+  }
+
+  int failures = 0;
+  for (byte link = 0; link < 3; link++) {
+    shim::setMicros(0);
+    CommSimConfig config = NyarkoaCommSim::defaultConfig();
+    config.linkModes = link == 0   ? 0
+                       : link == 1 ? SIM_LINK_CRC
+                                   : SIM_LINK_CRC | SIM_LINK_BINARY;
+
+    shim::resetHeapStats();
+    NyarkoaCommSim sim(config);
+    NyarkoaTraceRecorder recorder;
+    NyarkoaPayload payload;
+    if (allocations() != 0) {
+      fprintf(stderr, "%s: construction allocates\n", LINKS[link]);
+      failures++;
+    }
+    module = &sim;
+    payload.activateProdMode();
+    payload.setTrace(&recorder);
+    if (link == 2) payload.enableBinaryLink();
+
+    for (const Step &step : STEPS) {
+      shim::resetHeapStats();
+      step.run(payload);
+      if (allocations() != 0) {
+        fprintf(stderr, "%s/%s: %lu allocations\n", LINKS[link], step.name,
+                allocations());
+        failures++;
+      }
+    }
+    printf("%-7s %u steps checked\n", LINKS[link],
+           unsigned(sizeof(STEPS) / sizeof(STEPS[0])));
+  }
+  if (failures) {
+    fprintf(stderr, "%d steps allocate in a NYARKOA_NO_HEAP build\n",
+            failures);
+    return 1;
+  }
+  return 0;
+}
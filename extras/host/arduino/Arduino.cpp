@@ -0,0 +1,182 @@
+#include <Arduino.h>
+#include <ShimClock.h>
+#include <malloc.h>
+#include <time.h>
+
+#include <new>
+
+// The C allocator itself, reached past the --wrap link options of the shim
+// (see CMakeLists.txt).
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+}
+
+namespace {
+
+thread_local bool realTime = false;
+thread_local uint64_t virtualMicros = 0;
+thread_local uint32_t pollTick = 4;
+thread_local uint64_t realEpoch = 0;
+thread_local shim::HeapStats heap = {0, 0, 0};
+thread_local unsigned long rngState = 1;
+
+uint64_t monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000ULL + uint64_t(ts.tv_nsec) / 1000ULL;
+}
+
+}  // namespace
+
+namespace shim {
+
+void useRealTime(bool enable) {
+  realTime = enable;
+  realEpoch = monotonicMicros();
+}
+
+bool isRealTime() { return realTime; }
+
+uint64_t nowMicros() {
+  if (realTime) return monotonicMicros() - realEpoch;
+  return virtualMicros;
+}
+
+void setMicros(uint64_t us) { virtualMicros = us; }
+
+void advanceMicros(uint64_t us) {
+  if (realTime) {
+    struct timespec ts;
+    ts.tv_sec = time_t(us / 1000000ULL);
+    ts.tv_nsec = long(us % 1000000ULL) * 1000L;
+    nanosleep(&ts, nullptr);
+    return;
+  }
+  virtualMicros += us;
+}
+
+void setPollTick(uint32_t us) { pollTick = us; }
+
+HeapStats heapStats() { return heap; }
+
+void resetHeapStats() { heap = {0, 0, 0}; }
+
+// Every block carries its size in a small header so frees can be accounted.
+void *heapRealloc(void *ptr, unsigned long size) {
+  size_t *block = ptr ? static_cast<size_t *>(ptr) - 1 : nullptr;
+  if (block) heap.bytes -= *block;
+  block = static_cast<size_t *>(__real_realloc(block, sizeof(size_t) + size));
+  if (!block) return nullptr;
+  *block = size;
+  heap.allocations++;
+  heap.bytes += size;
+  return block + 1;
+}
+
+void heapFree(void *ptr) {
+  if (!ptr) return;
+  size_t *block = static_cast<size_t *>(ptr) - 1;
+  heap.frees++;
+  heap.bytes -= *block;
+  __real_free(block);
+}
+
+}  // namespace shim
+
+// malloc and friends called by the library, the shim or a host tool are
+// linked to these instead, so that the counters see raw C allocations too.
+// Their blocks have no size header; the allocator's usable size is counted.
+extern "C" {
+
+void *__wrap_malloc(size_t size) {
+  void *ptr = __real_malloc(size);
+  if (ptr) {
+    heap.allocations++;
+    heap.bytes += malloc_usable_size(ptr);
+  }
+  return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *ptr = __real_calloc(count, size);
+  if (ptr) {
+    heap.allocations++;
+    heap.bytes += malloc_usable_size(ptr);
+  }
+  return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  size_t before = ptr ? malloc_usable_size(ptr) : 0;
+  void *moved = __real_realloc(ptr, size);
+  if (moved) {
+    heap.allocations++;
+    heap.bytes += malloc_usable_size(moved) - before;
+  } else if (ptr && size == 0) {
+    heap.frees++;  // glibc frees the block
+    heap.bytes -= before;
+  }
+  return moved;
+}
+
+void __wrap_free(void *ptr) {
+  if (!ptr) return;
+  heap.frees++;
+  heap.bytes -= malloc_usable_size(ptr);
+  __real_free(ptr);
+}
+
+}  // extern "C"
+
+void *operator new(size_t size) {
+  void *ptr = shim::heapRealloc(nullptr, size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { shim::heapFree(ptr); }
+void operator delete[](void *ptr) noexcept { shim::heapFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { shim::heapFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { shim::heapFree(ptr); }
+
+unsigned long millis() { return (unsigned long)(micros() / 1000UL); }
+
+unsigned long micros() {
+  if (!realTime) virtualMicros += pollTick;
+  return (unsigned long)shim::nowMicros();
+}
+
+void delay(unsigned long ms) { shim::advanceMicros(uint64_t(ms) * 1000ULL); }
+
+void delayMicroseconds(unsigned int us) { shim::advanceMicros(us); }
+
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+int analogRead(uint8_t) { return int(random(1024)); }
+void analogWrite(uint8_t, int) {}
+
+// Park-Miller minimal standard generator, as used by avr-libc random().
+long random(long howbig) {
+  if (howbig == 0) return 0;
+  long hi = long(rngState / 127773UL);
+  long lo = long(rngState % 127773UL);
+  long x = 16807L * lo - 2836L * hi;
+  if (x <= 0) x += 0x7fffffffL;
+  rngState = (unsigned long)x;
+  return long(rngState % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) rngState = seed;
+}
@@ -0,0 +1,20 @@
+#include <Arduino.h>
+#include <stdio.h>
+
+namespace {
+thread_local bool consoleMuted = false;
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::mute(bool muted) { consoleMuted = muted; }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!consoleMuted) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (!consoleMuted) fwrite(buffer, 1, size, stdout);
+  return size;
+}
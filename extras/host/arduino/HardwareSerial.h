@@ -0,0 +1,24 @@
+#ifndef ARDUINO_HOST_HARDWARE_SERIAL_H
+#define ARDUINO_HOST_HARDWARE_SERIAL_H
+#include "Stream.h"
+
+// Console serial port. Output goes to stdout unless muted; input is never
+// available. Muting is per thread so parallel simulations stay quiet.
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  operator bool() const { return true; }
+
+  static void mute(bool muted);
+};
+
+extern HardwareSerial Serial;
+
+#endif
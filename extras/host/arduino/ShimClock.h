@@ -0,0 +1,39 @@
+#ifndef ARDUINO_HOST_SHIM_CLOCK_H
+#define ARDUINO_HOST_SHIM_CLOCK_H
+#include <stdint.h>
+
+// Host-side control of the shim's clock and heap accounting.
+//
+// By default time is virtual: it only moves when delay() is called, when a
+// simulated transport jumps to its next event, or by a small per-call tick
+// on millis()/micros() that models the cost of a busy-wait iteration (so
+// polling loops always make progress). Clock and counters are thread-local,
+// so independent simulations can run in parallel threads.
+namespace shim {
+
+void useRealTime(bool realTime);
+bool isRealTime();
+uint64_t nowMicros();
+void setMicros(uint64_t us);
+void advanceMicros(uint64_t us);
+// Virtual time added by every millis()/micros() call. Default 4 us.
+void setPollTick(uint32_t us);
+
+struct HeapStats {
+  unsigned long allocations;
+  unsigned long frees;
+  unsigned long bytes;
+};
+HeapStats heapStats();
+void resetHeapStats();
+// realloc/free wrappers that keep the counters above; String uses these and
+// the shim replaces global operator new/delete with them. Calls to malloc,
+// calloc, realloc and free are counted as well: programs linking the shim
+// must pass -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free, as
+// CMakeLists.txt does.
+void *heapRealloc(void *ptr, unsigned long size);
+void heapFree(void *ptr);
+
+}  // namespace shim
+
+#endif
@@ -0,0 +1,49 @@
+#include <SoftwareSerial.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+SoftwareSerial::SoftwareSerial(uint8_t, uint8_t, bool) {}
+
+SoftwareSerial::~SoftwareSerial() { end(); }
+
+void SoftwareSerial::begin(long) {
+  end();
+  const char *device = getenv("NYARKOA_SERIAL_DEVICE");
+  if (!device) return;
+  fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) return;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+}
+
+void SoftwareSerial::end() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+  peeked = -1;
+}
+
+int SoftwareSerial::peek() {
+  if (peeked >= 0) return peeked;
+  if (fd < 0) return -1;
+  unsigned char c;
+  if (::read(fd, &c, 1) == 1) peeked = c;
+  return peeked;
+}
+
+int SoftwareSerial::available() { return peek() >= 0 ? 1 : 0; }
+
+int SoftwareSerial::read() {
+  int c = peek();
+  peeked = -1;
+  return c;
+}
+
+size_t SoftwareSerial::write(uint8_t c) {
+  if (fd < 0) return 1;
+  return ::write(fd, &c, 1) == 1 ? 1 : 0;
+}
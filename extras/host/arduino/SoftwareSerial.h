@@ -0,0 +1,30 @@
+#ifndef ARDUINO_HOST_SOFTWARE_SERIAL_H
+#define ARDUINO_HOST_SOFTWARE_SERIAL_H
+#include "Stream.h"
+
+// Host stand-in for the AVR SoftwareSerial. When the NYARKOA_SERIAL_DEVICE
+// environment variable names a tty (for example the pty served by the comm
+// module emulator) begin() opens it raw and the port reads and writes it;
+// otherwise the port is disconnected and never receives anything.
+class SoftwareSerial : public Stream {
+ public:
+  SoftwareSerial(uint8_t receivePin, uint8_t transmitPin,
+                 bool inverseLogic = false);
+  ~SoftwareSerial();
+  void begin(long speed);
+  void end();
+  bool listen() { return true; }
+  bool isListening() { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  int fd{-1};
+  int peeked{-1};
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef ARDUINO_HOST_STREAM_H
+#define ARDUINO_HOST_STREAM_H
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { streamTimeout = timeout; }
+  unsigned long getTimeout() const { return streamTimeout; }
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    return readBytes(reinterpret_cast<char *>(buffer), length);
+  }
+  String readString();
+  String readStringUntil(char terminator);
+
+ protected:
+  unsigned long streamTimeout{1000};
+  int timedRead();
+};
+
+#endif
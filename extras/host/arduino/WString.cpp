@@ -0,0 +1,363 @@
+#include <Arduino.h>
+#include <ShimClock.h>
+#include <ctype.h>
+#include <stdio.h>
+
+namespace {
+
+void formatInteger(char *buf, size_t size, unsigned long value, bool negative,
+                   unsigned char base) {
+  char tmp[8 * sizeof(long) + 2];
+  char *p = tmp + sizeof(tmp) - 1;
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    unsigned long digit = value % base;
+    *--p = char(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  snprintf(buf, size, "%s", p);
+}
+
+void formatSigned(char *buf, size_t size, long value, unsigned char base) {
+  if (base == 10 && value < 0) {
+    formatInteger(buf, size, 0UL - (unsigned long)value, true, base);
+  } else {
+    formatInteger(buf, size, (unsigned long)value, false, base);
+  }
+}
+
+void formatFloat(char *buf, size_t size, double value, unsigned char digits) {
+  snprintf(buf, size, "%.*f", int(digits), value);
+}
+
+}  // namespace
+
+void String::init() {
+  buffer = nullptr;
+  capacity = 0;
+  len = 0;
+}
+
+void String::invalidate() {
+  shim::heapFree(buffer);
+  init();
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+  char *next =
+      static_cast<char *>(shim::heapRealloc(buffer, maxStrLen + 1UL));
+  if (!next) return false;
+  buffer = next;
+  capacity = maxStrLen;
+  return true;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buffer && capacity >= size) return true;
+  if (!changeBuffer(size)) return false;
+  if (len == 0) buffer[0] = '\0';
+  return true;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+  if (!reserve(length)) {
+    invalidate();
+    return *this;
+  }
+  len = length;
+  memcpy(buffer, cstr, length);
+  buffer[len] = '\0';
+  return *this;
+}
+
+void String::move(String &rhs) {
+  shim::heapFree(buffer);
+  buffer = rhs.buffer;
+  capacity = rhs.capacity;
+  len = rhs.len;
+  rhs.init();
+}
+
+String::String(const char *cstr) {
+  init();
+  if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const char *cstr, unsigned int length) {
+  init();
+  if (cstr) copy(cstr, length);
+}
+
+String::String(const String &str) {
+  init();
+  *this = str;
+}
+
+String::String(String &&rval) {
+  init();
+  move(rval);
+}
+
+String::String(const __FlashStringHelper *str) {
+  init();
+  *this = reinterpret_cast<const char *>(str);
+}
+
+String::String(char c) {
+  init();
+  char buf[2] = {c, '\0'};
+  *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned char)];
+  formatInteger(buf, sizeof(buf), value, false, base);
+  *this = buf;
+}
+
+String::String(int value, unsigned char base) {
+  init();
+  char buf[2 + 8 * sizeof(int)];
+  formatSigned(buf, sizeof(buf), value, base);
+  *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned int)];
+  formatInteger(buf, sizeof(buf), value, false, base);
+  *this = buf;
+}
+
+String::String(long value, unsigned char base) {
+  init();
+  char buf[2 + 8 * sizeof(long)];
+  formatSigned(buf, sizeof(buf), value, base);
+  *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned long)];
+  formatInteger(buf, sizeof(buf), value, false, base);
+  *this = buf;
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+  init();
+  char buf[64];
+  formatFloat(buf, sizeof(buf), value, decimalPlaces);
+  *this = buf;
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+  init();
+  char buf[64];
+  formatFloat(buf, sizeof(buf), value, decimalPlaces);
+  *this = buf;
+}
+
+String::~String() { shim::heapFree(buffer); }
+
+String &String::operator=(const String &rhs) {
+  if (this == &rhs) return *this;
+  if (rhs.buffer) {
+    copy(rhs.buffer, rhs.len);
+  } else {
+    invalidate();
+  }
+  return *this;
+}
+
+String &String::operator=(String &&rval) {
+  if (this != &rval) move(rval);
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  } else {
+    invalidate();
+  }
+  return *this;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  unsigned int newlen = len + length;
+  if (!cstr) return false;
+  if (length == 0) return true;
+  if (!reserve(newlen)) return false;
+  memmove(buffer + len, cstr, length);
+  len = newlen;
+  buffer[len] = '\0';
+  return true;
+}
+
+bool String::concat(const String &str) { return concat(str.c_str(), str.len); }
+
+bool String::concat(const char *cstr) {
+  if (!cstr) return false;
+  return concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c) { return concat(&c, 1); }
+bool String::concat(unsigned char num) { return concat(String(num)); }
+bool String::concat(int num) { return concat(String(num)); }
+bool String::concat(unsigned int num) { return concat(String(num)); }
+bool String::concat(long num) { return concat(String(num)); }
+bool String::concat(unsigned long num) { return concat(String(num)); }
+bool String::concat(float num) { return concat(String(num)); }
+bool String::concat(double num) { return concat(String(num)); }
+
+int String::compareTo(const String &s) const {
+  return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+  return len == s.len && compareTo(s) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+  return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+  if (len < prefix.len) return false;
+  return strncmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  if (len < suffix.len) return false;
+  return strcmp(c_str() + len - suffix.len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const { return operator[](index); }
+
+char String::operator[](unsigned int index) const {
+  if (index >= len || !buffer) return 0;
+  return buffer[index];
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= len || !buffer) {
+    dummy = 0;
+    return dummy;
+  }
+  return buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize,
+                      unsigned int index) const {
+  if (!bufsize || !buf) return;
+  if (index >= len) {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = bufsize - 1;
+  if (n > len - index) n = len - index;
+  memcpy(buf, buffer + index, n);
+  buf[n] = 0;
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize,
+                         unsigned int index) const {
+  getBytes(reinterpret_cast<unsigned char *>(buf), bufsize, index);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char *found = strchr(buffer + fromIndex, ch);
+  return found ? int(found - buffer) : -1;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char *found = strstr(buffer + fromIndex, str.c_str());
+  return found ? int(found - buffer) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+  if (!len) return -1;
+  const char *found = strrchr(buffer, ch);
+  return found ? int(found - buffer) : -1;
+}
+
+String String::substring(unsigned int beginIndex) const {
+  return substring(beginIndex, len);
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+  if (left > right) {
+    unsigned int tmp = right;
+    right = left;
+    left = tmp;
+  }
+  if (left >= len) return String();
+  if (right > len) right = len;
+  return String(buffer + left, right - left);
+}
+
+void String::trim() {
+  if (!buffer || len == 0) return;
+  char *begin = buffer;
+  while (isspace(static_cast<unsigned char>(*begin))) begin++;
+  char *end = buffer + len - 1;
+  while (end >= begin && isspace(static_cast<unsigned char>(*end))) end--;
+  len = end + 1 - begin;
+  if (begin > buffer) memmove(buffer, begin, len);
+  buffer[len] = '\0';
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < len; i++) buffer[i] = char(toupper(buffer[i]));
+}
+
+void String::toLowerCase() {
+  for (unsigned int i = 0; i < len; i++) buffer[i] = char(tolower(buffer[i]));
+}
+
+long String::toInt() const { return buffer ? atol(buffer) : 0; }
+
+float String::toFloat() const { return float(toDouble()); }
+
+double String::toDouble() const { return buffer ? atof(buffer) : 0; }
+
+String operator+(const String &lhs, const String &rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String &lhs, char rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String &lhs, int rhs) { return lhs + String(rhs); }
+String operator+(const String &lhs, unsigned int rhs) {
+  return lhs + String(rhs);
+}
+String operator+(const String &lhs, long rhs) { return lhs + String(rhs); }
+String operator+(const String &lhs, unsigned long rhs) {
+  return lhs + String(rhs);
+}
+String operator+(const String &lhs, float rhs) { return lhs + String(rhs); }
+String operator+(const String &lhs, double rhs) { return lhs + String(rhs); }
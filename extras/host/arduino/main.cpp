@@ -0,0 +1,23 @@
+// Sketch entry point for host builds: runs setup() once and then loop(),
+// like the Arduino core does. Set ARDUINO_LOOPS to stop after that many
+// iterations instead of looping forever, and ARDUINO_REAL_TIME=1 to run on
+// the wall clock (needed when talking to a real or emulated device).
+#include <Arduino.h>
+#include <ShimClock.h>
+#include <stdlib.h>
+
+void setup();
+void loop();
+
+int main() {
+  const char *loops = getenv("ARDUINO_LOOPS");
+  const char *realTime = getenv("ARDUINO_REAL_TIME");
+  long remaining = loops ? atol(loops) : -1;
+  if (realTime && *realTime && *realTime != '0') shim::useRealTime(true);
+  setup();
+  while (remaining != 0) {
+    loop();
+    if (remaining > 0) remaining--;
+  }
+  return 0;
+}
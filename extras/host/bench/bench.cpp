@@ -0,0 +1,501 @@
+// Benchmark of the public NyarkoaPayload API against the emulated comm
+// module, in simulated time.
+//
+// Every method runs N times on each link protocol. For each method and link
+// the harness reports the round-trip latency (p50/p99/mean/max, simulated
+// microseconds), bytes on the wire in each direction, requests the module
+// received, retries the library sent, heap allocations, peak stack and host
+// CPU time. Results can be written as JSON and compared against an earlier
+// run:
+//
+//   nyarkoa_bench --output base.json
+//   ... change the protocol ...
+//   nyarkoa_bench --baseline base.json
+//
+// The link is seeded and time is simulated, so two runs of the same code
+// give the same numbers (apart from host CPU time). A run that regresses
+// beyond the threshold exits with status 1. A build with NYARKOA_NO_HEAP
+// also fails if any call allocates.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaPayload.h>
+#include <ShimClock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+NyarkoaCommSim *module = nullptr;
+
+struct BenchCase {
+  const char *name;
+  void (*run)(NyarkoaPayload &payload);
+  void (*setup)(NyarkoaPayload &payload);  // once after connecting, or nullptr
+};
+
+// The three sensors' requests pipelined, each collected as soon as it is
+// ready. The library's own requests have slots of their own, so all three
+// fit the sketch's.
+static_assert(NYARKOA_MAX_PENDING >= 3, "asyncSensors pipelines 3 requests");
+
+void runAsyncSensors(NyarkoaPayload &payload) {
+  byte handles[3] = {payload.beginRequest("AT_MPU"),
+                     payload.beginRequest("AT_MPL"),
+                     payload.beginRequest("AT_GPS")};
+  for (byte i = 0; i < 3; i++) {
+    while (!payload.isReady(handles[i])) payload.poll();
+    payload.getResult(handles[i]);
+  }
+}
+
+#if NYARKOA_STREAM_DEPTH
+// Pushed readings are asked for faster than the UART can carry them, so each
+// call measures the time the link needs per reading. The legacy protocol
+// cannot carry pushed readings and polls instead.
+const float STREAM_RATE_HZ{1000};
+
+void subscribeMPU(NyarkoaPayload &payload) {
+  payload.subscribe(CMD_MPU, STREAM_RATE_HZ);
+}
+
+void runStreamMPU(NyarkoaPayload &payload) {
+  MPUData data;
+  if (!payload.isCrcLink() && !payload.isBinaryLink()) {
+    payload.getMPUData(data);
+    return;
+  }
+  while (!payload.readSample(data)) payload.poll();
+}
+#endif
+
+const BenchCase CASES[] = {
+    {"connectCommModule",
+     [](NyarkoaPayload &p) { p.connectCommModule(*module); }, nullptr},
+    {"ejectBalloon", [](NyarkoaPayload &p) { p.ejectBalloon(); }, nullptr},
+    {"alert", [](NyarkoaPayload &p) { p.alert(100); }, nullptr},
+    {"enableBeacon", [](NyarkoaPayload &p) { p.enableBeacon(); }, nullptr},
+    {"disableBeacon", [](NyarkoaPayload &p) { p.disableBeacon(); }, nullptr},
+    {"getDate", [](NyarkoaPayload &p) { p.getDate(); }, nullptr},
+    {"getTime", [](NyarkoaPayload &p) { p.getTime(); }, nullptr},
+    {"getTimestamp", [](NyarkoaPayload &p) { p.getTimestamp(); }, nullptr},
+    {"getTimeAfter", [](NyarkoaPayload &p) { p.getTimeAfter(30, 1); },
+     nullptr},
+    {"getMPUData", [](NyarkoaPayload &p) { p.getMPUData(); }, nullptr},
+    {"getMPLData", [](NyarkoaPayload &p) { p.getMPLData(); }, nullptr},
+    {"getGPSData", [](NyarkoaPayload &p) { p.getGPSData(); }, nullptr},
+    {"getSnapshot", [](NyarkoaPayload &p) { p.getSnapshot(); }, nullptr},
+    {"contactGroundStation",
+     [](NyarkoaPayload &p) { p.contactGroundStation("TLM", "alt=512.3"); },
+     nullptr},
+    {"asyncSensors", runAsyncSensors, nullptr},
+#if NYARKOA_STREAM_DEPTH
+    {"streamMPU", runStreamMPU, subscribeMPU},
+#endif
+};
+
+const char *const LINKS[] = {"legacy", "crc", "binary"};
+
+// Metrics of one method on one link. Values are per call.
+struct Result {
+  std::string link;
+  std::string method;
+  double p50;
+  double p99;
+  double mean;
+  double max;
+  double txBytes;
+  double rxBytes;
+  double requests;
+  double retries;
+  double heapAllocs;
+  double heapBytes;
+  double stackBytes;
+  double cpuNanos;
+};
+
+struct Metric {
+  const char *key;
+  double Result::*field;
+  bool gated;  // compared against the baseline
+};
+
+const Metric METRICS[] = {
+    {"p50_us", &Result::p50, true},
+    {"p99_us", &Result::p99, true},
+    {"mean_us", &Result::mean, false},
+    {"max_us", &Result::max, false},
+    {"tx_bytes", &Result::txBytes, true},
+    {"rx_bytes", &Result::rxBytes, true},
+    {"requests", &Result::requests, true},
+    {"retries", &Result::retries, true},
+    {"heap_allocs", &Result::heapAllocs, true},
+    {"heap_bytes", &Result::heapBytes, false},
+    {"stack_bytes", &Result::stackBytes, true},
+    {"cpu_ns", &Result::cpuNanos, false},
+};
+
+// Peak stack use is measured by painting unused stack below the caller with
+// a pattern and finding the deepest byte a call overwrote.
+const size_t STACK_PROBE_SIZE = 256 * 1024;
+const byte STACK_PAINT = 0xCD;
+uintptr_t stackProbe = 0;
+
+__attribute__((noinline)) void paintStack() {
+  volatile byte area[STACK_PROBE_SIZE];
+  for (size_t i = 0; i < STACK_PROBE_SIZE; i++) area[i] = STACK_PAINT;
+  stackProbe = reinterpret_cast<uintptr_t>(area);
+}
+
+__attribute__((noinline)) size_t measureStack() {
+  volatile byte *area = reinterpret_cast<volatile byte *>(stackProbe);
+  size_t untouched = 0;
+  while (untouched < STACK_PROBE_SIZE && area[untouched] == STACK_PAINT) {
+    untouched++;
+  }
+  return STACK_PROBE_SIZE - untouched;
+}
+
+uint64_t cpuNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+unsigned long transactions(const CommSimStats &stats) {
+  return stats.commands + stats.duplicates + stats.badChecks + stats.unknown;
+}
+
+double percentile(std::vector<double> sorted, double fraction) {
+  std::sort(sorted.begin(), sorted.end());
+  size_t rank = size_t(fraction * sorted.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  return sorted[rank - 1];
+}
+
+double average(const std::vector<double> &values) {
+  double sum = 0;
+  for (double value : values) sum += value;
+  return values.empty() ? 0 : sum / values.size();
+}
+
+struct Options {
+  unsigned long iterations{200};
+  unsigned long seed{1};
+  CommSimConfig link{NyarkoaCommSim::defaultConfig()};
+  const char *links{"all"};
+  const char *filter{nullptr};
+  const char *output{nullptr};
+  const char *baseline{nullptr};
+  double threshold{5.0};
+};
+
+// Connect a payload to a module speaking the given link protocol.
+bool connectLink(NyarkoaPayload &payload, NyarkoaCommSim &sim,
+                 const char *link, const Options &options) {
+  CommSimConfig config = options.link;
+  if (strcmp(link, "legacy") == 0) {
+    config.linkModes = 0;
+  } else if (strcmp(link, "crc") == 0) {
+    config.linkModes = SIM_LINK_CRC;
+  } else {
+    config.linkModes = SIM_LINK_CRC | SIM_LINK_BINARY;
+    payload.enableBinaryLink();
+  }
+  sim.setConfig(config);
+  payload.activateProdMode();
+  return payload.connectCommModule(sim).isOk;
+}
+
+Result runCase(const BenchCase &bench, const char *link,
+               const Options &options) {
+  // Every case starts from the same clock and seed, so its numbers do not
+  // depend on which cases ran before it.
+  shim::setMicros(0);
+  randomSeed(options.seed);
+  NyarkoaCommSim sim;
+  NyarkoaPayload payload;
+  module = &sim;
+  if (!connectLink(payload, sim, link, options)) {
+    fprintf(stderr, "%s: cannot connect on the %s link\n", bench.name, link);
+  }
+  if (bench.setup != nullptr) bench.setup(payload);
+
+  std::vector<double> latency, cpu, requests;
+  latency.reserve(options.iterations);
+  cpu.reserve(options.iterations);
+  requests.reserve(options.iterations);
+  Result result = Result();
+  result.link = link;
+  result.method = bench.name;
+
+  // One unmeasured call first, so that one-off costs such as resolving
+  // shared library symbols do not count against the method.
+  bench.run(payload);
+
+  for (unsigned long i = 0; i < options.iterations; i++) {
+    CommSimStats before = sim.getStats();
+    LinkStats linkBefore = payload.getLinkStats();
+    paintStack();
+    shim::resetHeapStats();
+    uint64_t startCpu = cpuNanos();
+    uint64_t start = shim::nowMicros();
+    bench.run(payload);
+    uint64_t elapsed = shim::nowMicros() - start;
+    uint64_t elapsedCpu = cpuNanos() - startCpu;
+    shim::HeapStats heap = shim::heapStats();
+    size_t stack = measureStack();
+    const CommSimStats &after = sim.getStats();
+    const LinkStats &linkAfter = payload.getLinkStats();
+
+    latency.push_back(double(elapsed));
+    cpu.push_back(double(elapsedCpu));
+    requests.push_back(double(transactions(after) - transactions(before)));
+    result.txBytes += after.bytesIn - before.bytesIn;
+    result.rxBytes += after.bytesOut - before.bytesOut;
+    result.retries += linkAfter.retries - linkBefore.retries;
+    result.heapAllocs += heap.allocations;
+    result.heapBytes += heap.bytes + 0.0;
+    if (stack > result.stackBytes) result.stackBytes = stack;
+  }
+
+  double n = double(options.iterations);
+  result.p50 = percentile(latency, 0.50);
+  result.p99 = percentile(latency, 0.99);
+  result.mean = average(latency);
+  result.max = *std::max_element(latency.begin(), latency.end());
+  result.txBytes /= n;
+  result.rxBytes /= n;
+  result.requests = average(requests);
+  result.retries /= n;
+  result.heapAllocs /= n;
+  result.heapBytes /= n;
+  result.cpuNanos = percentile(cpu, 0.50);
+  return result;
+}
+
+bool writeJson(const char *path, const std::vector<Result> &results,
+               const Options &options) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+#ifdef NYARKOA_NO_HEAP
+  const char *noHeap = "true";
+#else
+  const char *noHeap = "false";
+#endif
+  fprintf(file,
+          "{\n  \"iterations\": %lu,\n  \"seed\": %lu,\n"
+          "  \"latency_us\": %lu,\n  \"jitter_us\": %lu,\n  \"baud\": %lu,\n"
+          "  \"no_heap\": %s,\n  \"results\": [\n",
+          options.iterations, options.seed, options.link.latencyMicros,
+          options.link.jitterMicros, options.link.baudRate, noHeap);
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &result = results[i];
+    fprintf(file, "    {\"link\": \"%s\", \"method\": \"%s\"",
+            result.link.c_str(), result.method.c_str());
+    for (const Metric &metric : METRICS) {
+      fprintf(file, ", \"%s\": %.6g", metric.key, result.*metric.field);
+    }
+    fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+  return true;
+}
+
+// Find `"key": "text"` or `"key": number` in a result line.
+bool findField(const std::string &line, const char *key, std::string &value) {
+  std::string pattern = std::string("\"") + key + "\": ";
+  size_t at = line.find(pattern);
+  if (at == std::string::npos) return false;
+  at += pattern.size();
+  if (line[at] == '"') {
+    size_t end = line.find('"', at + 1);
+    value = line.substr(at + 1, end - at - 1);
+  } else {
+    value = line.substr(at, line.find_first_of(",}", at) - at);
+  }
+  return true;
+}
+
+// Read the results of an earlier run, as written by writeJson.
+bool readJson(const char *path, std::vector<Result> &results) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), file) != nullptr) {
+    std::string line = buffer;
+    Result result = Result();
+    if (!findField(line, "link", result.link) ||
+        !findField(line, "method", result.method)) {
+      continue;
+    }
+    for (const Metric &metric : METRICS) {
+      std::string value;
+      if (findField(line, metric.key, value)) {
+        result.*metric.field = atof(value.c_str());
+      }
+    }
+    results.push_back(result);
+  }
+  fclose(file);
+  return true;
+}
+
+void printResults(const std::vector<Result> &results) {
+  printf("%-7s %-21s %9s %9s %7s %7s %5s %7s %6s %6s %8s\n", "link",
+         "method", "p50 us", "p99 us", "tx B", "rx B", "reqs", "retries",
+         "allocs", "stack", "cpu ns");
+  for (const Result &result : results) {
+    printf("%-7s %-21s %9.0f %9.0f %7.1f %7.1f %5.2f %7.3f %6.2f %6.0f "
+           "%8.0f\n",
+           result.link.c_str(), result.method.c_str(), result.p50,
+           result.p99, result.txBytes, result.rxBytes, result.requests,
+           result.retries, result.heapAllocs, result.stackBytes,
+           result.cpuNanos);
+  }
+}
+
+// Compare gated metrics with the baseline; returns the number of
+// regressions.
+int compareResults(const std::vector<Result> &results,
+                   const std::vector<Result> &baseline, double threshold) {
+  int regressions = 0;
+  printf("\n%-7s %-21s %-12s %12s %12s %8s\n", "link", "method", "metric",
+         "baseline", "now", "change");
+  for (const Result &result : results) {
+    const Result *old = nullptr;
+    for (const Result &candidate : baseline) {
+      if (candidate.link == result.link &&
+          candidate.method == result.method) {
+        old = &candidate;
+      }
+    }
+    if (old == nullptr) {
+      printf("%-7s %-21s (not in baseline)\n", result.link.c_str(),
+             result.method.c_str());
+      continue;
+    }
+    for (const Metric &metric : METRICS) {
+      double before = old->*metric.field;
+      double now = result.*metric.field;
+      if (before == now) continue;
+      double change = before ? (now - before) * 100 / before : 100;
+      bool regressed = metric.gated && now > before * (1 + threshold / 100) &&
+                       now - before > 1e-9;
+      if (regressed) regressions++;
+      printf("%-7s %-21s %-12s %12.6g %12.6g %+7.1f%%%s\n",
+             result.link.c_str(), result.method.c_str(), metric.key, before,
+             now, change, regressed ? "  REGRESSION" : "");
+    }
+  }
+  return regressions;
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --iterations N   calls per method and link (default 200)\n"
+          "  --link NAME      legacy, crc, binary or all (default all)\n"
+          "  --filter TEXT    only methods whose name contains TEXT\n"
+          "  --latency MS     module processing time (default 2)\n"
+          "  --jitter MS      extra random latency, up to (default 1)\n"
+          "  --baud N         UART speed, 0 for unlimited (default 115200)\n"
+          "  --seed N         seed for jitter and sensor noise (default 1)\n"
+          "  --output FILE    write the results as JSON\n"
+          "  --baseline FILE  compare with the results of an earlier run\n"
+          "  --threshold PCT  allowed growth before a regression (default "
+          "5)\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(arg, "--iterations") == 0) {
+      options.iterations = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--link") == 0) {
+      options.links = value;
+    } else if (strcmp(arg, "--filter") == 0) {
+      options.filter = value;
+    } else if (strcmp(arg, "--latency") == 0) {
+      options.link.latencyMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--jitter") == 0) {
+      options.link.jitterMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--baud") == 0) {
+      options.link.baudRate = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--output") == 0) {
+      options.output = value;
+    } else if (strcmp(arg, "--baseline") == 0) {
+      options.baseline = value;
+    } else if (strcmp(arg, "--threshold") == 0) {
+      options.threshold = atof(value);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.iterations == 0) options.iterations = 1;
+  HardwareSerial::mute(true);
+
+  std::vector<Result> results;
+  for (const char *link : LINKS) {
+    if (strcmp(options.links, "all") != 0 && strcmp(options.links, link) != 0)
+      continue;
+    for (const BenchCase &bench : CASES) {
+      if (options.filter && strstr(bench.name, options.filter) == nullptr)
+        continue;
+      results.push_back(runCase(bench, link, options));
+    }
+  }
+  if (results.empty()) {
+    fprintf(stderr, "no benchmark matches\n");
+    return 2;
+  }
+  printResults(results);
+
+  int status = 0;
+  if (options.output && !writeJson(options.output, results, options)) {
+    status = 2;
+  }
+#ifdef NYARKOA_NO_HEAP
+  for (const Result &result : results) {
+    if (result.heapAllocs > 0) {
+      fprintf(stderr, "%s/%s allocates in a NYARKOA_NO_HEAP build\n",
+              result.link.c_str(), result.method.c_str());
+      status = 1;
+    }
+  }
+#endif
+  if (options.baseline) {
+    std::vector<Result> baseline;
+    if (!readJson(options.baseline, baseline)) return 2;
+    int regressions = compareResults(results, baseline, options.threshold);
+    printf("\n%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    if (regressions && status == 0) status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,362 @@
+// Delta records of a simulated flight's telemetry, and their decoder.
+//
+//   nyarkoa_delta check [options]   encode a flight's snapshots as delta
+//                                   records, decode them and compare
+//   nyarkoa_delta decode            decode ground station records from stdin
+//
+// `check` reads a snapshot at a fixed rate from the pad until after landing,
+// as nyarkoa_flight does, and encodes each as DMPU, DMPL and DGPS records
+// with NyarkoaDeltaEncoder. The records are decoded again with
+// NyarkoaDeltaDecoder, after dropping some of them with --loss, and every
+// decoded sample must hold exactly the fields that were encoded. It reports
+// the size of the records against the decimal text the module sends for the
+// same readings, and the time the encoder takes. --records prints the
+// records, one per line, for `decode`:
+//
+//   nyarkoa_delta check --records | nyarkoa_delta decode > telemetry.csv
+//
+// `decode` takes lines as the ground station receives them: single records
+// ("GS::DMPU::..." or "DMPU::...") or batches ("GS::BATCH::...;..."). It
+// prints a CSV row for every sample decoded and skips other records.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaDelta.h>
+#include <NyarkoaFlight.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaPayload.h>
+#include <ShimClock.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <random>
+#include <string>
+
+namespace {
+
+struct Options {
+  float rate{10};
+  float afterLanding{10};
+  float lossPercent{0};
+  unsigned long seed{1};
+  bool records{false};
+  FlightConfig flight{NyarkoaFlight::defaultConfig()};
+};
+
+// Sizes of one stream's records in `check`.
+struct StreamTally {
+  unsigned long records;
+  unsigned long keys;
+  unsigned long deltaBytes;  // "DMPU::" and the record
+  unsigned long keyBytes;    // of the key records among them
+  unsigned long textBytes;   // "MPU::" and the decimal text
+  unsigned long mismatches;  // decoded samples that differ from the sample
+};
+
+const char *const TEXT_NAMES[DELTA_STREAM_COUNT] = {"MPU", "MPL", "GPS"};
+
+uint64_t cpuNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+// Decimal text of a reading as the module sends it, e.g. "1.25,-0.05".
+std::string decimalText(const float *values, byte count) {
+  std::string text;
+  char field[16];
+  for (byte i = 0; i < count; i++) {
+    snprintf(field, sizeof(field), "%s%.2f", i ? "," : "", values[i]);
+    text += field;
+  }
+  return text;
+}
+
+std::string decimalText(const GPSData &gps) {
+  char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+  char date[GPS_DATE_TEXT_SIZE], time[GPS_TIME_TEXT_SIZE];
+  formatGPSCoordinate(gps.lat, lat, sizeof(lat));
+  formatGPSCoordinate(gps.lon, lon, sizeof(lon));
+  formatGPSDate(gps.dateTime, date, sizeof(date));
+  formatGPSTime(gps.dateTime, time, sizeof(time));
+  char text[80];
+  snprintf(text, sizeof(text), "%u,%s,%s,%s,%s,%u,%u", gps.nSats, lat, lon,
+           date, time, gps.speed, gps.distanceFromHome);
+  return text;
+}
+
+// Print a decoded sample as a CSV row.
+void printRow(DeltaStream stream, const int32_t *fields) {
+  printf("%s", deltaStreamName(stream));
+  if (stream == DELTA_GPS) {
+    GPSData gps;
+    fromDeltaFields(fields, gps);
+    char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+    char timestamp[GPS_TIMESTAMP_TEXT_SIZE];
+    formatGPSCoordinate(gps.lat, lat, sizeof(lat));
+    formatGPSCoordinate(gps.lon, lon, sizeof(lon));
+    formatGPSTimestamp(gps.dateTime, timestamp, sizeof(timestamp));
+    printf(",%s,%s,%s,%u,%u,%u\n", lat, lon, timestamp, gps.speed,
+           gps.distanceFromHome, gps.nSats);
+    return;
+  }
+  for (byte i = 0; i < deltaFieldCount(stream); i++) {
+    if (fields[i] == DELTA_NO_READING) {
+      putchar(',');  // NaN, left empty
+      continue;
+    }
+    byte decimals = deltaFieldDecimals(stream, i);
+    printf(",%.*f", int(decimals), fields[i] / pow(10.0, decimals));
+  }
+  putchar('\n');
+}
+
+// Whether NaN and readings beyond a field's range survive a record: NaN as
+// NaN, the others clamped.
+bool checkLimits() {
+  const MPUData sample = {.accelX = NAN,
+                          .accelY = 1e30f,
+                          .accelZ = -INFINITY,
+                          .gyroX = 0.0015f,
+                          .gyroY = -1e7f,
+                          .gyroZ = INFINITY,
+                          .temp = 25.5f};
+  NyarkoaDeltaEncoder encoder;
+  NyarkoaDeltaDecoder decoder;
+  char record[DELTA_TEXT_SIZE];
+  MPUData data;
+  if (encoder.encode(sample, record, sizeof(record)) == 0 ||
+      !decoder.decode(record, data)) {
+    return false;
+  }
+  const float clamped = DELTA_FIXED_MAX / 100.0f;
+  return isnan(data.accelX) && data.accelY == clamped &&
+         data.accelZ == -clamped && data.gyroX == 0.002f &&
+         data.gyroY == -DELTA_FIXED_MAX / 1000.0f &&
+         data.gyroZ == DELTA_FIXED_MAX / 1000.0f && data.temp == 25.5f;
+}
+
+int check(const Options &options) {
+  if (!checkLimits()) {
+    fprintf(stderr, "NaN or out-of-range readings do not decode as clamped\n");
+    return 1;
+  }
+  shim::setMicros(0);
+  randomSeed(options.seed);
+  NyarkoaCommSim module;
+  NyarkoaFlight flight(options.flight);
+  module.setFlight(&flight);
+  NyarkoaPayload payload;
+  payload.enableBinaryLink();
+  payload.activateProdMode();
+  if (!payload.connectCommModule(module).isOk) {
+    fprintf(stderr, "cannot connect to the emulated module\n");
+    return 1;
+  }
+
+  std::mt19937 lossRandom(options.seed);
+  std::uniform_real_distribution<float> percent(0, 100);
+  NyarkoaDeltaEncoder encoder;
+  NyarkoaDeltaDecoder decoder;
+  StreamTally tally[DELTA_STREAM_COUNT] = {};
+  uint64_t encodeNanos = 0, encodeMax = 0;
+  unsigned long snapshots = 0, lost = 0;
+  unsigned long period = (unsigned long)(1e6 / options.rate + 0.5);
+  uint64_t next = shim::nowMicros();
+  float landedAt = -1;
+  for (;;) {
+    Snapshot s;
+    if (payload.getSnapshot(s)) {
+      snapshots++;
+      int32_t fields[DELTA_STREAM_COUNT][DELTA_MAX_FIELDS];
+      toDeltaFields(s.mpu, fields[DELTA_MPU]);
+      toDeltaFields(s.mpl, fields[DELTA_MPL]);
+      toDeltaFields(s.gps, fields[DELTA_GPS]);
+      const float mpu[] = {s.mpu.accelX, s.mpu.accelY, s.mpu.accelZ,
+                           s.mpu.gyroX,  s.mpu.gyroY,  s.mpu.gyroZ,
+                           s.mpu.temp};
+      const float mpl[] = {s.mpl.pressure, s.mpl.altitude,
+                           s.mpl.temperature};
+      std::string text[DELTA_STREAM_COUNT] = {
+          decimalText(mpu, 7), decimalText(mpl, 3), decimalText(s.gps)};
+
+      for (byte i = 0; i < DELTA_STREAM_COUNT; i++) {
+        DeltaStream stream = DeltaStream(i);
+        char record[DELTA_TEXT_SIZE];
+        uint64_t start = cpuNanos();
+        size_t length = encoder.encode(stream, fields[i], record,
+                                       sizeof(record));
+        uint64_t spent = cpuNanos() - start;
+        encodeNanos += spent;
+        if (spent > encodeMax) encodeMax = spent;
+
+        StreamTally &t = tally[i];
+        size_t bytes = strlen(deltaStreamName(stream)) + 2 + length;
+        t.records++;
+        t.deltaBytes += bytes;
+        t.textBytes += strlen(TEXT_NAMES[i]) + 2 + text[i].size();
+        if (record[0] >= 'W' || record[0] == '-') {
+          t.keys++;  // HEADER digits of 32 and above
+          t.keyBytes += bytes;
+        }
+        if (options.records) {
+          printf("%s::%s\n", deltaStreamName(stream), record);
+        }
+        if (percent(lossRandom) < options.lossPercent) {
+          lost++;
+          continue;
+        }
+        int32_t decoded[DELTA_MAX_FIELDS];
+        if (!decoder.decode(stream, record, decoded)) continue;
+        if (memcmp(decoded, fields[i], deltaFieldCount(stream) * 4) != 0) {
+          t.mismatches++;
+        }
+      }
+    }
+    const FlightState &state = flight.getState();
+    if (state.phase == FLIGHT_LANDED && landedAt < 0) landedAt = state.seconds;
+    if (landedAt >= 0 && state.seconds >= landedAt + options.afterLanding) {
+      break;
+    }
+    next += period;
+    uint64_t now = shim::nowMicros();
+    if (next > now) shim::advanceMicros(next - now);
+  }
+
+  unsigned long records = 0, mismatches = 0;
+  fprintf(stderr, "%u snapshots, %.0f s of flight\n\n", unsigned(snapshots),
+          flight.getState().seconds);
+  fprintf(stderr, "stream   text B/rec  delta B/rec   key B/rec  ratio\n");
+  for (byte i = 0; i < DELTA_STREAM_COUNT; i++) {
+    const StreamTally &t = tally[i];
+    records += t.records;
+    mismatches += t.mismatches;
+    if (t.records == 0) continue;
+    fprintf(stderr, "%-6s %12.1f %12.1f %11.1f %6.2f\n",
+            deltaStreamName(DeltaStream(i)), double(t.textBytes) / t.records,
+            double(t.deltaBytes) / t.records,
+            t.keys ? double(t.keyBytes) / t.keys : 0.0,
+            double(t.textBytes) / t.deltaBytes);
+  }
+  const DeltaStats &stats = decoder.getStats();
+  fprintf(stderr,
+          "\nencode: %.0f ns mean, %lu ns max per record\n"
+          "decode: %lu records lost, %lu decoded, %lu skipped to the next "
+          "key record, %lu invalid, %lu differ from the samples\n",
+          records ? double(encodeNanos) / records : 0.0,
+          (unsigned long)encodeMax, lost, stats.records, stats.skipped,
+          stats.invalid, mismatches);
+  return mismatches == 0 && stats.invalid == 0 ? 0 : 1;
+}
+
+// Decode one "NAME::text" record, printing its sample.
+void decodeRecord(NyarkoaDeltaDecoder &decoder, std::string record,
+                  unsigned long &others) {
+  if (record.compare(0, 4, "GS::") == 0) record.erase(0, 4);
+  size_t separator = record.find("::");
+  DeltaStream stream = separator == std::string::npos
+                           ? DELTA_STREAM_COUNT
+                           : deltaStreamFromName(
+                                 record.substr(0, separator).c_str());
+  if (stream == DELTA_STREAM_COUNT) {
+    others++;
+    return;
+  }
+  int32_t fields[DELTA_MAX_FIELDS];
+  if (decoder.decode(stream, record.c_str() + separator + 2, fields)) {
+    printRow(stream, fields);
+  }
+}
+
+int decode() {
+  NyarkoaDeltaDecoder decoder;
+  unsigned long others = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    std::string text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+      text.pop_back();
+    }
+    if (text.compare(0, 4, "GS::") == 0) text.erase(0, 4);
+    if (text.compare(0, 7, "BATCH::") == 0) text.erase(0, 7);
+    size_t start = 0;
+    for (;;) {
+      size_t end = text.find(';', start);
+      decodeRecord(decoder, text.substr(start, end - start), others);
+      if (end == std::string::npos) break;
+      start = end + 1;
+    }
+  }
+  const DeltaStats &stats = decoder.getStats();
+  fprintf(stderr,
+          "%lu samples decoded, %lu skipped to the next key record, %lu "
+          "repeated, %lu invalid, %lu other records\n",
+          stats.records, stats.skipped, stats.repeated, stats.invalid,
+          others);
+  return stats.invalid == 0 ? 0 : 1;
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s check [options]\n"
+          "       %s decode < records\n"
+          "  --rate HZ        snapshots per second (default 10)\n"
+          "  --loss PCT       records lost before decoding (default 0)\n"
+          "  --records        print the records to stdout\n"
+          "  --burst M        balloon burst height (default 1000)\n"
+          "  --after S        time to keep reading after landing "
+          "(default 10)\n"
+          "  --seed N         seed for the flight, noise and loss "
+          "(default 1)\n",
+          name, name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (argc < 2) {
+    usage(argv[0]);
+    return 2;
+  }
+  for (int i = 2; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--records") == 0) {
+      options.records = true;
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(arg, "--rate") == 0) {
+      options.rate = atof(value);
+    } else if (strcmp(arg, "--loss") == 0) {
+      options.lossPercent = atof(value);
+    } else if (strcmp(arg, "--burst") == 0) {
+      options.flight.burstAltitude = atof(value);
+    } else if (strcmp(arg, "--after") == 0) {
+      options.afterLanding = atof(value);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.rate <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  HardwareSerial::mute(true);
+
+  if (strcmp(argv[1], "check") == 0) return check(options);
+  if (strcmp(argv[1], "decode") == 0) return decode();
+  usage(argv[0]);
+  return 2;
+}
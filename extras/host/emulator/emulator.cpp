@@ -0,0 +1,176 @@
+// Communication and Control Module emulator.
+//
+// Serves an emulated module on a pseudo-terminal so that a host build of a
+// sketch (or any serial tool) can hold full sessions with it:
+//
+//   nyarkoa_emulator --link /tmp/nyarkoa &
+//   NYARKOA_SERIAL_DEVICE=/tmp/nyarkoa ARDUINO_REAL_TIME=1 ./SampleLive
+//
+// Runs until interrupted, then prints what the module saw.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <ShimClock.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) { running = 0; }
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --link PATH      create a symlink to the pty at PATH\n"
+          "  --latency MS     processing time per request (default 2)\n"
+          "  --jitter MS      extra random latency, up to (default 1)\n"
+          "  --baud N         UART speed, 0 for unlimited (default 115200)\n"
+          "  --drift PPM      how fast the module clock runs (default 0)\n"
+          "  --drop PCT       share of replies lost (default 0)\n"
+          "  --corrupt PCT    share of replies with a bit flipped (default 0)\n"
+          "  --legacy         refuse CRC and binary links\n"
+          "  --no-binary      refuse binary links\n"
+          "  --no-crc         refuse CRC links\n"
+          "  --flight         sensors follow a balloon flight\n"
+          "  --time-scale N   run the flight N times faster (default 1)\n"
+          "  --seed N         seed for sensor noise and jitter\n"
+          "  --quiet          do not log traffic\n",
+          name);
+}
+
+static unsigned long toMicros(const char *ms) {
+  return (unsigned long)(atof(ms) * 1000 + 0.5);
+}
+
+// Open a pty and put its terminal side in raw mode. The terminal side is kept
+// open so that the pty survives clients closing and reopening it.
+static int openPty(int &terminal) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return -1;
+  terminal = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (terminal < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(terminal, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(terminal, TCSANOW, &tio);
+  }
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  return master;
+}
+
+int main(int argc, char **argv) {
+  CommSimConfig config = NyarkoaCommSim::defaultConfig();
+  FlightConfig flightConfig = NyarkoaFlight::defaultConfig();
+  const char *link = nullptr;
+  bool quiet = false;
+  bool flying = false;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--link") == 0 && hasValue) {
+      link = argv[++i];
+    } else if (strcmp(arg, "--latency") == 0 && hasValue) {
+      config.latencyMicros = toMicros(argv[++i]);
+    } else if (strcmp(arg, "--jitter") == 0 && hasValue) {
+      config.jitterMicros = toMicros(argv[++i]);
+    } else if (strcmp(arg, "--baud") == 0 && hasValue) {
+      config.baudRate = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--drift") == 0 && hasValue) {
+      config.clockDriftPpm = strtol(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--drop") == 0 && hasValue) {
+      config.dropPercent = atoi(argv[++i]);
+    } else if (strcmp(arg, "--corrupt") == 0 && hasValue) {
+      config.corruptPercent = atoi(argv[++i]);
+    } else if (strcmp(arg, "--legacy") == 0) {
+      config.linkModes = 0;
+    } else if (strcmp(arg, "--no-binary") == 0) {
+      config.linkModes &= ~SIM_LINK_BINARY;
+    } else if (strcmp(arg, "--no-crc") == 0) {
+      config.linkModes &= ~SIM_LINK_CRC;
+    } else if (strcmp(arg, "--flight") == 0) {
+      flying = true;
+    } else if (strcmp(arg, "--time-scale") == 0 && hasValue) {
+      flightConfig.timeScale = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--seed") == 0 && hasValue) {
+      randomSeed(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(arg, "--quiet") == 0) {
+      quiet = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  int terminal;
+  int master = openPty(terminal);
+  if (master < 0) {
+    perror("pty");
+    return 1;
+  }
+  const char *device = ptsname(master);
+  if (link != nullptr) {
+    unlink(link);
+    if (symlink(device, link) < 0) {
+      perror(link);
+      return 1;
+    }
+  }
+  printf("Comm module on %s\n", link ? link : device);
+  fflush(stdout);
+
+  shim::useRealTime(true);
+  NyarkoaCommSim module(config);
+  if (!quiet) module.setLog(&Serial);
+  NyarkoaFlight flight(flightConfig);
+  if (flying) module.setFlight(&flight);
+  FlightPhase phase = FLIGHT_PAD;
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  while (running) {
+    // Wake for incoming bytes, or in time to release the next reply byte.
+    struct pollfd fds = {master, POLLIN, 0};
+    if (poll(&fds, 1, module.available() ? 0 : 1) < 0 && errno != EINTR) {
+      break;
+    }
+    byte buffer[256];
+    ssize_t count;
+    while ((count = read(master, buffer, sizeof(buffer))) > 0) {
+      module.write(buffer, count);
+    }
+    while (module.available()) {
+      byte data = module.peek();
+      if (write(master, &data, 1) != 1) break;
+      module.read();
+    }
+    if (flying && flight.now().phase != phase) {
+      static const char *const PHASES[] = {"pad", "ascent", "free fall",
+                                           "parachute", "landed"};
+      phase = flight.getState().phase;
+      if (!quiet) {
+        printf("FLIGHT: %s at %.1f s, %.0f m\n", PHASES[phase],
+               flight.getState().seconds, flight.getState().altitude);
+      }
+    }
+    fflush(stdout);
+  }
+
+  const CommSimStats &stats = module.getStats();
+  printf("\ncommands %lu, bad checks %lu, unknown %lu, duplicates %lu, "
+         "ejections %lu, GS messages %lu (%lu records), pushes %lu, "
+         "dropped %lu, corrupted %lu, bytes in %lu, bytes out %lu\n",
+         stats.commands, stats.badChecks, stats.unknown, stats.duplicates,
+         stats.ejections, stats.groundMessages, stats.groundRecords,
+         stats.pushes, stats.dropped, stats.corrupted, stats.bytesIn,
+         stats.bytesOut);
+  if (link != nullptr) unlink(link);
+  close(terminal);
+  close(master);
+  return 0;
+}
@@ -0,0 +1,314 @@
+// Goodput of the NyarkoaPayload link protocols under injected faults, in
+// simulated time.
+//
+// The payload talks to the emulated comm module through a NyarkoaFaultLink
+// that loses, flips, duplicates and truncates bytes and stalls the link at
+// the given rates. Each link protocol runs the same cycle of sensor reads
+// (MPU, MPL, GPS and snapshot) twice, over a clean link and over the faulty
+// one. For each run the harness reports:
+//
+//   - goodput: bytes of correct sensor data delivered per simulated second,
+//     and how much of the clean link's goodput survives the faults;
+//   - the share of calls that failed after all their attempts;
+//   - call latency (p50, p99, p99.9 and max, simulated milliseconds), failed
+//     calls included;
+//   - retries per call;
+//   - undetected corruption: calls that reported success with data that
+//     differs from what the module sent, per thousand successful calls.
+//
+// The module's sensors are noise-free, so every reading can be checked
+// against a reference read over the clean link; only the GPS time moves,
+// and it must match the module clock. Faults on the way to the module show
+// up as failed or retried calls; the harness does not check what the module
+// did with a damaged command.
+//
+// The faults and the link are seeded, so two runs of the same code give the
+// same numbers.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaFaultLink.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaPayload.h>
+#include <ShimClock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *const LINKS[] = {"legacy", "crc", "binary"};
+
+enum Reading : byte { READ_MPU, READ_MPL, READ_GPS, READ_SNAPSHOT,
+                      READING_COUNT };
+
+// Bytes of sensor data each call delivers.
+const size_t READING_SIZES[] = {sizeof(MPUData), sizeof(MPLData),
+                                sizeof(GPSData), sizeof(Snapshot)};
+
+struct Options {
+  unsigned long calls{2000};
+  unsigned long seed{1};
+  CommSimConfig link{NyarkoaCommSim::defaultConfig()};
+  FaultLinkConfig faults{.seed = 1,
+                         .lossPpm = 500,
+                         .bitErrorPpm = 500,
+                         .duplicatePpm = 200,
+                         .truncatePpm = 200,
+                         .stallPpm = 100,
+                         .stallMicros = 50000};
+  const char *links{"all"};
+};
+
+struct Result {
+  std::string link;
+  bool faulty;
+  unsigned long calls;
+  unsigned long failed;
+  unsigned long undetected;
+  double goodput;  // bytes per second
+  double p50;      // milliseconds
+  double p99;
+  double p999;
+  double max;
+  double retries;  // per call
+  FaultLinkStats injected;
+};
+
+double percentile(std::vector<double> sorted, double fraction) {
+  std::sort(sorted.begin(), sorted.end());
+  size_t rank = size_t(fraction * sorted.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  return sorted[rank - 1];
+}
+
+bool sameMPU(const MPUData &a, const MPUData &b) {
+  return a.accelX == b.accelX && a.accelY == b.accelY &&
+         a.accelZ == b.accelZ && a.gyroX == b.gyroX && a.gyroY == b.gyroY &&
+         a.gyroZ == b.gyroZ && a.temp == b.temp;
+}
+
+bool sameMPL(const MPLData &a, const MPLData &b) {
+  return a.pressure == b.pressure && a.altitude == b.altitude &&
+         a.temperature == b.temperature;
+}
+
+// The module clock reads whole seconds of simulated time since it started
+// at shim time 0; the reading was taken between `start` and `end`.
+bool sameGPS(const GPSData &a, const GPSData &b, const Options &options,
+             uint64_t start, uint64_t end) {
+  uint32_t base = gpsToSeconds(options.link.startTime);
+  uint32_t seconds = gpsToSeconds(a.dateTime);
+  return a.lat == b.lat && a.lon == b.lon && a.speed == b.speed &&
+         a.distanceFromHome == b.distanceFromHome && a.nSats == b.nSats &&
+         seconds >= base + start / 1000000 && seconds <= base + end / 1000000;
+}
+
+// Call one reading; returns whether the call succeeded and sets `correct`
+// if its data matches the reference.
+bool readOnce(NyarkoaPayload &payload, Reading reading, const Snapshot &ref,
+              const Options &options, bool &correct) {
+  uint64_t start = shim::nowMicros();
+  Snapshot data = Snapshot();
+  bool isOk = false;
+  switch (reading) {
+    case READ_MPU:
+      isOk = payload.getMPUData(data.mpu);
+      correct = sameMPU(data.mpu, ref.mpu);
+      break;
+    case READ_MPL:
+      isOk = payload.getMPLData(data.mpl);
+      correct = sameMPL(data.mpl, ref.mpl);
+      break;
+    case READ_GPS:
+      isOk = payload.getGPSData(data.gps);
+      correct = sameGPS(data.gps, ref.gps, options, start,
+                        shim::nowMicros());
+      break;
+    default:
+      isOk = payload.getSnapshot(data);
+      correct = sameMPU(data.mpu, ref.mpu) &&
+                sameMPL(data.mpl, ref.mpl) &&
+                sameGPS(data.gps, ref.gps, options, start,
+                        shim::nowMicros());
+      break;
+  }
+  return isOk;
+}
+
+Result runLink(const char *link, bool faulty, const Options &options) {
+  shim::setMicros(0);
+  randomSeed(options.seed);
+  CommSimConfig config = options.link;
+  config.sensorNoise = false;
+  if (strcmp(link, "legacy") == 0) {
+    config.linkModes = 0;
+  } else if (strcmp(link, "crc") == 0) {
+    config.linkModes = SIM_LINK_CRC;
+  } else {
+    config.linkModes = SIM_LINK_CRC | SIM_LINK_BINARY;
+  }
+  NyarkoaCommSim sim(config);
+  NyarkoaFaultLink faultLink(sim);
+  NyarkoaPayload payload;
+  if (config.linkModes & SIM_LINK_BINARY) payload.enableBinaryLink();
+  payload.activateProdMode();
+
+  Result result = Result();
+  result.link = link;
+  result.faulty = faulty;
+  // Connect and take the reference over the clean link
+  Snapshot ref;
+  if (!payload.connectCommModule(faultLink).isOk ||
+      !payload.getSnapshot(ref)) {
+    fprintf(stderr, "cannot connect on the %s link\n", link);
+    return result;
+  }
+  if (faulty) {
+    FaultLinkConfig faults = options.faults;
+    faults.seed = options.seed;
+    faultLink.setConfig(faults);
+  }
+  faultLink.resetStats();
+
+  std::vector<double> latency;
+  latency.reserve(options.calls);
+  LinkStats before = payload.getLinkStats();
+  uint64_t start = shim::nowMicros();
+  double delivered = 0;
+  for (unsigned long i = 0; i < options.calls; i++) {
+    Reading reading = Reading(i % READING_COUNT);
+    uint64_t callStart = shim::nowMicros();
+    bool correct = false;
+    bool isOk = readOnce(payload, reading, ref, options, correct);
+    latency.push_back((shim::nowMicros() - callStart) / 1000.0);
+    if (!isOk) {
+      result.failed++;
+    } else if (!correct) {
+      result.undetected++;
+    } else {
+      delivered += READING_SIZES[reading];
+    }
+  }
+  double seconds = (shim::nowMicros() - start) / 1e6;
+  const LinkStats &after = payload.getLinkStats();
+
+  result.calls = options.calls;
+  result.goodput = seconds > 0 ? delivered / seconds : 0;
+  result.p50 = percentile(latency, 0.50);
+  result.p99 = percentile(latency, 0.99);
+  result.p999 = percentile(latency, 0.999);
+  result.max = *std::max_element(latency.begin(), latency.end());
+  result.retries = double(after.retries - before.retries) / options.calls;
+  result.injected = faultLink.getStats();
+  return result;
+}
+
+void printResults(const std::vector<Result> &results) {
+  printf("%-7s %-6s %9s %6s %7s %8s %8s %8s %8s %7s %9s\n", "link", "faults",
+         "goodput", "kept", "failed", "p50 ms", "p99 ms", "p99.9 ms",
+         "max ms", "retries", "undet/1k");
+  double clean = 0;
+  for (const Result &result : results) {
+    if (!result.faulty) clean = result.goodput;
+    unsigned long succeeded = result.calls - result.failed;
+    printf("%-7s %-6s %7.0f/s %5.1f%% %6.2f%% %8.1f %8.1f %8.1f %8.1f "
+           "%7.3f %9.2f\n",
+           result.link.c_str(), result.faulty ? "on" : "off", result.goodput,
+           clean > 0 ? result.goodput * 100 / clean : 0,
+           result.calls ? result.failed * 100.0 / result.calls : 0,
+           result.p50, result.p99, result.p999, result.max, result.retries,
+           succeeded ? result.undetected * 1000.0 / succeeded : 0);
+  }
+  printf("\n%-7s %8s %6s %7s %8s %9s %6s\n", "link", "bytes", "lost",
+         "flipped", "repeated", "truncated", "stalls");
+  for (const Result &result : results) {
+    if (!result.faulty) continue;
+    const FaultLinkStats &stats = result.injected;
+    printf("%-7s %8lu %6lu %7lu %8lu %9lu %6lu\n", result.link.c_str(),
+           stats.bytes, stats.lost, stats.flipped, stats.duplicated,
+           stats.truncated, stats.stalls);
+  }
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --calls N        sensor reads per link (default 2000)\n"
+          "  --link NAME      legacy, crc, binary or all (default all)\n"
+          "  --loss PPM       bytes lost, per million (default 500)\n"
+          "  --bit-errors PPM bytes with a bit flipped (default 500)\n"
+          "  --duplicate PPM  bytes delivered twice (default 200)\n"
+          "  --truncate PPM   bytes that cut their line or frame short "
+          "(default 200)\n"
+          "  --stall PPM      bytes followed by a stall (default 100)\n"
+          "  --stall-ms MS    length of a stall (default 50)\n"
+          "  --latency MS     module processing time (default 2)\n"
+          "  --jitter MS      extra random latency, up to (default 1)\n"
+          "  --baud N         UART speed, 0 for unlimited (default 115200)\n"
+          "  --seed N         seed for the faults and jitter (default 1)\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(arg, "--calls") == 0) {
+      options.calls = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--link") == 0) {
+      options.links = value;
+    } else if (strcmp(arg, "--loss") == 0) {
+      options.faults.lossPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--bit-errors") == 0) {
+      options.faults.bitErrorPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--duplicate") == 0) {
+      options.faults.duplicatePpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--truncate") == 0) {
+      options.faults.truncatePpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--stall") == 0) {
+      options.faults.stallPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--stall-ms") == 0) {
+      options.faults.stallMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--latency") == 0) {
+      options.link.latencyMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--jitter") == 0) {
+      options.link.jitterMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--baud") == 0) {
+      options.link.baudRate = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.calls == 0) options.calls = 1;
+  HardwareSerial::mute(true);
+
+  std::vector<Result> results;
+  for (const char *link : LINKS) {
+    if (strcmp(options.links, "all") != 0 && strcmp(options.links, link) != 0)
+      continue;
+    results.push_back(runLink(link, false, options));
+    results.push_back(runLink(link, true, options));
+  }
+  if (results.empty()) {
+    fprintf(stderr, "no link matches\n");
+    return 2;
+  }
+  printResults(results);
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Replay of an emulated balloon flight through the NyarkoaPayload API, in
+// simulated time.
+//
+// The payload connects to the emulated comm module, whose sensors follow a
+// NyarkoaFlight, and reads a snapshot at a fixed rate from the pad until
+// some time after landing. Every reading is printed as a CSV row, as the
+// payload received it, for feeding filters and apogee logic with flight
+// data:
+//
+//   nyarkoa_flight --rate 20 --eject-at 800 > flight.csv
+//
+// The flight, the link and the sensor noise are seeded and time is
+// simulated, so a run is repeatable and a flight of any length takes
+// seconds. A summary of the flight goes to stderr.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaFlight.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaPayload.h>
+#include <ShimClock.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const char *const PHASE_NAMES[] = {"pad", "ascent", "free_fall", "parachute",
+                                   "landed"};
+
+struct Options {
+  float rate{10};
+  float ejectAt{0};      // m above the first reading; 0 waits for the burst
+  float afterLanding{10};
+  unsigned long seed{1};
+  bool noise{true};
+  FlightConfig flight{NyarkoaFlight::defaultConfig()};
+};
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --rate HZ        snapshots per second (default 10)\n"
+          "  --eject-at M     send AT_EJECT this high above the pad "
+          "(default: burst)\n"
+          "  --burst M        balloon burst height (default 1000)\n"
+          "  --ascent M/S     balloon climb rate (default 5)\n"
+          "  --descent M/S    parachute descent rate (default 8)\n"
+          "  --wind M/S       wind speed 10 m above ground (default 4)\n"
+          "  --wind-from DEG  wind direction (default 225)\n"
+          "  --pad S          time on the pad (default 10)\n"
+          "  --after S        time to keep reading after landing "
+          "(default 10)\n"
+          "  --no-noise       readings without sensor noise\n"
+          "  --seed N         seed for sensor noise and jitter (default 1)\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--no-noise") == 0) {
+      options.noise = false;
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(arg, "--rate") == 0) {
+      options.rate = atof(value);
+    } else if (strcmp(arg, "--eject-at") == 0) {
+      options.ejectAt = atof(value);
+    } else if (strcmp(arg, "--burst") == 0) {
+      options.flight.burstAltitude = atof(value);
+    } else if (strcmp(arg, "--ascent") == 0) {
+      options.flight.ascentRate = atof(value);
+    } else if (strcmp(arg, "--descent") == 0) {
+      options.flight.descentRate = atof(value);
+    } else if (strcmp(arg, "--wind") == 0) {
+      options.flight.windSpeed = atof(value);
+    } else if (strcmp(arg, "--wind-from") == 0) {
+      options.flight.windFrom = atof(value);
+    } else if (strcmp(arg, "--pad") == 0) {
+      options.flight.padSeconds = atof(value);
+    } else if (strcmp(arg, "--after") == 0) {
+      options.afterLanding = atof(value);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.rate <= 0 || options.flight.ascentRate <= 0 ||
+      options.flight.descentRate <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  HardwareSerial::mute(true);
+
+  shim::setMicros(0);
+  randomSeed(options.seed);
+  CommSimConfig config = NyarkoaCommSim::defaultConfig();
+  config.sensorNoise = options.noise;
+  NyarkoaCommSim module(config);
+  NyarkoaFlight flight(options.flight);
+  module.setFlight(&flight);
+  NyarkoaPayload payload;
+  payload.enableBinaryLink();
+  payload.activateProdMode();
+  if (!payload.connectCommModule(module).isOk) {
+    fprintf(stderr, "cannot connect to the emulated module\n");
+    return 1;
+  }
+
+  printf("t_s,phase,accel_x,accel_y,accel_z,gyro_x,gyro_y,gyro_z,temp,"
+         "pressure,altitude,lat,lon,speed,distance\n");
+  unsigned long period = (unsigned long)(1e6 / options.rate + 0.5);
+  uint64_t next = shim::nowMicros();
+  float padAltitude = 0, apogee = 0, apogeeAt = 0, peakAccel = 0;
+  float landedAt = -1;
+  unsigned long failed = 0;
+  bool ejected = false;
+  for (unsigned long row = 0;; row++) {
+    Snapshot s;
+    bool isOk = payload.getSnapshot(s);
+    const FlightState &state = flight.getState();
+    if (!isOk) {
+      failed++;
+    } else {
+      if (row == 0) padAltitude = s.mpl.altitude;
+      float height = s.mpl.altitude - padAltitude;
+      if (height > apogee) {
+        apogee = height;
+        apogeeAt = state.seconds;
+      }
+      float accel = sqrt(s.mpu.accelX * s.mpu.accelX +
+                         s.mpu.accelY * s.mpu.accelY +
+                         s.mpu.accelZ * s.mpu.accelZ);
+      if (accel > peakAccel) peakAccel = accel;
+      char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+      formatGPSCoordinate(s.gps.lat, lat, sizeof(lat));
+      formatGPSCoordinate(s.gps.lon, lon, sizeof(lon));
+      printf("%.3f,%s,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%s,%s,%u,"
+             "%u\n",
+             state.seconds, PHASE_NAMES[state.phase], s.mpu.accelX,
+             s.mpu.accelY, s.mpu.accelZ, s.mpu.gyroX, s.mpu.gyroY,
+             s.mpu.gyroZ, s.mpu.temp, s.mpl.pressure, s.mpl.altitude, lat,
+             lon, s.gps.speed, s.gps.distanceFromHome);
+      if (options.ejectAt > 0 && !ejected && height >= options.ejectAt) {
+        payload.ejectBalloon();
+        ejected = true;
+      }
+    }
+    if (state.phase == FLIGHT_LANDED && landedAt < 0) landedAt = state.seconds;
+    if (landedAt >= 0 && state.seconds >= landedAt + options.afterLanding) {
+      break;
+    }
+    next += period;
+    uint64_t now = shim::nowMicros();
+    if (next > now) shim::advanceMicros(next - now);
+  }
+
+  const FlightState &end = flight.getState();
+  fprintf(stderr,
+          "apogee %.1f m at %.1f s%s, landed at %.1f s, %.0f m from the "
+          "site, peak acceleration %.1f m/s^2, %lu failed reads\n",
+          apogee, apogeeAt, ejected ? " (ejected)" : " (burst)", landedAt,
+          sqrt(end.east * end.east + end.north * end.north), peakAccel,
+          failed);
+  return 0;
+}
@@ -0,0 +1,533 @@
+// Monte Carlo missions of NyarkoaPayload, many at once, in simulated time.
+//
+// Each mission pairs a payload with its own emulated comm module, flight
+// and faulty link: the balloon's climb, burst height, descent and wind, the
+// module's latency and the link's loss, bit errors, repeats, truncations
+// and stalls are drawn at random for every mission. The payload reads a
+// snapshot at a fixed rate from the pad until after landing, and ejects
+// once its readings put it a set height above the pad, sending AT_EJECT
+// again on each reading until it sees the altitude fall. For every setting
+// of the payload the harness reports the distribution over the missions of:
+//
+//   - telemetry rate: snapshots delivered per second of flight;
+//   - data loss: the share of snapshots that failed after all attempts;
+//   - ejection latency: from the moment the CanSat truly crossed the
+//     ejection height to its release, in flight time. Sensor noise can
+//     release it a little early; missions released more than a second
+//     early, by a damaged reading the link checks let through, and those
+//     whose balloon burst first are counted apart;
+//   - fallbacks: missions whose link negotiation was damaged, so that they
+//     flew on a weaker protocol than the one asked for.
+//
+// The payload settings are swept with comma-separated lists, e.g.
+//
+//   nyarkoa_montecarlo --rate 5,10,20 --attempts 2,4,6 --missions 500
+//
+// and every setting flies the same missions, so the settings are compared
+// on equal terms. Missions are independent: the shim's clock and random
+// numbers are per thread, and each mission is seeded from --seed and its
+// number, so the results do not depend on the number of threads. A
+// work-stealing scheduler spreads the missions over the threads; each thread
+// works through its own share from one end and, once idle, takes missions
+// from the other end of a busy thread's share.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaFaultLink.h>
+#include <NyarkoaFlight.h>
+#include <NyarkoaPayload.h>
+#include <ShimClock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint32_t POLL_TICK{4};     // the shim's default, see ShimClock.h
+const float MAX_FLIGHT{7200};    // s; a mission ends here at the latest
+const float AFTER_LANDING{5};    // s of readings after touchdown
+const float FALL_MARGIN{5};      // m below the highest reading: released
+const float EARLY_MILLIS{1000};  // ms before the crossing: a false reading
+const byte CONNECT_TRIES{3};
+
+// The payload settings swept.
+struct Setting {
+  float rate;  // snapshots per second
+  RetryPolicy retry;
+};
+
+// What is drawn for one mission.
+struct Profile {
+  unsigned long seed;
+  FlightConfig flight;
+  FaultLinkConfig faults;
+  unsigned long latencyMicros;
+};
+
+enum Outcome : byte { EJECTED, EJECTED_EARLY, BURST_FIRST, NOT_CONNECTED };
+
+enum Link : byte { LINK_LEGACY, LINK_CRC, LINK_BINARY };
+
+struct Mission {
+  Outcome outcome;
+  Link link;            // the protocol negotiated
+  float telemetryRate;  // Hz
+  float dataLoss;       // share of snapshots
+  float ejectLatency;   // ms, EJECTED and EJECTED_EARLY only
+  float retries;        // per call
+};
+
+struct Options {
+  unsigned long missions{200};
+  unsigned threads{0};
+  unsigned long seed{1};
+  byte linkModes{SIM_LINK_CRC | SIM_LINK_BINARY};
+  Link link{LINK_BINARY};
+  float ejectAt{800};
+  std::vector<float> rates{10};
+  std::vector<float> attempts{4};
+  std::vector<float> minTimeouts{40};
+  uint32_t maxLossPpm{2000};
+  uint32_t maxBitErrorPpm{2000};
+  uint32_t maxStallPpm{200};
+  unsigned long stallMicros{50000};
+  float maxWind{10};
+  const char *csv{nullptr};
+};
+
+// Runs tasks 0..count-1 on a number of threads. Each thread owns a deque
+// holding a contiguous share of the tasks; it takes its next task from the
+// back, and when its deque is empty it steals from the front of the others,
+// where the tasks furthest from their owner's attention are.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(unsigned threads) {
+    for (unsigned i = 0; i < threads; i++) {
+      workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+  }
+
+  template <typename Task>
+  void run(size_t count, Task task) {
+    size_t share = (count + workers.size() - 1) / workers.size();
+    for (size_t i = 0; i < count; i++) {
+      workers[i / share]->tasks.push_front(i);
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers.size(); i++) {
+      threads.push_back(std::thread([this, i, &task] {
+        size_t index;
+        while (take(i, index)) task(index);
+      }));
+    }
+    for (std::thread &thread : threads) thread.join();
+  }
+
+  unsigned long getSteals() const { return steals; }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<unsigned long> steals{0};
+
+  // Tasks never add tasks, so a thread that finds every deque empty is done.
+  bool take(size_t self, size_t &index) {
+    {
+      Worker &own = *workers[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        index = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (size_t i = 1; i < workers.size(); i++) {
+      Worker &victim = *workers[(self + i) % workers.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        index = victim.tasks.front();
+        victim.tasks.pop_front();
+        steals++;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// SplitMix64, to give each mission an independent seed.
+uint64_t mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+Profile drawProfile(unsigned long index, const Options &options) {
+  std::mt19937_64 rng(mix(options.seed * 1000003ULL + index));
+  std::uniform_real_distribution<float> unit(0, 1);
+  Profile profile;
+  profile.seed = (unsigned long)(rng() & 0x7FFFFFFF);
+  profile.flight = NyarkoaFlight::defaultConfig();
+  profile.flight.ascentRate *= 0.8f + 0.4f * unit(rng);
+  profile.flight.burstAltitude *= 0.85f + 0.45f * unit(rng);
+  profile.flight.descentRate *= 0.8f + 0.4f * unit(rng);
+  profile.flight.windSpeed = options.maxWind * unit(rng);
+  profile.flight.windFrom = 360 * unit(rng);
+  profile.faults.seed = uint32_t(rng());
+  profile.faults.lossPpm = uint32_t(options.maxLossPpm * unit(rng));
+  profile.faults.bitErrorPpm = uint32_t(options.maxBitErrorPpm * unit(rng));
+  profile.faults.duplicatePpm = uint32_t(options.maxLossPpm / 4 * unit(rng));
+  profile.faults.truncatePpm =
+      uint32_t(options.maxBitErrorPpm / 4 * unit(rng));
+  profile.faults.stallPpm = uint32_t(options.maxStallPpm * unit(rng));
+  profile.faults.stallMicros = options.stallMicros;
+  profile.latencyMicros = 1000 + (unsigned long)(3000 * unit(rng));
+  return profile;
+}
+
+// Flight time at which the CanSat first reaches `height`, or -1 if the
+// balloon bursts below it.
+float crossingTime(const FlightConfig &config, float height) {
+  shim::setPollTick(0);  // keep the model's clock still while stepping
+  NyarkoaFlight flight(config);
+  float step = 1.0f / flight.getConfig().sampleRate;
+  const FlightState &state = flight.getState();
+  while (state.phase <= FLIGHT_ASCENT && state.altitude < height &&
+         state.seconds < MAX_FLIGHT) {
+    flight.fastForward(step);
+  }
+  shim::setPollTick(POLL_TICK);
+  return state.phase <= FLIGHT_ASCENT && state.altitude >= height
+             ? state.seconds
+             : -1;
+}
+
+Mission fly(const Profile &profile, const Setting &setting,
+            const Options &options) {
+  Mission mission = Mission();
+  shim::setMicros(0);
+  randomSeed(profile.seed);
+  float crossAt = crossingTime(profile.flight, options.ejectAt);
+
+  CommSimConfig config = NyarkoaCommSim::defaultConfig();
+  config.linkModes = options.linkModes;
+  config.latencyMicros = profile.latencyMicros;
+  NyarkoaCommSim module(config);
+  NyarkoaFlight flight(profile.flight);
+  module.setFlight(&flight);
+  NyarkoaFaultLink link(module, profile.faults);
+  NyarkoaPayload payload;
+  if (options.link == LINK_BINARY) payload.enableBinaryLink();
+  payload.activateProdMode();
+  payload.setRetryPolicy(setting.retry);
+  bool isConnected = false;
+  for (byte i = 0; i < CONNECT_TRIES && !isConnected; i++) {
+    isConnected = payload.connectCommModule(link).isOk;
+  }
+  if (!isConnected) {
+    mission.outcome = NOT_CONNECTED;
+    return mission;
+  }
+  mission.link = payload.isBinaryLink() ? LINK_BINARY
+                 : payload.isCrcLink()  ? LINK_CRC
+                                        : LINK_LEGACY;
+
+  unsigned long period = (unsigned long)(1e6 / setting.rate + 0.5);
+  uint64_t next = shim::nowMicros();
+  float startAt = flight.now().seconds;
+  float padAltitude = 0, highest = 0, releasedAt = -1;
+  float landedAt = -1;
+  unsigned long reads = 0, delivered = 0;
+  bool hasPad = false, isEjecting = false, isBurst = false;
+  for (;;) {
+    Snapshot s;
+    reads++;
+    if (payload.getSnapshot(s)) {
+      delivered++;
+      if (!hasPad) {
+        padAltitude = s.mpl.altitude;
+        hasPad = true;
+      }
+      float height = s.mpl.altitude - padAltitude;
+      if (height > highest) highest = height;
+      if (height >= options.ejectAt) isEjecting = true;
+      if (height < highest - FALL_MARGIN) isEjecting = false;
+      if (isEjecting && releasedAt < 0 && !isBurst) payload.ejectBalloon();
+    }
+    const FlightState &state = flight.now();
+    if (releasedAt < 0 && !isBurst && state.phase >= FLIGHT_FREE_FALL) {
+      // The balloon bursts at its burst height; AT_EJECT releases below it
+      if (state.altitude < profile.flight.burstAltitude) {
+        releasedAt = flight.getPhaseStart();
+      } else {
+        isBurst = true;
+      }
+    }
+    if (state.phase == FLIGHT_LANDED && landedAt < 0) landedAt = state.seconds;
+    if (landedAt >= 0 && state.seconds >= landedAt + AFTER_LANDING) break;
+    if (state.seconds >= MAX_FLIGHT) break;
+    next += period;
+    uint64_t now = shim::nowMicros();
+    if (next > now) shim::advanceMicros(next - now);
+  }
+
+  float seconds = flight.getState().seconds - startAt;
+  mission.telemetryRate = seconds > 0 ? delivered / seconds : 0;
+  mission.dataLoss = float(reads - delivered) / reads;
+  const LinkStats &stats = payload.getLinkStats();
+  mission.retries = stats.requests ? float(stats.retries) / stats.requests : 0;
+  if (releasedAt >= 0 && crossAt >= 0) {
+    mission.ejectLatency = (releasedAt - crossAt) * 1000;
+    mission.outcome =
+        mission.ejectLatency < -EARLY_MILLIS ? EJECTED_EARLY : EJECTED;
+  } else {
+    mission.outcome = BURST_FIRST;
+  }
+  return mission;
+}
+
+float percentile(std::vector<float> values, double fraction) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t rank = size_t(fraction * values.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  return values[rank - 1];
+}
+
+float average(const std::vector<float> &values) {
+  double sum = 0;
+  for (float value : values) sum += value;
+  return values.empty() ? 0 : sum / values.size();
+}
+
+void printSummary(const std::vector<Setting> &settings,
+                  const std::vector<Mission> &missions,
+                  const Options &options) {
+  printf("%5s %3s %5s | %-20s | %-20s | %-20s | %5s %5s %5s %5s %7s\n",
+         "rate", "att", "rto", "telemetry Hz p5/50/95", "loss % p50/95/max",
+         "eject ms p50/95/max", "early", "burst", "fallb", "lost",
+         "retries");
+  for (size_t i = 0; i < settings.size(); i++) {
+    std::vector<float> rate, loss, latency, retries;
+    unsigned long fallback = 0, early = 0, burst = 0, lost = 0;
+    for (unsigned long m = 0; m < options.missions; m++) {
+      const Mission &mission = missions[i * options.missions + m];
+      if (mission.outcome == NOT_CONNECTED) {
+        lost++;
+        continue;
+      }
+      if (mission.link < options.link) fallback++;
+      rate.push_back(mission.telemetryRate);
+      loss.push_back(mission.dataLoss * 100);
+      retries.push_back(mission.retries);
+      if (mission.outcome == EJECTED) {
+        latency.push_back(mission.ejectLatency);
+      } else if (mission.outcome == EJECTED_EARLY) {
+        early++;
+      } else {
+        burst++;
+      }
+    }
+    const Setting &setting = settings[i];
+    printf("%5g %3u %5lu | %6.2f %6.2f %6.2f | %6.2f %6.2f %6.2f | "
+           "%6.0f %6.0f %6.0f | %5lu %5lu %5lu %5lu %7.3f\n",
+           setting.rate, setting.retry.attempts, setting.retry.minTimeout,
+           percentile(rate, 0.05), percentile(rate, 0.50),
+           percentile(rate, 0.95), percentile(loss, 0.50),
+           percentile(loss, 0.95), percentile(loss, 1.0),
+           percentile(latency, 0.50), percentile(latency, 0.95),
+           percentile(latency, 1.0), early, burst, fallback, lost,
+           average(retries));
+  }
+}
+
+bool writeCsv(const char *path, const std::vector<Setting> &settings,
+              const std::vector<Mission> &missions, const Options &options) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) return false;
+  const char *const OUTCOMES[] = {"ejected", "ejected_early", "burst",
+                                  "not_connected"};
+  const char *const LINKS[] = {"legacy", "crc", "binary"};
+  fprintf(file,
+          "rate,attempts,min_timeout,mission,ascent,burst,descent,wind,"
+          "loss_ppm,bit_error_ppm,stall_ppm,latency_ms,link,outcome,"
+          "telemetry_hz,data_loss,eject_ms,retries\n");
+  for (size_t i = 0; i < settings.size(); i++) {
+    for (unsigned long m = 0; m < options.missions; m++) {
+      const Setting &setting = settings[i];
+      const Mission &mission = missions[i * options.missions + m];
+      Profile profile = drawProfile(m, options);
+      fprintf(file,
+              "%g,%u,%lu,%lu,%.2f,%.0f,%.2f,%.2f,%u,%u,%u,%.2f,%s,%s,%.3f,"
+              "%.5f,%.0f,%.4f\n",
+              setting.rate, setting.retry.attempts, setting.retry.minTimeout,
+              m, profile.flight.ascentRate, profile.flight.burstAltitude,
+              profile.flight.descentRate, profile.flight.windSpeed,
+              profile.faults.lossPpm, profile.faults.bitErrorPpm,
+              profile.faults.stallPpm, profile.latencyMicros / 1000.0,
+              LINKS[mission.link], OUTCOMES[mission.outcome],
+              mission.telemetryRate, mission.dataLoss, mission.ejectLatency,
+              mission.retries);
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+bool parseList(const char *text, std::vector<float> &values) {
+  values.clear();
+  while (*text) {
+    char *end;
+    float value = strtof(text, &end);
+    if (end == text || value <= 0) return false;
+    values.push_back(value);
+    text = *end == ',' ? end + 1 : end;
+    if (*end != ',' && *end != '\0') return false;
+  }
+  return !values.empty();
+}
+
+double wallSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --missions N        missions per setting (default 200)\n"
+          "  --threads N         threads (default: one per core)\n"
+          "  --rate HZ,...       snapshots per second (default 10)\n"
+          "  --attempts N,...    attempts per command (default 4)\n"
+          "  --min-timeout MS,...  shortest retransmission timeout "
+          "(default 40)\n"
+          "  --eject-at M        ejection height above the pad "
+          "(default 800)\n"
+          "  --link NAME         legacy, crc or binary (default binary)\n"
+          "  --max-loss PPM      bytes lost, up to (default 2000)\n"
+          "  --max-bit-errors PPM  bytes with a bit flipped, up to "
+          "(default 2000)\n"
+          "  --max-stall PPM     bytes followed by a stall, up to "
+          "(default 200)\n"
+          "  --stall-ms MS       length of a stall (default 50)\n"
+          "  --max-wind M/S      wind speed, up to (default 10)\n"
+          "  --seed N            seed for the missions (default 1)\n"
+          "  --csv FILE          write every mission as a CSV row\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    bool isOk = true;
+    if (strcmp(arg, "--missions") == 0) {
+      options.missions = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--threads") == 0) {
+      options.threads = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--rate") == 0) {
+      isOk = parseList(value, options.rates);
+    } else if (strcmp(arg, "--attempts") == 0) {
+      isOk = parseList(value, options.attempts);
+    } else if (strcmp(arg, "--min-timeout") == 0) {
+      isOk = parseList(value, options.minTimeouts);
+    } else if (strcmp(arg, "--eject-at") == 0) {
+      options.ejectAt = atof(value);
+    } else if (strcmp(arg, "--link") == 0) {
+      if (strcmp(value, "legacy") == 0) {
+        options.link = LINK_LEGACY;
+        options.linkModes = 0;
+      } else if (strcmp(value, "crc") == 0) {
+        options.link = LINK_CRC;
+        options.linkModes = SIM_LINK_CRC;
+      } else {
+        isOk = strcmp(value, "binary") == 0;
+      }
+    } else if (strcmp(arg, "--max-loss") == 0) {
+      options.maxLossPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--max-bit-errors") == 0) {
+      options.maxBitErrorPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--max-stall") == 0) {
+      options.maxStallPpm = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--stall-ms") == 0) {
+      options.stallMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--max-wind") == 0) {
+      options.maxWind = atof(value);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--csv") == 0) {
+      options.csv = value;
+    } else {
+      isOk = false;
+    }
+    if (!isOk) {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.missions == 0) options.missions = 1;
+  if (options.threads == 0) {
+    options.threads = std::thread::hardware_concurrency();
+  }
+  if (options.threads == 0) options.threads = 1;
+
+  std::vector<Setting> settings;
+  for (float rate : options.rates) {
+    for (float attempts : options.attempts) {
+      for (float minTimeout : options.minTimeouts) {
+        Setting setting;
+        setting.rate = rate;
+        setting.retry = NyarkoaPayload::defaultRetryPolicy();
+        setting.retry.attempts = byte(attempts);
+        setting.retry.minTimeout = (unsigned long)minTimeout;
+        settings.push_back(setting);
+      }
+    }
+  }
+
+  size_t count = settings.size() * options.missions;
+  std::vector<Mission> missions(count);
+  WorkStealingPool pool(options.threads);
+  double start = wallSeconds();
+  pool.run(count, [&](size_t index) {
+    HardwareSerial::mute(true);
+    const Setting &setting = settings[index / options.missions];
+    Profile profile = drawProfile(index % options.missions, options);
+    missions[index] = fly(profile, setting, options);
+  });
+  double elapsed = wallSeconds() - start;
+
+  printSummary(settings, missions, options);
+  printf("\n%zu missions on %u threads in %.1f s (%.1f missions/s, %lu "
+         "stolen)\n",
+         count, options.threads, elapsed, count / elapsed, pool.getSteals());
+  if (options.csv != nullptr &&
+      !writeCsv(options.csv, settings, missions, options)) {
+    fprintf(stderr, "cannot write %s\n", options.csv);
+    return 1;
+  }
+  return 0;
+}
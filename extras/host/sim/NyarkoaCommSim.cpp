@@ -0,0 +1,851 @@
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <math.h>
+#include <stdio.h>
+
+// Where the emulated module sits: a launch pad in Accra, 500 m above sea
+// level.
+const int32_t SITE_LAT{56037160};
+const int32_t SITE_LON{-1869640};
+const float SITE_ALTITUDE{500.0};
+const float SITE_TEMPERATURE{25.0};
+const float LAPSE_RATE{0.0065};          // degrees C cooler per metre up
+const float METRES_PER_DEGREE{111320};  // along a meridian
+const FlightState RESTING{NyarkoaFlight::restingState()};
+
+// Collects an encoded frame so that its length is known before it is queued.
+class FrameBuffer : public Print {
+ public:
+  byte data[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE];
+  uint16_t length{0};
+  size_t write(uint8_t value) override {
+    if (length >= sizeof(data)) return 0;
+    data[length++] = value;
+    return 1;
+  }
+  using Print::write;
+};
+
+// Append a value with two decimals, e.g. "-0.05".
+static size_t formatFixed(float value, char *text, size_t size) {
+  long scaled = lround(value * 100);
+  unsigned long magnitude = scaled < 0 ? -scaled : scaled;
+  return snprintf(text, size, "%s%lu.%02lu", scaled < 0 ? "-" : "",
+                  magnitude / 100, magnitude % 100);
+}
+
+static size_t formatValues(const float *values, byte count, char *text,
+                           size_t size) {
+  size_t length = 0;
+  for (byte i = 0; i < count && length < size; i++) {
+    if (i) text[length++] = ',';
+    length += formatFixed(values[i], text + length, size - length);
+  }
+  return length;
+}
+
+static size_t formatGPS(const GPSData &gps, char *text, size_t size) {
+  char lat[GPS_COORD_TEXT_SIZE], lon[GPS_COORD_TEXT_SIZE];
+  char date[GPS_DATE_TEXT_SIZE], time[GPS_TIME_TEXT_SIZE];
+  formatGPSCoordinate(gps.lat, lat, sizeof(lat));
+  formatGPSCoordinate(gps.lon, lon, sizeof(lon));
+  formatGPSDate(gps.dateTime, date, sizeof(date));
+  formatGPSTime(gps.dateTime, time, sizeof(time));
+  return snprintf(text, size, "%u,%s,%s,%s,%s,%u,%u", gps.nSats, lat, lon,
+                  date, time, gps.speed, gps.distanceFromHome);
+}
+
+NyarkoaCommSim::NyarkoaCommSim() : NyarkoaCommSim(defaultConfig()) {}
+
+NyarkoaCommSim::NyarkoaCommSim(const CommSimConfig &config) : config(config) {
+  reset();
+}
+
+/**
+ * Get the settings of a typical module.
+ *
+ * @return A module 2 ms from the payload over a 115200 baud UART, with up to
+ * 1 ms of jitter and no lost or damaged replies, that accepts both CRC lines
+ * and binary frames. Its clock starts at 2023-10-25 12:34:56 UTC and its
+ * sensors are noisy.
+ */
+CommSimConfig NyarkoaCommSim::defaultConfig() {
+  return {.latencyMicros = 2000,
+          .jitterMicros = 1000,
+          .baudRate = 115200,
+          .linkModes = SIM_LINK_CRC | SIM_LINK_BINARY,
+          .startTime = packGPSDateTime(2023, 10, 25, 12, 34, 56),
+          .clockDriftPpm = 0,
+          .dropPercent = 0,
+          .corruptPercent = 0,
+          .sensorNoise = true};
+}
+
+/**
+ * Power-cycle the emulated module.
+ *
+ * Pending replies are discarded, the link returns to the legacy protocol,
+ * subscriptions end, the statistics are cleared and the module clock
+ * restarts at the configured start time.
+ */
+void NyarkoaCommSim::reset() {
+  memset(&stats, 0, sizeof(stats));
+  mode = MODE_LEGACY;
+  lineLength = 0;
+  lineOverflow = false;
+  parser.reset();
+  lastSeq = 0;
+  lastCmd = CMD_NONE;
+  clockStart = millis();
+  outHead = outCount = outReadable = 0;
+  replyHead = replyCount = 0;
+  linkFreeAt = micros();
+  endSubscriptions();
+}
+
+/**
+ * Change the module's timing or protocols.
+ *
+ * @param newConfig The new settings. They apply to replies queued from now
+ * on; a changed start time restarts the module clock.
+ */
+void NyarkoaCommSim::setConfig(const CommSimConfig &newConfig) {
+  if (newConfig.startTime != config.startTime) clockStart = millis();
+  config = newConfig;
+}
+
+/**
+ * Print every line and frame the module receives.
+ *
+ * @param output Where to print them, e.g. `Serial`, or nullptr to stop.
+ */
+void NyarkoaCommSim::setLog(Print *output) { log = output; }
+
+/**
+ * Take the sensor readings from a flight instead of the launch pad.
+ *
+ * @param newFlight The flight to follow, or nullptr to rest on the pad.
+ * AT_EJECT releases it from its balloon.
+ */
+void NyarkoaCommSim::setFlight(NyarkoaFlight *newFlight) {
+  flight = newFlight;
+}
+
+/**
+ * Get the number of reply bytes that have reached the payload.
+ *
+ * @return The number of bytes that can be read now.
+ */
+int NyarkoaCommSim::available() {
+  pushDue();
+  release();
+  return outReadable;
+}
+
+/**
+ * Read one reply byte.
+ *
+ * @return The byte, or -1 if none has arrived yet.
+ */
+int NyarkoaCommSim::read() {
+  if (available() == 0) return -1;
+  byte data = out[outHead];
+  outHead = (outHead + 1) % OUT_SIZE;
+  outCount--;
+  outReadable--;
+  stats.bytesOut++;
+  return data;
+}
+
+/**
+ * Look at the next reply byte without consuming it.
+ *
+ * @return The byte, or -1 if none has arrived yet.
+ */
+int NyarkoaCommSim::peek() {
+  if (available() == 0) return -1;
+  return out[outHead];
+}
+
+/**
+ * Receive one byte from the payload.
+ *
+ * @param data The byte.
+ * @return 1, as the byte is always accepted.
+ *
+ * Text lines are collected in every mode so that "AT?" always reaches the
+ * module; on a binary link the bytes are also fed to the frame decoder, and
+ * any byte that cannot be part of a text line starts the line over.
+ */
+size_t NyarkoaCommSim::write(uint8_t data) {
+  stats.bytesIn++;
+  if (mode == MODE_BINARY) {
+    FrameStatus status = parser.feed(data);
+    if (status == FRAME_CORRUPT) {
+      stats.badChecks++;
+      logLine(F("BAD FRAME"), "");
+    } else if (status == FRAME_COMPLETE) {
+      receiveFrame(parser.frame());
+    }
+    if (status != FRAME_INCOMPLETE || (!isprint(data) && data != '\r' &&
+                                       data != '\n')) {
+      lineLength = 0;
+      return 1;
+    }
+  }
+
+  if (data == '\n') {
+    byte requestLength = lineLength + 1;
+    while (lineLength > 0 && line[lineLength - 1] == '\r') lineLength--;
+    line[lineLength] = '\0';
+    if (!lineOverflow && lineLength > 0) receiveLine(requestLength);
+    lineLength = 0;
+    lineOverflow = false;
+  } else if (lineLength < LINE_SIZE - 1) {
+    line[lineLength++] = data;
+  } else {
+    lineOverflow = true;
+  }
+  return 1;
+}
+
+/**
+ * Get the time the UART takes to carry one byte.
+ *
+ * @return The time in microseconds for a start bit, 8 data bits and a stop
+ * bit, or 0 if the baud rate is unlimited.
+ */
+unsigned long NyarkoaCommSim::byteMicros() const {
+  return config.baudRate ? 10000000UL / config.baudRate : 0;
+}
+
+/**
+ * Make reply bytes readable once the UART has carried them.
+ */
+void NyarkoaCommSim::release() {
+  unsigned long now = micros();
+  unsigned long perByte = byteMicros();
+  while (replyCount > 0) {
+    Reply &reply = replies[replyHead];
+    if (long(now - reply.start) < 0) break;
+    unsigned long arrived =
+        perByte ? (now - reply.start) / perByte : reply.length;
+    uint16_t released = arrived < reply.length ? arrived : reply.length;
+    outReadable += released - reply.released;
+    reply.released = released;
+    if (released < reply.length) break;
+    replyHead = (replyHead + 1) % MAX_REPLIES;
+    replyCount--;
+  }
+}
+
+/**
+ * Queue a reply for the payload.
+ *
+ * @param requestLength The length of the request being answered in bytes,
+ * which the UART must carry before the module can start processing it.
+ * @param data The reply bytes.
+ * @param length The number of reply bytes.
+ *
+ * The reply starts after the request has arrived and been processed, but
+ * not before the previous reply has left the UART. A reply that does not fit
+ * in the output buffer is lost, as it would be on a module whose transmit
+ * buffer overflows.
+ */
+void NyarkoaCommSim::queueReply(byte requestLength, const byte *data,
+                                uint16_t length) {
+  unsigned long start = micros() + requestLength * byteMicros() +
+                        config.latencyMicros +
+                        (config.jitterMicros ? random(config.jitterMicros + 1)
+                                             : 0);
+  queueAt(start, data, length);
+}
+
+/**
+ * Queue bytes for the payload from a given time on.
+ *
+ * @param start The micros() at which the module starts sending; the bytes
+ * wait for the previous reply to leave the UART if it has not yet.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ *
+ * The configured share of replies is dropped, or damaged by flipping one bit
+ * of a byte before the line ending, on the way.
+ */
+void NyarkoaCommSim::queueAt(unsigned long start, const byte *data,
+                             uint16_t length) {
+  if (replyCount >= MAX_REPLIES || outCount + length > OUT_SIZE) {
+    logLine(F("TX OVERFLOW"), "");
+    return;
+  }
+  if (config.dropPercent && random(100) < config.dropPercent) {
+    stats.dropped++;
+    logLine(F("FAULT: "), "reply dropped");
+    return;
+  }
+  uint16_t damaged = length;  // none
+  if (config.corruptPercent && random(100) < config.corruptPercent) {
+    uint16_t body = length;
+    while (body > 1 && (data[body - 1] == '\r' || data[body - 1] == '\n')) {
+      body--;
+    }
+    damaged = random(body);
+    stats.corrupted++;
+    logLine(F("FAULT: "), "reply corrupted");
+  }
+  unsigned long perByte = byteMicros();
+  if (long(start - linkFreeAt) < 0) start = linkFreeAt;
+  linkFreeAt = start + length * perByte;
+
+  Reply &reply = replies[(replyHead + replyCount) % MAX_REPLIES];
+  reply.start = start;
+  reply.length = length;
+  reply.released = 0;
+  replyCount++;
+  for (uint16_t i = 0; i < length; i++) {
+    byte value = data[i];
+    if (i == damaged) value ^= byte(1 << random(8));
+    out[(outHead + outCount) % OUT_SIZE] = value;
+    outCount++;
+  }
+}
+
+/**
+ * Queue a text reply followed by CR LF.
+ *
+ * @param requestLength The length of the request being answered in bytes.
+ * @param text The reply line.
+ */
+void NyarkoaCommSim::queueLine(byte requestLength, const char *text) {
+  char reply[LINE_SIZE + NYARKOA_RESULT_SIZE + 8];
+  size_t length = snprintf(reply, sizeof(reply), "%s\r\n", text);
+  if (length >= sizeof(reply)) length = sizeof(reply) - 1;
+  queueReply(requestLength, reinterpret_cast<const byte *>(reply), length);
+}
+
+/**
+ * Handle a complete text line from the payload.
+ *
+ * @param requestLength The length of the line in bytes, with its newline.
+ */
+void NyarkoaCommSim::receiveLine(byte requestLength) {
+  if (strcmp(line, "AT?") == 0) {
+    logLine(F("RCVD: "), line);
+    mode = MODE_LEGACY;
+    parser.reset();
+    endSubscriptions();
+    stats.commands++;
+    queueLine(requestLength, "OK");
+    return;
+  }
+  if (mode == MODE_BINARY) return;
+  logLine(F("RCVD: "), line);
+  if (mode == MODE_CRC) {
+    answerChecked(line, requestLength);
+  } else {
+    answerLegacy(line, requestLength);
+  }
+}
+
+/**
+ * Answer a legacy text line.
+ *
+ * @param text The line: a command, or "REQ:" followed by a request.
+ * @param requestLength The length of the line in bytes.
+ *
+ * Commands are answered with the simpleHash of the command, requests with
+ * the simpleHash of the request, ':' and the payload. Unknown commands are
+ * answered with "ERR", which fails the payload's hash check.
+ */
+void NyarkoaCommSim::answerLegacy(char *text, byte requestLength) {
+  bool isRequest = strncmp(text, "REQ:", 4) == 0;
+  const char *cmd = isRequest ? text + 4 : text;
+  if (isRequest && offerLink(cmd, requestLength)) return;
+
+  Frame request;
+  char reply[LINE_SIZE + NYARKOA_RESULT_SIZE];
+  // pushed readings need a protocol that tells them apart from replies
+  if (!encodeCommand(cmd, request) || request.cmd == CMD_SUB) {
+    stats.unknown++;
+    queueLine(requestLength, "ERR");
+    return;
+  }
+  perform(request);
+  hash(cmd, reply, sizeof(reply));
+  if (isRequest) {
+    size_t length = strlen(reply);
+    reply[length++] = ':';
+    respondText(request, reply + length, sizeof(reply) - length);
+  }
+  queueLine(requestLength, reply);
+}
+
+/**
+ * Answer a CRC text line.
+ *
+ * @param text The line, ending in '*' and the CRC-16 of what precedes it.
+ * @param requestLength The length of the line in bytes.
+ *
+ * The reply echoes the CRC-16 of the command instead of its simpleHash and
+ * ends in its own CRC. Lines that fail their CRC are dropped unanswered;
+ * unknown commands are answered with "ERR", which the payload ignores.
+ */
+void NyarkoaCommSim::answerChecked(char *text, byte requestLength) {
+  char *mark = strrchr(text, '*');
+  uint16_t crc;
+  if (mark == nullptr || !hexToCrc16(mark + 1, crc) ||
+      crc != crc16(text, mark - text)) {
+    stats.badChecks++;
+    logLine(F("BAD CRC: "), text);
+    return;
+  }
+  *mark = '\0';
+
+  bool isRequest = strncmp(text, "REQ:", 4) == 0;
+  const char *cmd = isRequest ? text + 4 : text;
+  Frame request;
+  char reply[LINE_SIZE + NYARKOA_RESULT_SIZE];
+  size_t length;
+  if (!encodeCommand(cmd, request) ||
+      (request.cmd == CMD_SUB && !isValidSubscription(request))) {
+    stats.unknown++;
+    length = snprintf(reply, sizeof(reply), "ERR");
+  } else {
+    perform(request);
+    crc16ToHex(crc16(cmd, strlen(cmd)), reply);
+    length = strlen(reply);
+    if (isRequest) {
+      reply[length++] = ':';
+      respondText(request, reply + length, sizeof(reply) - length - 6);
+      length = strlen(reply);
+    }
+  }
+  reply[length++] = '*';
+  crc16ToHex(crc16(reply, length - 1), reply + length);
+  queueLine(requestLength, reply);
+}
+
+/**
+ * Answer a link protocol offer.
+ *
+ * @param offer The request, e.g. "AT_LINK:BIN".
+ * @param requestLength The length of the request line in bytes.
+ * @return true if the request was a link offer and has been answered.
+ *
+ * An accepted protocol is confirmed in the legacy form and used from the
+ * next request on. A module without the protocol answers like firmware that
+ * does not know the offer.
+ */
+bool NyarkoaCommSim::offerLink(const char *offer, byte requestLength) {
+  if (strncmp(offer, "AT_LINK:", 8) != 0) return false;
+  const char *name = offer + 8;
+  Mode offered;
+  if (strcmp(name, "BIN") == 0 && (config.linkModes & SIM_LINK_BINARY)) {
+    offered = MODE_BINARY;
+  } else if (strcmp(name, "CRC") == 0 && (config.linkModes & SIM_LINK_CRC)) {
+    offered = MODE_CRC;
+  } else {
+    stats.unknown++;
+    queueLine(requestLength, "ERR");
+    return true;
+  }
+
+  char reply[32];
+  hash(offer, reply, sizeof(reply));
+  size_t length = strlen(reply);
+  snprintf(reply + length, sizeof(reply) - length, ":%s", name);
+  queueLine(requestLength, reply);
+  stats.commands++;
+  mode = offered;
+  parser.reset();
+  lastSeq = 0;
+  return true;
+}
+
+/**
+ * Answer a binary frame.
+ *
+ * @param request The decoded frame.
+ *
+ * A frame repeating the previous frame's SEQ and command is a retry whose
+ * reply was lost: it is answered again without executing it twice. Unknown
+ * commands are answered with CMD_NACK.
+ */
+void NyarkoaCommSim::receiveFrame(const Frame &request) {
+  byte requestLength = FRAME_HEADER_SIZE + request.length + FRAME_CRC_SIZE;
+  if (log != nullptr) {
+    char text[24];
+    snprintf(text, sizeof(text), "cmd 0x%02X seq %u", request.cmd,
+             request.seq);
+    logLine(F("RCVD FRAME: "), text);
+  }
+
+  Frame reply;
+  reply.seq = request.seq;
+  int length = respondBinary(request, reply.payload);
+  if (length < 0) {
+    stats.unknown++;
+    reply.cmd = CMD_NACK;
+    reply.length = 0;
+  } else {
+    if (request.seq == lastSeq && request.cmd == lastCmd) {
+      stats.duplicates++;
+    } else {
+      perform(request);
+    }
+    reply.cmd = request.cmd | FRAME_REPLY;
+    reply.length = length;
+  }
+  lastSeq = request.seq;
+  lastCmd = request.cmd;
+
+  FrameBuffer buffer;
+  writeFrame(buffer, reply);
+  queueReply(requestLength, buffer.data, buffer.length);
+}
+
+/**
+ * Carry out the side effects of a command.
+ *
+ * @param request The command as a frame; text commands are encoded first.
+ */
+void NyarkoaCommSim::perform(const Frame &request) {
+  stats.commands++;
+  switch (request.cmd) {
+    case CMD_EJECT:
+      stats.ejections++;
+      if (flight != nullptr) flight->eject();
+      logLine(F("ACTION: "), "balloon ejected");
+      break;
+    case CMD_ALERT:
+      logLine(F("ACTION: "), "alert");
+      break;
+    case CMD_EN_BEACON:
+      logLine(F("ACTION: "), "beacon on");
+      break;
+    case CMD_DIS_BEACON:
+      logLine(F("ACTION: "), "beacon off");
+      break;
+    case CMD_GS: {
+      stats.groundMessages++;
+      stats.groundRecords++;
+      const char *batch = "BATCH::";
+      if (request.length >= 7 && memcmp(request.payload, batch, 7) == 0) {
+        for (byte i = 7; i < request.length; i++) {
+          stats.groundRecords += request.payload[i] == ';';
+        }
+      }
+      break;
+    }
+    case CMD_SUB: {
+      Subscription &sub = subscriptions[request.payload[0] - CMD_MPU];
+      uint16_t period = request.payload[1] | request.payload[2] << 8;
+      sub.periodMicros = period * 1000UL;
+      sub.nextDue = micros() + sub.periodMicros;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/**
+ * Check the arguments of a subscription.
+ *
+ * @param request The CMD_SUB frame.
+ * @return true if it names a sensor that can push its readings.
+ */
+bool NyarkoaCommSim::isValidSubscription(const Frame &request) const {
+  return request.length == 3 && request.payload[0] >= CMD_MPU &&
+         request.payload[0] < CMD_MPU + SENSOR_COUNT;
+}
+
+/**
+ * Stop every sensor from pushing readings.
+ */
+void NyarkoaCommSim::endSubscriptions() {
+  memset(subscriptions, 0, sizeof(subscriptions));
+}
+
+/**
+ * Queue the readings that subscribed sensors are due to push.
+ *
+ * Each reading leaves at its due time, or once the UART is free. A module
+ * that has fallen more than a few periods behind skips the missed readings.
+ */
+void NyarkoaCommSim::pushDue() {
+  if (mode == MODE_LEGACY) return;
+  unsigned long now = micros();
+  for (byte i = 0; i < SENSOR_COUNT; i++) {
+    Subscription &sub = subscriptions[i];
+    if (sub.periodMicros == 0) continue;
+    if (long(now - sub.nextDue) > long(4 * sub.periodMicros)) {
+      sub.nextDue = now;
+    }
+    while (long(now - sub.nextDue) >= 0) {
+      push(CMD_MPU + i, sub.nextDue);
+      sub.nextDue += sub.periodMicros;
+    }
+  }
+}
+
+/**
+ * Push one reading of a sensor.
+ *
+ * @param sensor The sensor's command, e.g. CMD_MPU.
+ * @param due The micros() at which the reading is sent.
+ */
+void NyarkoaCommSim::push(byte sensor, unsigned long due) {
+  Frame request;
+  request.cmd = sensor;
+  request.length = 0;
+  stats.pushes++;
+
+  if (mode == MODE_BINARY) {
+    Frame reading;
+    reading.cmd = sensor | FRAME_REPLY;
+    reading.seq = FRAME_PUSH_SEQ;
+    reading.length = respondBinary(request, reading.payload);
+    FrameBuffer buffer;
+    writeFrame(buffer, reading);
+    queueAt(due, buffer.data, buffer.length);
+    return;
+  }
+
+  const char *name = sensor == CMD_MPU   ? "AT_MPU"
+                     : sensor == CMD_MPL ? "AT_MPL"
+                                         : "AT_GPS";
+  char text[NYARKOA_RESULT_SIZE + 16];
+  size_t length = snprintf(text, sizeof(text), "!%s:", name);
+  respondText(request, text + length, sizeof(text) - length - 8);
+  length = strlen(text);
+  text[length++] = '*';
+  crc16ToHex(crc16(text, length - 1), text + length);
+  length = strlen(text);
+  text[length++] = '\r';
+  text[length++] = '\n';
+  queueAt(due, reinterpret_cast<const byte *>(text), length);
+}
+
+/**
+ * Build the text payload of a request's reply.
+ *
+ * @param request The request as a frame.
+ * @param payload Receives the payload text.
+ * @param size The size of the payload buffer.
+ * @return true if the request returns data; false for commands, whose
+ * payload is "OK".
+ */
+bool NyarkoaCommSim::respondText(const Frame &request, char *payload,
+                                 size_t size) {
+  MPUData mpu;
+  MPLData mpl;
+  GPSData gps;
+  float values[10];
+  size_t length;
+  payload[0] = '\0';
+
+  switch (request.cmd) {
+    case CMD_DATE:
+      formatGPSDate(clockTime(0), payload, size);
+      return true;
+    case CMD_TIME:
+      formatGPSTime(clockTime(0), payload, size);
+      return true;
+    case CMD_TSTAMP:
+      formatGPSTimestamp(clockTime(0), payload, size);
+      return true;
+    case CMD_F_TIME: {
+      long offset = 0;
+      const long UNITS[] = {1, 60, 3600, 86400L};
+      for (byte i = 0; i < 4; i++) {
+        int16_t value = int16_t(request.payload[2 * i] |
+                                request.payload[2 * i + 1] << 8);
+        offset += value * UNITS[i];
+      }
+      formatGPSTimestamp(clockTime(offset), payload, size);
+      return true;
+    }
+    case CMD_MPU:
+    case CMD_MPL:
+    case CMD_GPS:
+    case CMD_ALL:
+      sample(mpu, mpl, gps);
+      memcpy(values, &mpu, sizeof(mpu));
+      memcpy(values + 7, &mpl, sizeof(mpl));
+      if (request.cmd == CMD_MPU) {
+        formatValues(values, 7, payload, size);
+      } else if (request.cmd == CMD_MPL) {
+        formatValues(values + 7, 3, payload, size);
+      } else if (request.cmd == CMD_GPS) {
+        formatGPS(gps, payload, size);
+      } else {
+        length = formatValues(values, 10, payload, size);
+        if (length + 1 < size) {
+          payload[length++] = ',';
+          formatGPS(gps, payload + length, size - length);
+        }
+      }
+      return true;
+    case CMD_GS:
+      snprintf(payload, size, "GS_OK");
+      return true;
+    default:
+      snprintf(payload, size, "OK");
+      return false;
+  }
+}
+
+/**
+ * Build the binary payload of a frame's reply.
+ *
+ * @param request The request frame.
+ * @param payload Receives up to FRAME_MAX_PAYLOAD bytes.
+ * @return The payload length, or -1 if the command is unknown.
+ *
+ * Sensor readings are packed floats and GPS records, clock readings and
+ * ground station acknowledgements the same text as on a text link.
+ */
+int NyarkoaCommSim::respondBinary(const Frame &request, byte *payload) {
+  MPUData mpu;
+  MPLData mpl;
+  GPSData gps;
+  char text[FRAME_MAX_PAYLOAD + 1];
+
+  switch (request.cmd) {
+    case CMD_EJECT:
+    case CMD_ALERT:
+    case CMD_EN_BEACON:
+    case CMD_DIS_BEACON:
+      return 0;
+    case CMD_SUB:
+      return isValidSubscription(request) ? 0 : -1;
+    case CMD_MPU:
+      sample(mpu, mpl, gps);
+      memcpy(payload, &mpu, sizeof(mpu));
+      return sizeof(mpu);
+    case CMD_MPL:
+      sample(mpu, mpl, gps);
+      memcpy(payload, &mpl, sizeof(mpl));
+      return sizeof(mpl);
+    case CMD_GPS:
+      sample(mpu, mpl, gps);
+      writeGPSRecord(gps, payload);
+      return GPS_RECORD_SIZE;
+    case CMD_ALL:
+      sample(mpu, mpl, gps);
+      memcpy(payload, &mpu, sizeof(mpu));
+      memcpy(payload + sizeof(mpu), &mpl, sizeof(mpl));
+      writeGPSRecord(gps, payload + sizeof(mpu) + sizeof(mpl));
+      return sizeof(mpu) + sizeof(mpl) + GPS_RECORD_SIZE;
+    case CMD_DATE:
+    case CMD_TIME:
+    case CMD_TSTAMP:
+    case CMD_F_TIME:
+    case CMD_GS:
+      respondText(request, text, sizeof(text));
+      memcpy(payload, text, strlen(text));
+      return strlen(text);
+    default:
+      return -1;
+  }
+}
+
+/**
+ * Compute the legacy simpleHash of a command, as the module firmware does.
+ *
+ * @param data The command.
+ * @param text Receives the hash as text.
+ * @param size The size of the text buffer.
+ */
+void NyarkoaCommSim::hash(const char *data, char *text, size_t size) {
+  size_t length = strlen(data);
+  unsigned long hashSum = 0;
+  for (size_t i = 0; i < length; i++) hashSum += int(data[i]);
+  int first = length ? int(data[0]) : 0;
+  int last = length ? int(data[length - 1]) : 0;
+  snprintf(text, size, "%u%d%lu%d%u", unsigned(length), first, hashSum, last,
+           unsigned(byte(hashSum % 256)));
+}
+
+/**
+ * Print a line to the log, if one is set.
+ *
+ * @param label The label to print first, wrapped in F().
+ * @param text The text to print after the label.
+ */
+void NyarkoaCommSim::logLine(const __FlashStringHelper *label,
+                             const char *text) {
+  if (log == nullptr) return;
+  log->print(label);
+  log->println(text);
+}
+
+/**
+ * Read the module clock.
+ *
+ * @param offsetSeconds Seconds to add to the current time.
+ * @return The time as a packed GPS dateTime word.
+ */
+uint32_t NyarkoaCommSim::clockTime(long offsetSeconds) {
+  unsigned long elapsed = millis() - clockStart;
+  elapsed += long(elapsed * (config.clockDriftPpm * 1e-6f));
+  return gpsFromSeconds(gpsToSeconds(config.startTime) + elapsed / 1000 +
+                        offsetSeconds);
+}
+
+/**
+ * Sample the module's sensors.
+ *
+ * @param mpu Receives the accelerometer, gyro and temperature readings.
+ * @param mpl Receives the barometer readings.
+ * @param gps Receives the GPS fix.
+ *
+ * The module rests on the launch pad, or follows its flight if one is set.
+ * Readings carry a little sensor noise around the true values. Without
+ * `sensorNoise` a resting module gives the same readings every time, apart
+ * from the GPS time.
+ */
+void NyarkoaCommSim::sample(MPUData &mpu, MPLData &mpl, GPSData &gps) {
+  const FlightState &state = flight != nullptr ? flight->now() : RESTING;
+  float ambient = SITE_TEMPERATURE - LAPSE_RATE * state.altitude;
+  mpu = {.accelX = state.accelX + noise(0.05),
+         .accelY = state.accelY + noise(0.05),
+         .accelZ = state.accelZ + noise(0.05),
+         .gyroX = state.gyroX + noise(0.5),
+         .gyroY = state.gyroY + noise(0.5),
+         .gyroZ = state.gyroZ + noise(0.5),
+         .temp = ambient + noise(0.2)};
+  float altitude = SITE_ALTITUDE + state.altitude + noise(0.5);
+  mpl = {.pressure = float(1013.25 * pow(1 - 2.25577e-5 * altitude, 5.25588)),
+         .altitude = altitude,
+         .temperature = ambient + noise(0.2)};
+  bool noisy = config.sensorNoise;
+  float latPerMetre = GPS_COORD_SCALE / METRES_PER_DEGREE;
+  float lonPerMetre =
+      latPerMetre / cos(SITE_LAT * DEG_TO_RAD / GPS_COORD_SCALE);
+  float distance = sqrt(state.east * state.east + state.north * state.north);
+  float speed = sqrt(state.velocityEast * state.velocityEast +
+                     state.velocityNorth * state.velocityNorth);
+  gps = {.lat = SITE_LAT + int32_t(lround(state.north * latPerMetre)) +
+                (noisy ? int32_t(random(-20, 21)) : 0),
+         .lon = SITE_LON + int32_t(lround(state.east * lonPerMetre)) +
+                (noisy ? int32_t(random(-20, 21)) : 0),
+         .dateTime = clockTime(0),
+         .speed = uint16_t(lround(speed * 3.6)),
+         .distanceFromHome =
+             uint16_t(lround(distance) + (noisy ? random(0, 3) : 0)),
+         .nSats = uint8_t(noisy ? random(7, 11) : 9)};
+}
+
+/**
+ * Draw uniform sensor noise.
+ *
+ * @param amplitude The largest deviation.
+ * @return A value between -amplitude and amplitude, or 0 without
+ * `sensorNoise`.
+ */
+float NyarkoaCommSim::noise(float amplitude) {
+  if (!config.sensorNoise) return 0;
+  return amplitude * random(-1000, 1001) / 1000.0;
+}
@@ -0,0 +1,169 @@
+#ifndef NYARKOA_COMM_SIM_H
+#define NYARKOA_COMM_SIM_H
+#include <Arduino.h>
+#include <NyarkoaConfig.h>
+#include <NyarkoaCrc.h>
+#include <NyarkoaFlight.h>
+#include <NyarkoaFrame.h>
+#include <NyarkoaGPS.h>
+#include <NyarkoaTypes.h>
+
+/*
+ * Emulated Communication and Control Module.
+ *
+ * In the host build NyarkoaPayloadTest talks to it in place of the real
+ * module, and the host tools in extras/host serve it on a pty or run against
+ * it in simulated time. The emulator is a Stream: bytes written to it are
+ * the payload's requests, bytes read from it are the module's replies. It
+ * speaks every protocol the library does, the same way the module firmware
+ * does:
+ *
+ *   - "AT?" is answered with "OK" in any mode and drops the link back to the
+ *     legacy protocol, as a module reset would.
+ *   - Legacy text: commands are echoed with their simpleHash, requests
+ *     ("REQ:<cmd>") with "<simpleHash(cmd)>:<payload>".
+ *   - CRC text lines and binary frames, once accepted through "AT_LINK:CRC"
+ *     or "AT_LINK:BIN". Lines or frames that fail their CRC are ignored, so
+ *     the payload sees a timeout.
+ *   - "AT_SUB:<sensor command>,<period in ms>" on a CRC or binary link makes
+ *     the module push the sensor's readings every period, as
+ *     "!<command>:<payload>*<crc>" lines or frames with SEQ 0; a period of 0
+ *     stops them. "AT?" ends all subscriptions.
+ *
+ * Replies become readable only after the configured processing latency,
+ * jitter and the time the UART needs to carry the request and the reply, so
+ * the payload's timing behaves as it does against real hardware. A set
+ * share of replies can be lost or have a bit flipped on the way, to exercise
+ * the payload's checks and retries. Time is taken from micros(): wall-clock
+ * time in the pty emulator, simulated time in host tests.
+ *
+ * The sensors rest on the launch pad, or follow a NyarkoaFlight when one is
+ * set; AT_EJECT then releases the flight from its balloon.
+ */
+
+// Link protocols the emulated module accepts when offered.
+const byte SIM_LINK_CRC{0x01};
+const byte SIM_LINK_BINARY{0x02};
+
+struct CommSimConfig {
+  unsigned long latencyMicros;  // time to process a request
+  unsigned long jitterMicros;   // up to this much extra, chosen at random
+  unsigned long baudRate;       // UART speed; 0 delivers bytes instantly
+  byte linkModes;               // SIM_LINK_* flags; 0 for a legacy module
+  uint32_t startTime;           // packed GPS dateTime of the module clock
+  long clockDriftPpm;           // how fast the module clock runs, in ppm
+  byte dropPercent;             // replies lost on the way to the payload
+  byte corruptPercent;          // replies with one bit flipped
+  bool sensorNoise;             // false for the same readings every time
+};
+
+struct CommSimStats {
+  unsigned long commands;       // commands and requests answered
+  unsigned long badChecks;      // lines or frames dropped for a bad CRC
+  unsigned long unknown;        // commands the module does not know
+  unsigned long duplicates;     // binary frames repeated with the same SEQ
+  unsigned long ejections;
+  unsigned long groundMessages; // GS:: messages forwarded
+  unsigned long groundRecords;  // records they carried, batches counted out
+  unsigned long pushes;         // readings pushed to subscribers
+  unsigned long dropped;        // replies lost by fault injection
+  unsigned long corrupted;      // replies damaged by fault injection
+  unsigned long bytesIn;
+  unsigned long bytesOut;
+};
+
+class NyarkoaCommSim : public Stream {
+ public:
+  static const byte LINE_SIZE{NYARKOA_CMD_SIZE + 16};
+  static const uint16_t OUT_SIZE{NYARKOA_SIM_OUT_SIZE};
+  static const byte MAX_REPLIES{8};
+  static const byte SENSOR_COUNT{3};  // MPU, MPL and GPS can be subscribed
+
+  NyarkoaCommSim();
+  explicit NyarkoaCommSim(const CommSimConfig &config);
+
+  void reset();
+  void setConfig(const CommSimConfig &config);
+  const CommSimConfig &getConfig() const { return config; }
+  const CommSimStats &getStats() const { return stats; }
+  void setLog(Print *log);
+  void setFlight(NyarkoaFlight *flight);
+  bool isBinaryLink() const { return mode == MODE_BINARY; }
+  bool isCrcLink() const { return mode == MODE_CRC; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t data) override;
+  using Print::write;
+
+  static CommSimConfig defaultConfig();
+
+ private:
+  enum Mode : byte { MODE_LEGACY, MODE_CRC, MODE_BINARY };
+
+  // A reply waiting in the output ring; its bytes become readable one
+  // character time apart from `start`.
+  struct Reply {
+    unsigned long start;
+    uint16_t length;
+    uint16_t released;
+  };
+
+  // A sensor pushing its readings; the period is 0 while it is not.
+  struct Subscription {
+    unsigned long periodMicros;
+    unsigned long nextDue;
+  };
+
+  CommSimConfig config;
+  CommSimStats stats;
+  Print *log{nullptr};
+  NyarkoaFlight *flight{nullptr};
+  Mode mode{MODE_LEGACY};
+  char line[LINE_SIZE];
+  byte lineLength{0};
+  bool lineOverflow{false};
+  FrameParser parser;
+  byte lastSeq{0};
+  byte lastCmd{CMD_NONE};
+  unsigned long clockStart{0};
+
+  byte out[OUT_SIZE];
+  uint16_t outHead{0};   // next byte to read
+  uint16_t outCount{0};  // bytes queued, released or not
+  uint16_t outReadable{0};
+  Reply replies[MAX_REPLIES];
+  byte replyHead{0};
+  byte replyCount{0};
+  unsigned long linkFreeAt{0};
+  Subscription subscriptions[SENSOR_COUNT];
+
+  unsigned long byteMicros() const;
+  void release();
+  void queueReply(byte requestLength, const byte *data, uint16_t length);
+  void queueAt(unsigned long start, const byte *data, uint16_t length);
+  void queueLine(byte requestLength, const char *text);
+
+  void receiveLine(byte requestLength);
+  void answerLegacy(char *text, byte requestLength);
+  void answerChecked(char *text, byte requestLength);
+  bool offerLink(const char *offer, byte requestLength);
+  void receiveFrame(const Frame &request);
+
+  void perform(const Frame &request);
+  bool isValidSubscription(const Frame &request) const;
+  void endSubscriptions();
+  void pushDue();
+  void push(byte sensor, unsigned long due);
+  bool respondText(const Frame &request, char *payload, size_t size);
+  int respondBinary(const Frame &request, byte *payload);
+  void hash(const char *data, char *text, size_t size);
+  void logLine(const __FlashStringHelper *label, const char *text);
+
+  uint32_t clockTime(long offsetSeconds);
+  void sample(MPUData &mpu, MPLData &mpl, GPSData &gps);
+  float noise(float amplitude);
+};
+
+#endif
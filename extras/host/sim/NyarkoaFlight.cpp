@@ -0,0 +1,262 @@
+#include <Arduino.h>
+#include <NyarkoaFlight.h>
+#include <math.h>
+
+const float GRAVITY{9.81};
+const float BALLOON_RESPONSE{2.0};  // s for the climb rate to settle
+const float DRIFT_RESPONSE{4.0};    // s for the drift to follow the wind
+const float FALL_SPEED{35.0};       // m/s terminal speed without parachute
+const float CHUTE_OPENING{1.0};     // s for the parachute to open fully
+const float IMPACT_SECONDS{0.05};   // s the landing takes to stop the CanSat
+const float WIND_SHEAR{1.0 / 7};    // wind speed grows as height^(1/7)
+const float WIND_GUST{0.2};         // gusts vary the wind by up to 20%
+
+NyarkoaFlight::NyarkoaFlight() : NyarkoaFlight(defaultConfig()) {}
+
+NyarkoaFlight::NyarkoaFlight(const FlightConfig &config) {
+  setConfig(config);
+}
+
+/**
+ * Get the settings of a typical flight.
+ *
+ * @return A flight that launches after 10 s on the pad, climbs at 5 m/s to a
+ * balloon burst 1000 m above the site, falls for 2 s and descends at 8 m/s
+ * under its parachute, in a 4 m/s south-westerly wind, sampled at 50 Hz in
+ * real time.
+ */
+FlightConfig NyarkoaFlight::defaultConfig() {
+  return {.padSeconds = 10,
+          .ascentRate = 5,
+          .burstAltitude = 1000,
+          .freeFallSeconds = 2,
+          .descentRate = 8,
+          .windSpeed = 4,
+          .windFrom = 225,
+          .sampleRate = 50,
+          .timeScale = 1};
+}
+
+/**
+ * Get the state of a CanSat resting on the pad.
+ *
+ * @return A state at the launch site, at rest, with the accelerometer
+ * reading gravity.
+ */
+FlightState NyarkoaFlight::restingState() {
+  FlightState resting;
+  memset(&resting, 0, sizeof(resting));
+  resting.phase = FLIGHT_PAD;
+  resting.accelZ = GRAVITY;
+  return resting;
+}
+
+/**
+ * Change the flight and start it again.
+ *
+ * @param newConfig The new settings. A sample rate or time scale of 0 is
+ * taken as 1.
+ */
+void NyarkoaFlight::setConfig(const FlightConfig &newConfig) {
+  config = newConfig;
+  if (config.sampleRate == 0) config.sampleRate = 1;
+  if (config.timeScale == 0) config.timeScale = 1;
+  restart();
+}
+
+/**
+ * Put the CanSat back on the pad, with the flight clock at 0.
+ */
+void NyarkoaFlight::restart() {
+  state = restingState();
+  lastMicros = micros();
+  carry = 0;
+  steps = 0;
+  phaseStart = 0;
+  impactSpeed = 0;
+}
+
+/**
+ * Release the CanSat from the balloon, as AT_EJECT does.
+ *
+ * Only a climbing CanSat can be released; on the pad or once released this
+ * does nothing.
+ */
+void NyarkoaFlight::eject() {
+  now();
+  if (state.phase == FLIGHT_ASCENT) enter(FLIGHT_FREE_FALL);
+}
+
+/**
+ * Advance the flight without waiting for it.
+ *
+ * @param seconds The flight time to skip. The model still takes every step
+ * on the way, so the flight is the same as if it had been waited for.
+ */
+void NyarkoaFlight::fastForward(float seconds) {
+  now();
+  unsigned long count = lround(seconds * config.sampleRate);
+  while (count-- > 0) step();
+}
+
+/**
+ * Advance the flight until it reaches a phase.
+ *
+ * @param phase The phase to reach, e.g. FLIGHT_LANDED.
+ * @param maxSeconds The most flight time to skip.
+ * @return true if the phase was reached; otherwise, false.
+ */
+bool NyarkoaFlight::fastForwardTo(FlightPhase phase, float maxSeconds) {
+  now();
+  unsigned long count = lround(maxSeconds * config.sampleRate);
+  while (state.phase < phase && count-- > 0) step();
+  return state.phase >= phase;
+}
+
+/**
+ * Bring the flight up to the current time.
+ *
+ * @return The state after the last whole step.
+ */
+const FlightState &NyarkoaFlight::now() {
+  unsigned long current = micros();
+  carry += (current - lastMicros) * 1e-6f * config.timeScale;
+  lastMicros = current;
+  float dt = stepSeconds();
+  while (carry >= dt) {
+    step();
+    carry -= dt;
+  }
+  return state;
+}
+
+/**
+ * Get the length of one model step.
+ *
+ * @return The step in seconds of flight.
+ */
+float NyarkoaFlight::stepSeconds() const { return 1.0f / config.sampleRate; }
+
+/**
+ * Start a phase of the flight.
+ *
+ * @param phase The phase the CanSat is in from now on.
+ */
+void NyarkoaFlight::enter(FlightPhase phase) {
+  state.phase = phase;
+  phaseStart = state.seconds;
+}
+
+/**
+ * Set the gyro rates for a step.
+ *
+ * @param t The flight time at the end of the step.
+ * @param dt The length of the step.
+ *
+ * The CanSat turns slowly and swings under the balloon, tumbles in free
+ * fall, and spins and sways under the parachute.
+ */
+void NyarkoaFlight::updateRates(float t, float dt) {
+  float swing = 0;
+  switch (state.phase) {
+    case FLIGHT_ASCENT:
+      swing = 2 * PI * t / 6;
+      state.gyroX = 3 * sin(swing);
+      state.gyroY = 3 * cos(swing);
+      state.gyroZ = 6;
+      break;
+    case FLIGHT_FREE_FALL:
+      state.gyroX = 140;
+      state.gyroY = -90;
+      state.gyroZ = 60;
+      break;
+    case FLIGHT_PARACHUTE:
+      swing = 2 * PI * t / 2.5;
+      state.gyroX = 10 * sin(swing);
+      state.gyroY = 10 * cos(swing);
+      state.gyroZ = 30;
+      break;
+    default:
+      state.gyroX = state.gyroY = state.gyroZ = 0;
+      break;
+  }
+  state.heading = fmod(state.heading + state.gyroZ * dt + 360, 360);
+}
+
+/**
+ * Advance the model by one step.
+ *
+ * The climb follows the balloon's rate, or gravity against the drag of the
+ * CanSat and its opening parachute; the drift follows the wind, which grows
+ * with height and gusts. The accelerometer reads the acceleration plus
+ * gravity, so about 0 in free fall and 1 g at rest.
+ */
+void NyarkoaFlight::step() {
+  float dt = stepSeconds();
+  float t = ++steps * dt;
+  state.seconds = t;
+
+  float height = state.altitude > 1 ? state.altitude : 1;
+  float gust = 1 + WIND_GUST * sin(2 * PI * t / 17) * sin(2 * PI * t / 5.3);
+  float wind = config.windSpeed * pow(height / 10, WIND_SHEAR) * gust;
+  float towards = (config.windFrom + 180) * DEG_TO_RAD;
+  float windEast = wind * sin(towards);
+  float windNorth = wind * cos(towards);
+
+  float accelUp = 0, accelEast = 0, accelNorth = 0;
+  float fallDrag = GRAVITY / (FALL_SPEED * FALL_SPEED);
+  float chuteDrag = GRAVITY / (config.descentRate * config.descentRate);
+  float sinceStart = t - phaseStart;
+  switch (state.phase) {
+    case FLIGHT_PAD:
+      if (t >= config.padSeconds) enter(FLIGHT_ASCENT);
+      break;
+    case FLIGHT_ASCENT:
+      accelUp = (config.ascentRate - state.climb) / BALLOON_RESPONSE;
+      break;
+    case FLIGHT_FREE_FALL:
+      accelUp = -GRAVITY - fallDrag * state.climb * fabs(state.climb);
+      if (sinceStart >= config.freeFallSeconds) enter(FLIGHT_PARACHUTE);
+      break;
+    case FLIGHT_PARACHUTE: {
+      float open = sinceStart < CHUTE_OPENING ? sinceStart / CHUTE_OPENING : 1;
+      float drag = fallDrag + open * (chuteDrag - fallDrag);
+      accelUp = -GRAVITY - drag * state.climb * fabs(state.climb);
+      break;
+    }
+    case FLIGHT_LANDED:
+      if (sinceStart < IMPACT_SECONDS) accelUp = impactSpeed / IMPACT_SECONDS;
+      break;
+  }
+  if (state.phase != FLIGHT_PAD && state.phase != FLIGHT_LANDED) {
+    accelEast = (windEast - state.velocityEast) / DRIFT_RESPONSE;
+    accelNorth = (windNorth - state.velocityNorth) / DRIFT_RESPONSE;
+  }
+
+  if (state.phase != FLIGHT_LANDED) {
+    state.climb += accelUp * dt;
+    state.altitude += state.climb * dt;
+    state.velocityEast += accelEast * dt;
+    state.velocityNorth += accelNorth * dt;
+    state.east += state.velocityEast * dt;
+    state.north += state.velocityNorth * dt;
+  }
+  if (state.phase == FLIGHT_ASCENT &&
+      state.altitude >= config.burstAltitude) {
+    enter(FLIGHT_FREE_FALL);
+  } else if (state.phase >= FLIGHT_FREE_FALL && state.phase < FLIGHT_LANDED &&
+             state.altitude <= 0) {
+    impactSpeed = -state.climb;
+    accelUp = impactSpeed / IMPACT_SECONDS;
+    accelEast = accelNorth = 0;
+    state.altitude = state.climb = 0;
+    state.velocityEast = state.velocityNorth = 0;
+    enter(FLIGHT_LANDED);
+  }
+
+  updateRates(t, dt);
+  float heading = state.heading * DEG_TO_RAD;
+  state.accelX = accelEast * sin(heading) + accelNorth * cos(heading);
+  state.accelY = -accelEast * cos(heading) + accelNorth * sin(heading);
+  state.accelZ = accelUp + GRAVITY;
+}
@@ -0,0 +1,93 @@
+#ifndef NYARKOA_FLIGHT_H
+#define NYARKOA_FLIGHT_H
+#include <Arduino.h>
+
+/*
+ * Flight of a CanSat carried up by a balloon, for the emulated comm module.
+ *
+ * The CanSat waits on the pad, climbs under the balloon while the wind
+ * carries it off, and is released at apogee: by AT_EJECT, or when the
+ * balloon bursts. It falls freely until its parachute opens, then descends
+ * under the parachute and lands. The model is stepped at a fixed sample
+ * rate, so the same settings always give the same flight, however often
+ * and whenever it is read. Each step yields what the payload's sensors would
+ * see: the accelerometer's specific force and the gyro's rates in the
+ * CanSat's axes (z up, turning with it), altitude, climb rate, and the
+ * drift from the launch site.
+ *
+ * Flight time runs `timeScale` times faster than micros(), and
+ * `fastForward` skips ahead at once, so a whole flight can be replayed
+ * without waiting for it.
+ */
+enum FlightPhase : byte {
+  FLIGHT_PAD,
+  FLIGHT_ASCENT,
+  FLIGHT_FREE_FALL,
+  FLIGHT_PARACHUTE,
+  FLIGHT_LANDED
+};
+
+struct FlightConfig {
+  float padSeconds;       // time on the pad before launch
+  float ascentRate;       // balloon climb rate, m/s
+  float burstAltitude;    // m above the site; the balloon bursts there
+  float freeFallSeconds;  // from release until the parachute opens
+  float descentRate;      // m/s under the open parachute
+  float windSpeed;        // m/s, 10 m above the ground
+  float windFrom;         // degrees clockwise from north
+  uint16_t sampleRate;    // model steps per second of flight
+  uint16_t timeScale;     // seconds of flight per second of micros()
+};
+
+struct FlightState {
+  float seconds;          // flight time since the model started
+  FlightPhase phase;
+  float altitude;         // m above the site
+  float climb;            // m/s, up
+  float east;             // m from the site
+  float north;
+  float velocityEast;     // m/s over the ground
+  float velocityNorth;
+  float accelX;           // specific force in the CanSat's axes, m/s^2
+  float accelY;
+  float accelZ;
+  float gyroX;            // rates about the CanSat's axes, deg/s
+  float gyroY;
+  float gyroZ;
+  float heading;          // degrees the CanSat's x axis points to
+};
+
+class NyarkoaFlight {
+ public:
+  NyarkoaFlight();
+  explicit NyarkoaFlight(const FlightConfig &config);
+
+  void setConfig(const FlightConfig &config);
+  const FlightConfig &getConfig() const { return config; }
+  void restart();
+  void eject();
+  void fastForward(float seconds);
+  bool fastForwardTo(FlightPhase phase, float maxSeconds = 7200);
+  const FlightState &now();
+  const FlightState &getState() const { return state; }
+  float getPhaseStart() const { return phaseStart; }
+
+  static FlightConfig defaultConfig();
+  static FlightState restingState();
+
+ private:
+  FlightConfig config;
+  FlightState state;
+  unsigned long lastMicros{0};
+  float carry{0};                // flight seconds not stepped yet
+  unsigned long steps{0};
+  float phaseStart{0};           // flight time the phase began at
+  float impactSpeed{0};          // m/s when the CanSat hit the ground
+
+  float stepSeconds() const;
+  void step();
+  void enter(FlightPhase phase);
+  void updateRates(float t, float dt);
+};
+
+#endif
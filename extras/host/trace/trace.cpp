@@ -0,0 +1,287 @@
+// Recording and replay of the NyarkoaPayload comm link, in simulated time.
+//
+//   nyarkoa_trace record FILE [options]   run a session against the emulated
+//                                         module and trace it to FILE
+//   nyarkoa_trace replay FILE [--fast]    run the same session against FILE
+//   nyarkoa_trace dump FILE               list the records in FILE
+//
+// The session connects and then reads the MPU, MPL, GPS and snapshot in
+// turn, pausing between cycles. A replay runs the same session with a
+// NyarkoaTraceReplay in place of the module: with the recorded timing by
+// default, or with --fast as soon as the payload asks, pauses between cycles
+// included. It reports how long the session took in simulated time, the CPU
+// time it used, and every byte the payload sent that differs from the trace,
+// so a change to the library can be checked against a recorded flight
+// without the module.
+#include <Arduino.h>
+#include <NyarkoaCommSim.h>
+#include <NyarkoaPayload.h>
+#include <NyarkoaTrace.h>
+#include <ShimClock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+namespace {
+
+struct Options {
+  const char *command{nullptr};
+  const char *path{nullptr};
+  unsigned long cycles{50};
+  unsigned long periodMicros{100000};
+  unsigned long seed{1};
+  bool fast{false};
+  CommSimConfig link{NyarkoaCommSim::defaultConfig()};
+};
+
+struct Session {
+  unsigned long calls;
+  unsigned long failed;
+  double seconds;  // simulated
+  double cpuMillis;
+};
+
+// Print that writes to a file.
+class FilePrint : public Print {
+ public:
+  explicit FilePrint(FILE *file) : file(file) {}
+  size_t write(uint8_t data) override { return fputc(data, file) != EOF; }
+  size_t write(const uint8_t *data, size_t size) override {
+    return fwrite(data, 1, size, file);
+  }
+  using Print::write;
+
+ private:
+  FILE *file;
+};
+
+double cpuMillis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Connect over `link` and run the read cycles.
+Session runSession(NyarkoaPayload &payload, Stream &link,
+                   const Options &options, bool pace) {
+  Session session = Session();
+  uint64_t start = shim::nowMicros();
+  double cpuStart = cpuMillis();
+  session.calls++;
+  if (!payload.connectCommModule(link).isOk) {
+    session.failed++;
+  } else {
+    for (unsigned long i = 0; i < options.cycles; i++) {
+      uint64_t cycleStart = shim::nowMicros();
+      MPUData mpu;
+      MPLData mpl;
+      GPSData gps;
+      Snapshot snapshot;
+      session.failed += !payload.getMPUData(mpu);
+      session.failed += !payload.getMPLData(mpl);
+      session.failed += !payload.getGPSData(gps);
+      session.failed += !payload.getSnapshot(snapshot);
+      session.calls += 4;
+      uint64_t now = shim::nowMicros();
+      if (pace && cycleStart + options.periodMicros > now) {
+        shim::advanceMicros(cycleStart + options.periodMicros - now);
+      }
+    }
+  }
+  session.seconds = (shim::nowMicros() - start) / 1e6;
+  session.cpuMillis = cpuMillis() - cpuStart;
+  return session;
+}
+
+bool readFile(const char *path, std::vector<byte> &data) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) return false;
+  byte buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + count);
+  }
+  fclose(file);
+  return true;
+}
+
+int record(NyarkoaPayload &payload, const Options &options) {
+  FILE *file = fopen(options.path, "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "cannot write %s\n", options.path);
+    return 1;
+  }
+  FilePrint out(file);
+  randomSeed(options.seed);
+  NyarkoaCommSim module(options.link);
+  NyarkoaTraceRecorder recorder;
+  recorder.begin(&out);
+  payload.setTrace(&recorder);
+  Session session = runSession(payload, module, options, true);
+  recorder.end();
+  fclose(file);
+
+  const TraceStats &stats = recorder.getStats();
+  printf("recorded %lu calls (%lu failed) in %.3f s: %lu link bytes in %lu "
+         "records\n",
+         session.calls, session.failed, session.seconds, stats.bytes,
+         stats.records);
+  return session.failed ? 1 : 0;
+}
+
+int replay(NyarkoaPayload &payload, const Options &options) {
+  std::vector<byte> data;
+  if (!readFile(options.path, data)) {
+    fprintf(stderr, "cannot read %s\n", options.path);
+    return 1;
+  }
+  NyarkoaTraceReplay trace(data.data(), data.size(), !options.fast);
+  if (!trace.isValid()) {
+    fprintf(stderr, "%s is not a trace\n", options.path);
+    return 1;
+  }
+  Session session = runSession(payload, trace, options, !options.fast);
+  const ReplayStats &stats = trace.getStats();
+  printf("replayed %lu calls (%lu failed) in %.3f s simulated, %.1f ms CPU\n"
+         "%lu bytes received, %lu sent: %lu differ from the trace, %lu "
+         "beyond it%s\n",
+         session.calls, session.failed, session.seconds, session.cpuMillis,
+         stats.rxBytes, stats.txBytes, stats.mismatches, stats.extra,
+         trace.isFinished() ? "" : ", trace not finished");
+  bool isSame = session.failed == 0 && stats.mismatches == 0 &&
+                stats.extra == 0 && trace.isFinished();
+  return isSame ? 0 : 1;
+}
+
+int dump(const Options &options) {
+  std::vector<byte> data;
+  if (!readFile(options.path, data)) {
+    fprintf(stderr, "cannot read %s\n", options.path);
+    return 1;
+  }
+  if (data.size() < TRACE_HEADER_SIZE ||
+      memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+    fprintf(stderr, "%s is not a trace\n", options.path);
+    return 1;
+  }
+  printf("%12s %-2s %3s  data\n", "time us", "", "len");
+  unsigned long time = 0;
+  size_t at = TRACE_HEADER_SIZE;
+  while (at < data.size()) {
+    byte header = data[at++];
+    unsigned long delta = 0;
+    byte shift = 0;
+    while (at < data.size()) {
+      byte part = data[at++];
+      delta |= (unsigned long)(part & 0x7F) << shift;
+      shift += 7;
+      if (!(part & 0x80)) break;
+    }
+    size_t length = (header & ~TRACE_RX) + 1;
+    if (data.size() - at < length) {
+      fprintf(stderr, "trace cut short at byte %zu\n", at);
+      return 1;
+    }
+    time += delta;
+    printf("%12lu %-2s %3zu  ", time, header & TRACE_RX ? "<-" : "->",
+           length);
+    for (size_t i = 0; i < length; i++) {
+      byte c = data[at + i];
+      if (c >= 0x20 && c < 0x7F && c != '\\') {
+        putchar(c);
+      } else {
+        printf("\\x%02x", c);
+      }
+    }
+    putchar('\n');
+    at += length;
+  }
+  return 0;
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s record FILE [options]\n"
+          "       %s replay FILE [--fast] [options]\n"
+          "       %s dump FILE\n"
+          "  --cycles N       read cycles after connecting (default 50)\n"
+          "  --period MS      time from one cycle to the next (default 100)\n"
+          "  --link NAME      legacy, crc or binary (default binary)\n"
+          "  --fast           replay without the recorded pauses\n"
+          "  --latency MS     module processing time (default 2)\n"
+          "  --jitter MS      extra random latency, up to (default 1)\n"
+          "  --baud N         UART speed, 0 for unlimited (default 115200)\n"
+          "  --seed N         seed for sensor noise and jitter (default 1)\n"
+          "A replay must be given the same --cycles, --period and --link as "
+          "the recording.\n",
+          name, name, name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (argc < 3) {
+    usage(argv[0]);
+    return 2;
+  }
+  options.command = argv[1];
+  options.path = argv[2];
+  const char *link = "binary";
+  for (int i = 3; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--fast") == 0) {
+      options.fast = true;
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(arg, "--cycles") == 0) {
+      options.cycles = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--period") == 0) {
+      options.periodMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--link") == 0) {
+      link = value;
+    } else if (strcmp(arg, "--latency") == 0) {
+      options.link.latencyMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--jitter") == 0) {
+      options.link.jitterMicros = (unsigned long)(atof(value) * 1000 + 0.5);
+    } else if (strcmp(arg, "--baud") == 0) {
+      options.link.baudRate = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (strcmp(link, "legacy") == 0) {
+    options.link.linkModes = 0;
+  } else if (strcmp(link, "crc") == 0) {
+    options.link.linkModes = SIM_LINK_CRC;
+  } else if (strcmp(link, "binary") == 0) {
+    options.link.linkModes = SIM_LINK_CRC | SIM_LINK_BINARY;
+  } else {
+    usage(argv[0]);
+    return 2;
+  }
+  HardwareSerial::mute(true);
+
+  shim::setMicros(0);
+  NyarkoaPayload payload;
+  if (options.link.linkModes & SIM_LINK_BINARY) payload.enableBinaryLink();
+  payload.activateProdMode();
+  if (strcmp(options.command, "record") == 0) return record(payload, options);
+  if (strcmp(options.command, "replay") == 0) return replay(payload, options);
+  if (strcmp(options.command, "dump") == 0) return dump(options);
+  usage(argv[0]);
+  return 2;
+}